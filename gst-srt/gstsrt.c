@@ -27,8 +27,11 @@
 #include "gstsrtserversrc.h"
 #include "gstsrtclientsink.h"
 #include "gstsrtserversink.h"
+#include "gstsrtmergesrc.h"
+#include "gstsrttracer.h"
 
 #include <srt.h>
+#include <string.h>
 
 #define GST_CAT_DEFAULT gst_debug_srt
 GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
@@ -38,7 +41,10 @@ gst_srt_client_connect_full (GstElement * elem, gboolean is_sender,
   const gchar * host, guint16 port, gboolean rendezvous,
   const gchar * bind_address, guint16 bind_port, int latency,
   GSocketAddress ** socket_address, gint * poll_id, gchar * passphrase,
-  int key_length)
+  int key_length, int km_refresh_rate, int km_preannounce,
+  const gchar * streamid, const gchar * packet_filter,
+  GstSRTTransType transtype, gint64 bitrate, GstSRTProfile profile,
+  const GstStructure * srt_options)
 {
   SRTSOCKET sock = SRT_INVALID_SOCK;
   GError *error = NULL;
@@ -60,13 +66,16 @@ gst_srt_client_connect_full (GstElement * elem, gboolean is_sender,
     goto failed;
   }
 
-  *poll_id = srt_epoll_create ();
-  GST_INFO_OBJECT (elem, "SRT Epoll Created %i", *poll_id);
-  if (*poll_id == -1) {
-    GST_ELEMENT_ERROR (elem, LIBRARY, INIT, (NULL),
-      ("failed to create poll id for SRT socket (reason: %s)",
-        srt_getlasterror_str ()));
-    goto failed;
+  /* Only for the callers that wait on the socket */
+  if (poll_id != NULL) {
+    *poll_id = srt_epoll_create ();
+    GST_INFO_OBJECT (elem, "SRT Epoll Created %i", *poll_id);
+    if (*poll_id == -1) {
+      GST_ELEMENT_ERROR (elem, LIBRARY, INIT, (NULL),
+        ("failed to create poll id for SRT socket (reason: %s)",
+          srt_getlasterror_str ()));
+      goto failed;
+    }
   }
 
   sa_len = g_socket_address_get_native_size (*socket_address);
@@ -99,11 +108,15 @@ gst_srt_client_connect_full (GstElement * elem, gboolean is_sender,
 
   int on = 1;
   int off = 0;
-  /* Make sure TSBPD mode is enable (SRT mode) */
-  srt_setsockopt (sock, 0, SRTO_TSBPDMODE, &on, sizeof (int));
+  gst_srt_set_transtype (sock, transtype);
 
-  /* srt recommends disabling linger */
-  srt_setsockopt (sock, 0, SRTO_LINGER, &off, sizeof (int));
+  if (transtype == GST_SRT_TRANSTYPE_LIVE) {
+    /* Make sure TSBPD mode is enable (SRT mode) */
+    srt_setsockopt (sock, 0, SRTO_TSBPDMODE, &on, sizeof (int));
+
+    /* srt recommends disabling linger */
+    srt_setsockopt (sock, 0, SRTO_LINGER, &off, sizeof (int));
+  }
 
   /* If this is a sink, we're a sender, otherwise we're a receiver */
   int is_sender_int = (int)is_sender;
@@ -123,37 +136,36 @@ gst_srt_client_connect_full (GstElement * elem, gboolean is_sender,
       srt_setsockopt (sock, 0, SRTO_IPTOS, &tos, sizeof (int));
   }
 
-  // If we're a sender, limit bandwidth spikes
-  if (is_sender) {
-      //NOTE: We leave the max bandwidth as unlimited
-      // this is because on our broadcaster network,
-      // we don't need to worry too much about
-      // overloading the network. We observe more
-      // video corruption when this is set to 0
-      //int64_t max_bw = 0; //relative
-      //srt_setsockopt (sock, 0, SRTO_MAXBW, &max_bw, sizeof (int64_t));
-      //int64_t input_bw = 1.5 * 4096 / 8 * 1024;
-      //srt_setsockopt (sock, 0, SRTO_INPUTBW, &input_bw, sizeof (int64_t));
-      //int max_overhead = 50; // 50%
-  }
-
-  /* Use the larger recommended send buffer */
-  if (is_sender) {
-      int send_buff_bytes = SRT_SEND_BUFFER_SIZE;
-      srt_setsockopt(sock, 0, SRTO_UDP_SNDBUF, &send_buff_bytes, sizeof (int));
-  }
+  // The sender's bandwidth limits (maxbw, inputbw, oheadbw) can change
+  // after connecting, the sink elements apply them once connected.
+  // NOTE: The client sink leaves the max bandwidth as unlimited by default,
+  // on our broadcaster network we observe more video corruption with a
+  // relative limit
+
+  gst_srt_set_buffer_sizes (elem, sock, is_sender, latency, bitrate);
 
   GST_INFO_OBJECT (elem, "Using as latency: %i", latency);
 
   int rendezvousInt = (int)rendezvous;
   srt_setsockopt (sock, 0, SRTO_RENDEZVOUS, &rendezvousInt, sizeof (int));
 
-  if (passphrase != NULL && passphrase[0] != '\0') {
-    GST_INFO_OBJECT (elem, "Using passphrase");
-    srt_setsockopt (sock, 0, SRTO_PASSPHRASE, passphrase, (int)strlen (passphrase));
-    srt_setsockopt (sock, 0, SRTO_PBKEYLEN, &key_length, sizeof (int));
+  gst_srt_set_encryption (elem, sock, passphrase, key_length,
+    km_refresh_rate, km_preannounce);
+
+  if (streamid && streamid[0] != '\0' && srt_setsockopt (sock, 0,
+      SRTO_STREAMID, streamid, (int)strlen (streamid)) == SRT_ERROR) {
+    GST_ELEMENT_ERROR (elem, LIBRARY, SETTINGS, ("Invalid stream ID"),
+      ("Can't set stream ID '%s' (reason: %s)", streamid,
+        srt_getlasterror_str ()));
+    goto failed;
   }
 
+  if (!gst_srt_set_packet_filter (elem, sock, packet_filter))
+    goto failed;
+
+  if (!gst_srt_apply_options (elem, sock, profile, srt_options))
+    goto failed;
+
   if (bind_address || bind_port || rendezvous) {
     gpointer bsa;
     size_t bsa_len;
@@ -210,13 +222,15 @@ gst_srt_client_connect_full (GstElement * elem, gboolean is_sender,
 
   int events = is_sender ? SRT_EPOLL_IN | SRT_EPOLL_OUT | SRT_EPOLL_ERR
     : SRT_EPOLL_IN | SRT_EPOLL_ERR;
-  int addUsockRet = srt_epoll_add_usock (*poll_id, sock, &events);
-  GST_INFO_OBJECT (elem, "SRT Epoll Has Usock Added. Returned: %i", addUsockRet );
+  if (poll_id != NULL) {
+    int addUsockRet = srt_epoll_add_usock (*poll_id, sock, &events);
+    GST_INFO_OBJECT (elem, "SRT Epoll Has Usock Added. Returned: %i", addUsockRet );
+  }
 
   return sock;
 
 failed:
-  if (*poll_id != SRT_ERROR) {
+  if (poll_id != NULL && *poll_id != SRT_ERROR) {
     srt_epoll_release (*poll_id);
     *poll_id = SRT_ERROR;
   }
@@ -240,7 +254,616 @@ gst_srt_client_connect (GstElement * elem, int sender,
 {
   return gst_srt_client_connect_full (elem, sender, host, port,
     rendez_vous, bind_address, bind_port, latency, socket_address, poll_id,
-    NULL, 0);
+    NULL, 0, SRT_DEFAULT_KM_REFRESH_RATE, SRT_DEFAULT_KM_PREANNOUNCE, NULL,
+    NULL, GST_SRT_TRANSTYPE_LIVE, SRT_DEFAULT_BITRATE,
+    SRT_DEFAULT_PROFILE, NULL);
+}
+
+/* The socket options "srt-options" can set. The ones with their own
+ * element properties (latency, passphrase, key refresh, stream ID,
+ * bandwidth...) are left out */
+typedef struct
+{
+  const gchar *name;
+  SRT_SOCKOPT opt;
+  GType type;
+} SRTOption;
+
+static const SRTOption srt_options[] = {
+  {"conntimeo", SRTO_CONNTIMEO, G_TYPE_INT},
+  {"peeridletimeo", SRTO_PEERIDLETIMEO, G_TYPE_INT},
+  {"lossmaxttl", SRTO_LOSSMAXTTL, G_TYPE_INT},
+  {"tlpktdrop", SRTO_TLPKTDROP, G_TYPE_BOOLEAN},
+  {"nakreport", SRTO_NAKREPORT, G_TYPE_BOOLEAN},
+  {"snddropdelay", SRTO_SNDDROPDELAY, G_TYPE_INT},
+  {"mss", SRTO_MSS, G_TYPE_INT},
+  {"payloadsize", SRTO_PAYLOADSIZE, G_TYPE_INT},
+  {"fc", SRTO_FC, G_TYPE_INT},
+  {"sndbuf", SRTO_SNDBUF, G_TYPE_INT},
+  {"rcvbuf", SRTO_RCVBUF, G_TYPE_INT},
+  {"udp-sndbuf", SRTO_UDP_SNDBUF, G_TYPE_INT},
+  {"udp-rcvbuf", SRTO_UDP_RCVBUF, G_TYPE_INT},
+  {"iptos", SRTO_IPTOS, G_TYPE_INT},
+  {"ipttl", SRTO_IPTTL, G_TYPE_INT},
+  {"congestion", SRTO_CONGESTION, G_TYPE_STRING},
+  {"messageapi", SRTO_MESSAGEAPI, G_TYPE_BOOLEAN},
+  {"enforcedencryption", SRTO_ENFORCEDENCRYPTION, G_TYPE_BOOLEAN},
+  {NULL, 0, G_TYPE_INVALID}
+};
+
+/* Profiles, as "srt-options" the element's ones are merged over */
+static const gchar *srt_profiles[] = {
+  [GST_SRT_PROFILE_NONE] = NULL,
+  /* Give up on late packets early and notice dead peers quickly */
+  [GST_SRT_PROFILE_LOW_LATENCY] = "low-latency, tlpktdrop=(boolean)true, "
+    "nakreport=(boolean)true, snddropdelay=(int)0, lossmaxttl=(int)0, "
+    "conntimeo=(int)1000, peeridletimeo=(int)2000",
+  /* Large windows and buffers for high bitrates over long links */
+  [GST_SRT_PROFILE_HIGH_THROUGHPUT] = "high-throughput, fc=(int)32768, "
+    "sndbuf=(int)48234496, rcvbuf=(int)48234496, "
+    "udp-sndbuf=(int)16777216, udp-rcvbuf=(int)16777216",
+  /* Tolerate reordering, keep reporting losses and let retransmissions
+   * arrive later */
+  [GST_SRT_PROFILE_LOSSY_LINK] = "lossy-link, lossmaxttl=(int)16, "
+    "nakreport=(boolean)true, snddropdelay=(int)200, "
+    "peeridletimeo=(int)10000",
+};
+
+GType
+gst_srt_profile_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_SRT_PROFILE_NONE, "No profile", "none"},
+    {GST_SRT_PROFILE_LOW_LATENCY, "Low latency", "low-latency"},
+    {GST_SRT_PROFILE_HIGH_THROUGHPUT, "High throughput", "high-throughput"},
+    {GST_SRT_PROFILE_LOSSY_LINK, "Lossy link", "lossy-link"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstSRTProfile", values);
+    g_once_init_leave (&type, tmp);
+  }
+
+  return (GType) type;
+}
+
+static gboolean
+merge_option (GQuark field_id, const GValue * value, gpointer user_data)
+{
+  gst_structure_id_set_value (user_data, field_id, value);
+
+  return TRUE;
+}
+
+/* Returns the options of @profile with @options merged over them, or NULL
+ * if there are none */
+static GstStructure *
+gst_srt_options_new (GstSRTProfile profile, const GstStructure * options)
+{
+  GstStructure *s = NULL;
+
+  if (srt_profiles[profile] != NULL)
+    s = gst_structure_from_string (srt_profiles[profile], NULL);
+
+  if (options == NULL)
+    return s;
+
+  if (s == NULL)
+    return gst_structure_copy (options);
+
+  gst_structure_foreach (options, merge_option, s);
+
+  return s;
+}
+
+typedef struct
+{
+  GstElement *elem;
+  SRTSOCKET sock;
+} ApplyOptionData;
+
+static gboolean
+apply_option (GQuark field_id, const GValue * value, gpointer user_data)
+{
+  ApplyOptionData *data = user_data;
+  const gchar *name = g_quark_to_string (field_id);
+  const SRTOption *opt;
+  GValue v = G_VALUE_INIT;
+  gboolean ret;
+  int i;
+
+  for (opt = srt_options; opt->name; opt++) {
+    if (g_str_equal (opt->name, name))
+      break;
+  }
+
+  if (opt->name == NULL) {
+    GST_ELEMENT_ERROR (data->elem, RESOURCE, SETTINGS, ("Invalid SRT option"),
+      ("unknown SRT option \"%s\"", name));
+    return FALSE;
+  }
+
+  g_value_init (&v, opt->type);
+  if (!g_value_transform (value, &v) && !(G_VALUE_HOLDS_STRING (value)
+      && gst_value_deserialize (&v, g_value_get_string (value)))) {
+    GST_ELEMENT_ERROR (data->elem, RESOURCE, SETTINGS, ("Invalid SRT option"),
+      ("SRT option \"%s\" needs a %s", name, g_type_name (opt->type)));
+    g_value_unset (&v);
+    return FALSE;
+  }
+
+  if (opt->type == G_TYPE_STRING) {
+    const gchar *str = g_value_get_string (&v);
+
+    ret = srt_setsockopt (data->sock, 0, opt->opt, str ? str : "",
+      str ? (int)strlen (str) : 0) != SRT_ERROR;
+  } else {
+    i = opt->type == G_TYPE_BOOLEAN ? g_value_get_boolean (&v)
+      : g_value_get_int (&v);
+    ret = srt_setsockopt (data->sock, 0, opt->opt, &i, sizeof (int))
+      != SRT_ERROR;
+  }
+
+  if (!ret) {
+    GST_ELEMENT_ERROR (data->elem, RESOURCE, SETTINGS, ("Invalid SRT option"),
+      ("failed to set SRT option \"%s\" (reason: %s)", name,
+        srt_getlasterror_str ()));
+  } else {
+    gchar *str = gst_value_serialize (&v);
+    GST_INFO_OBJECT (data->elem, "SRT option %s=%s", name, str);
+    g_free (str);
+  }
+
+  g_value_unset (&v);
+
+  return ret;
+}
+
+/* Sets the socket options of @profile and then the ones in the fields of
+ * @srt_options on @sock. Must be called last before binding or connecting,
+ * so these override the element's own settings. */
+gboolean
+gst_srt_apply_options (GstElement * elem, SRTSOCKET sock,
+  GstSRTProfile profile, const GstStructure * srt_options)
+{
+  ApplyOptionData data = { elem, sock };
+  GstStructure *options = gst_srt_options_new (profile, srt_options);
+  gboolean ret = TRUE;
+
+  if (options != NULL) {
+    ret = gst_structure_foreach (options, apply_option, &data);
+    gst_structure_free (options);
+  }
+
+  return ret;
+}
+
+/* Size of the buffer units SRT counts its buffers in (MSS minus the IP and
+ * UDP headers), and of the MPEG-TS payloads filling them */
+#define SRT_BUFFER_UNIT 1472
+#define SRT_BUFFER_PAYLOAD 1316
+/* Round trip allowance on top of the latency, in milliseconds */
+#define SRT_BUFFER_RTT_ALLOWANCE 200
+/* Headroom for the retransmissions and VBR peaks, in percent */
+#define SRT_BUFFER_HEADROOM 50
+#define SRT_BUFFER_MIN_PACKETS 128
+
+/* Sizes SRTO_FC, SRTO_SNDBUF / SRTO_RCVBUF and the UDP buffers for
+ * @bitrate bits/s held for @latency ms (plus a round trip), following the
+ * libsrt configuration guidelines. Must be called before binding or
+ * connecting. With an unknown bitrate the sender only gets the larger
+ * recommended UDP send buffer. Returns the size of the send buffer in
+ * bytes. */
+int
+gst_srt_set_buffer_sizes (GstElement * elem, SRTSOCKET sock,
+  gboolean is_sender, int latency, gint64 bitrate)
+{
+  gint64 packets;
+  int fc, bytes;
+
+  if (bitrate <= 0) {
+    int send_buff_bytes = SRT_SEND_BUFFER_SIZE;
+
+    if (is_sender)
+      srt_setsockopt (sock, 0, SRTO_UDP_SNDBUF, &send_buff_bytes,
+        sizeof (int));
+    return send_buff_bytes;
+  }
+
+  packets = gst_util_uint64_scale (bitrate / 8,
+    (guint64)(latency + SRT_BUFFER_RTT_ALLOWANCE) *
+    (100 + SRT_BUFFER_HEADROOM), 1000 * 100 * SRT_BUFFER_PAYLOAD);
+  packets = CLAMP (packets, SRT_BUFFER_MIN_PACKETS, G_MAXINT / SRT_BUFFER_UNIT);
+
+  fc = (int)packets;
+  bytes = fc * SRT_BUFFER_UNIT;
+
+  /* The receive buffer can't be larger than the flow control window, so set
+   * that first */
+  srt_setsockopt (sock, 0, SRTO_FC, &fc, sizeof (int));
+  if (is_sender) {
+    srt_setsockopt (sock, 0, SRTO_SNDBUF, &bytes, sizeof (int));
+    srt_setsockopt (sock, 0, SRTO_UDP_SNDBUF, &bytes, sizeof (int));
+  } else {
+    srt_setsockopt (sock, 0, SRTO_RCVBUF, &bytes, sizeof (int));
+    srt_setsockopt (sock, 0, SRTO_UDP_RCVBUF, &bytes, sizeof (int));
+  }
+
+  GST_INFO_OBJECT (elem, "Buffers for %" G_GINT64_FORMAT " bits/s and %d ms: "
+    "%d packets, %d bytes", bitrate, latency, fc, bytes);
+
+  return bytes;
+}
+
+/* Reports the buffer sizes in effect on @sock into @s */
+void
+gst_srt_add_buffer_stats (SRTSOCKET sock, GstStructure * s)
+{
+  int fc = 0, sndbuf = 0, rcvbuf = 0, udp_sndbuf = 0, udp_rcvbuf = 0;
+  int len;
+
+  len = sizeof (int);
+  srt_getsockflag (sock, SRTO_FC, &fc, &len);
+  len = sizeof (int);
+  srt_getsockflag (sock, SRTO_SNDBUF, &sndbuf, &len);
+  len = sizeof (int);
+  srt_getsockflag (sock, SRTO_RCVBUF, &rcvbuf, &len);
+  len = sizeof (int);
+  srt_getsockflag (sock, SRTO_UDP_SNDBUF, &udp_sndbuf, &len);
+  len = sizeof (int);
+  srt_getsockflag (sock, SRTO_UDP_RCVBUF, &udp_rcvbuf, &len);
+
+  gst_structure_set (s,
+    "flow-window-packets", G_TYPE_INT, fc,
+    "send-buffer-bytes", G_TYPE_INT, sndbuf,
+    "recv-buffer-bytes", G_TYPE_INT, rcvbuf,
+    "udp-send-buffer-bytes", G_TYPE_INT, udp_sndbuf,
+    "udp-recv-buffer-bytes", G_TYPE_INT, udp_rcvbuf, NULL);
+}
+
+GType
+gst_srt_transtype_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_SRT_TRANSTYPE_LIVE, "Live streaming, paced by TSBPD", "live"},
+    {GST_SRT_TRANSTYPE_FILE, "File transfer, as fast as the link allows",
+      "file"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstSRTTransType", values);
+    g_once_init_leave (&type, tmp);
+  }
+
+  return (GType) type;
+}
+
+/* Must be called first on a new socket, SRTO_TRANSTYPE resets the options
+ * it covers (TSBPD, linger, congestion control, message API...) to the
+ * defaults of the mode */
+void
+gst_srt_set_transtype (SRTSOCKET sock, GstSRTTransType transtype)
+{
+  SRT_TRANSTYPE type =
+    transtype == GST_SRT_TRANSTYPE_FILE ? SRTT_FILE : SRTT_LIVE;
+
+  srt_setsockopt (sock, 0, SRTO_TRANSTYPE, &type, sizeof (type));
+}
+
+/* Sends @size bytes on @sock, as one message in live mode and as a chunk of
+ * the byte stream in file mode. Returns FALSE with the SRT error set. */
+gboolean
+gst_srt_send (SRTSOCKET sock, GstSRTTransType transtype, const gchar * data,
+  gsize size)
+{
+  if (transtype == GST_SRT_TRANSTYPE_LIVE)
+    return srt_sendmsg2 (sock, data, (int)size, 0) != SRT_ERROR;
+
+  /* The stream API may take only part of the data */
+  while (size > 0) {
+    int sent = srt_send (sock, data, (int)size);
+
+    if (sent == SRT_ERROR)
+      return FALSE;
+    data += sent;
+    size -= sent;
+  }
+
+  return TRUE;
+}
+
+/* Returns the stream ID the peer of @sock connected with, NULL if none */
+gchar *
+gst_srt_get_streamid (SRTSOCKET sock)
+{
+  /* Stream IDs are up to 512 bytes, plus the terminator */
+  char buf[513];
+  int len = sizeof (buf) - 1;
+
+  if (srt_getsockflag (sock, SRTO_STREAMID, buf, &len) == SRT_ERROR
+      || len <= 0)
+    return NULL;
+
+  buf[len] = '\0';
+  return g_strdup (buf);
+}
+
+/* Parses a stream ID in the access control syntax, e.g.
+ * "#!::r=live,m=request,timeshift=30", into a structure with one string
+ * field per key. Returns NULL for any other stream ID. */
+GstStructure *
+gst_srt_parse_streamid (const gchar * streamid)
+{
+  GstStructure *s;
+  gchar **items;
+  guint i;
+
+  if (streamid == NULL || !g_str_has_prefix (streamid, "#!::"))
+    return NULL;
+
+  s = gst_structure_new_empty ("streamid");
+  items = g_strsplit (streamid + 4, ",", -1);
+  for (i = 0; items[i]; i++) {
+    gchar *eq = strchr (items[i], '=');
+
+    if (eq == NULL || eq == items[i])
+      continue;
+
+    *eq = '\0';
+    gst_structure_set (s, items[i], G_TYPE_STRING, eq + 1, NULL);
+  }
+  g_strfreev (items);
+
+  return s;
+}
+
+/* Sets @passphrase and @key_length on @sock, NULL or "" leaves it
+ * unencrypted. The key refresh settings only matter to the sender, which
+ * drives the key switches; 0 keeps the SRT defaults. Must be called before
+ * the socket is connected or bound. */
+void
+gst_srt_set_encryption (GstElement * elem, SRTSOCKET sock,
+  const gchar * passphrase, int key_length, int km_refresh_rate,
+  int km_preannounce)
+{
+  if (passphrase == NULL || passphrase[0] == '\0')
+    return;
+
+  GST_INFO_OBJECT (elem, "Using passphrase");
+  if (srt_setsockopt (sock, 0, SRTO_PASSPHRASE, passphrase,
+      (int)strlen (passphrase)) == SRT_ERROR)
+    GST_WARNING_OBJECT (elem, "Invalid passphrase (reason: %s)",
+      srt_getlasterror_str ());
+  srt_setsockopt (sock, 0, SRTO_PBKEYLEN, &key_length, sizeof (int));
+
+  /* The refresh rate first, the pre-announce must stay below half of it */
+  if (km_refresh_rate > 0 && srt_setsockopt (sock, 0, SRTO_KMREFRESHRATE,
+      &km_refresh_rate, sizeof (int)) == SRT_ERROR)
+    GST_WARNING_OBJECT (elem, "Invalid key refresh rate %d (reason: %s)",
+      km_refresh_rate, srt_getlasterror_str ());
+
+  if (km_preannounce > 0 && srt_setsockopt (sock, 0, SRTO_KMPREANNOUNCE,
+      &km_preannounce, sizeof (int)) == SRT_ERROR)
+    GST_WARNING_OBJECT (elem, "Invalid key pre-announce %d (reason: %s)",
+      km_preannounce, srt_getlasterror_str ());
+}
+
+/* The passphrase of @streamid in @passphrases, whose fields map stream IDs
+ * to passphrases. A "#!::" stream ID is looked up by its "r" (resource)
+ * key first, then any stream ID as a whole. NULL if there is none */
+const gchar *
+gst_srt_lookup_passphrase (const GstStructure * passphrases,
+  const gchar * streamid)
+{
+  GstStructure *parsed;
+  const gchar *passphrase = NULL;
+
+  if (passphrases == NULL || streamid == NULL || streamid[0] == '\0')
+    return NULL;
+
+  parsed = gst_srt_parse_streamid (streamid);
+  if (parsed != NULL) {
+    const gchar *resource = gst_structure_get_string (parsed, "r");
+
+    if (resource != NULL)
+      passphrase = gst_structure_get_string (passphrases, resource);
+    gst_structure_free (parsed);
+  }
+
+  if (passphrase == NULL)
+    passphrase = gst_structure_get_string (passphrases, streamid);
+
+  return passphrase;
+}
+
+/* Configure SRTO_PACKETFILTER (e.g. "fec,cols:10,rows:5") on @sock. Must be
+ * called before the socket is connected or bound, NULL or "" leaves the
+ * filter off. Only one of the peers needs to set it, the other side picks
+ * it up during the handshake. */
+gboolean
+gst_srt_set_packet_filter (GstElement * elem, SRTSOCKET sock,
+  const gchar * packet_filter)
+{
+  if (packet_filter == NULL || packet_filter[0] == '\0')
+    return TRUE;
+
+#ifdef HAVE_SRT_PACKET_FILTER
+  if (srt_setsockopt (sock, 0, SRTO_PACKETFILTER, packet_filter,
+      (int)strlen (packet_filter)) == SRT_ERROR) {
+    GST_ELEMENT_ERROR (elem, RESOURCE, SETTINGS, ("Invalid packet filter"),
+      ("failed to set packet filter \"%s\" (reason: %s)", packet_filter,
+        srt_getlasterror_str ()));
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (elem, "Using packet filter: %s", packet_filter);
+  return TRUE;
+#else
+  GST_ELEMENT_ERROR (elem, LIBRARY, SETTINGS, ("Packet filter unsupported"),
+    ("packet filters need libsrt >= 1.4.0"));
+  return FALSE;
+#endif
+}
+
+void
+gst_srt_interval_stats_init (GstSRTIntervalStats * acc, gboolean sender,
+  GstClockTime elapsed)
+{
+  memset (acc, 0, sizeof (GstSRTIntervalStats));
+  acc->sender = sender;
+  acc->elapsed = (gdouble)elapsed / GST_SECOND;
+  g_value_init (&acc->connections, GST_TYPE_ARRAY);
+}
+
+/* GstSRTSocketFunc reading and clearing the interval counters of @sock */
+void
+gst_srt_interval_stats_add (GstElement * elem, SRTSOCKET sock,
+  GSocketAddress * sockaddr, gpointer user_data)
+{
+  GstSRTIntervalStats *acc = user_data;
+  SRT_TRACEBSTATS stats;
+  GValue v = G_VALUE_INIT;
+  GstStructure *s;
+  gdouble packets, loss, retrans, goodput;
+
+  if (sock == SRT_INVALID_SOCK || acc->elapsed <= 0)
+    return;
+
+  /* Clearing resets only the interval counters, the *Total ones used by the
+   * "stats" property keep accumulating */
+  if (srt_bstats (sock, &stats, 1) < 0) {
+    /* Not GST_DEBUG_OBJECT, describing @elem takes its object lock */
+    GST_DEBUG ("No interval stats for socket %d (reason: %s)",
+      sock, srt_getlasterror_str ());
+    srt_clearlasterror ();
+    return;
+  }
+
+  if (acc->sender) {
+    packets = stats.pktSent / acc->elapsed;
+    loss = stats.pktSndLoss / acc->elapsed;
+    retrans = stats.pktRetrans / acc->elapsed;
+    goodput = (stats.byteSent - stats.byteRetrans) * 8 / acc->elapsed / 1e6;
+  }
+  else {
+    packets = stats.pktRecv / acc->elapsed;
+    loss = stats.pktRcvLoss / acc->elapsed;
+    retrans = stats.pktRcvRetrans / acc->elapsed;
+    goodput = stats.byteRecv * 8 / acc->elapsed / 1e6;
+  }
+
+  s = gst_structure_new ("application/x-srt-interval-statistics",
+    "packets-per-sec", G_TYPE_DOUBLE, packets,
+    "loss-per-sec", G_TYPE_DOUBLE, loss,
+    "retransmit-per-sec", G_TYPE_DOUBLE, retrans,
+    "goodput-mbps", G_TYPE_DOUBLE, goodput,
+    "rtt-ms", G_TYPE_DOUBLE, stats.msRTT, NULL);
+
+  if (sockaddr != NULL) {
+    gst_structure_set (s, "sockaddr", G_TYPE_SOCKET_ADDRESS, sockaddr, NULL);
+    g_value_init (&v, G_TYPE_STRING);
+    g_value_take_string (&v,
+      g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (sockaddr)));
+    gst_structure_take_value (s, "sockaddr-str", &v);
+  }
+
+  g_value_init (&v, GST_TYPE_STRUCTURE);
+  g_value_take_boxed (&v, s);
+  gst_value_array_append_and_take_value (&acc->connections, &v);
+
+  acc->n_connections++;
+  acc->packets_per_sec += packets;
+  acc->loss_per_sec += loss;
+  acc->retransmit_per_sec += retrans;
+  acc->goodput_mbps += goodput;
+  acc->rtt_ms += stats.msRTT;
+}
+
+/* Sums the rates of all the connections, RTT is averaged */
+GstStructure *
+gst_srt_interval_stats_finish (GstSRTIntervalStats * acc)
+{
+  GstStructure *s;
+
+  s = gst_structure_new ("application/x-srt-interval-statistics",
+    "interval-ms", G_TYPE_UINT64, (guint64)(acc->elapsed * 1000),
+    "connections", G_TYPE_UINT, acc->n_connections,
+    "packets-per-sec", G_TYPE_DOUBLE, acc->packets_per_sec,
+    "loss-per-sec", G_TYPE_DOUBLE, acc->loss_per_sec,
+    "retransmit-per-sec", G_TYPE_DOUBLE, acc->retransmit_per_sec,
+    "goodput-mbps", G_TYPE_DOUBLE, acc->goodput_mbps,
+    "rtt-ms", G_TYPE_DOUBLE,
+    acc->n_connections ? acc->rtt_ms / acc->n_connections : 0.0, NULL);
+  gst_structure_take_value (s, "sockets", &acc->connections);
+
+  return s;
+}
+
+void
+gst_srt_key_unit_request_init (GstSRTKeyUnitRequest * req)
+{
+  req->pending = 0;
+  req->last = GST_CLOCK_TIME_NONE;
+  req->count = 0;
+}
+
+/* Asks for a keyframe, from any thread. Requests made before the next
+ * gst_srt_key_unit_request_push() are coalesced into one */
+void
+gst_srt_key_unit_request_mark (GstSRTKeyUnitRequest * req)
+{
+  g_atomic_int_set (&req->pending, 1);
+}
+
+/* Sends a pending request as a GstForceKeyUnit event on @pad, upstream
+ * from a sink pad and downstream from a source pad, unless the previous one
+ * was sent less than @min_interval ago. Built by hand rather than with
+ * libgstvideo, which the plugin doesn't link. Called from the streaming
+ * thread of @pad.
+ *
+ * Returns: whether an event was sent */
+gboolean
+gst_srt_key_unit_request_push (GstSRTKeyUnitRequest * req, GstPad * pad,
+  GstClockTime min_interval)
+{
+  GstClockTime now;
+  GstStructure *s;
+  GstEvent *event;
+
+  if (min_interval == 0 || !g_atomic_int_get (&req->pending))
+    return FALSE;
+
+  now = g_get_monotonic_time () * GST_USECOND;
+  if (req->last != GST_CLOCK_TIME_NONE && now - req->last < min_interval)
+    return FALSE;
+
+  g_atomic_int_set (&req->pending, 0);
+  req->last = now;
+  req->count++;
+
+  s = gst_structure_new ("GstForceKeyUnit",
+    "running-time", GST_TYPE_CLOCK_TIME, GST_CLOCK_TIME_NONE,
+    "all-headers", G_TYPE_BOOLEAN, TRUE,
+    "count", G_TYPE_UINT, req->count, NULL);
+
+  if (GST_PAD_IS_SINK (pad)) {
+    event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM, s);
+  }
+  else {
+    gst_structure_set (s,
+      "timestamp", GST_TYPE_CLOCK_TIME, GST_CLOCK_TIME_NONE,
+      "stream-time", GST_TYPE_CLOCK_TIME, GST_CLOCK_TIME_NONE, NULL);
+    event = gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM, s);
+  }
+
+  GST_DEBUG_OBJECT (pad, "Requesting keyframe %u", req->count);
+  gst_pad_push_event (pad, event);
+
+  return TRUE;
 }
 
 void SRTLogHandler (void* opaque, int level, const char* file, int line, const char* area, const char* message)
@@ -273,6 +896,15 @@ plugin_init (GstPlugin * plugin)
     GST_TYPE_SRT_SERVER_SINK))
     return FALSE;
 
+  if (!gst_element_register (plugin, "srtmergesrc", GST_RANK_NONE,
+    GST_TYPE_SRT_MERGE_SRC))
+    return FALSE;
+
+#if GST_VERSION_MINOR >= 8
+  if (!gst_tracer_register (plugin, "srttracer", GST_TYPE_SRT_TRACER))
+    return FALSE;
+#endif
+
   return TRUE;
 }
 
@@ -33,11 +33,99 @@
 #define SRT_DEFAULT_URI SRT_URI_SCHEME"://"SRT_DEFAULT_HOST":"G_STRINGIFY(SRT_DEFAULT_PORT)
 #define SRT_DEFAULT_LATENCY 125
 #define SRT_DEFAULT_KEY_LENGTH 16
+#define SRT_DEFAULT_STATS_INTERVAL 0
+/* -1 unlimited, 0 relative to the input rate, else bytes/s */
+#define SRT_DEFAULT_MAXBW -1
+/* 0 lets SRT estimate the input rate itself */
+#define SRT_DEFAULT_INPUTBW 0
+#define SRT_DEFAULT_OHEADBW 25
+#define SRT_DEFAULT_AUTO_INPUTBW FALSE
 // Recommended size of the send buffer, in bytes
 #define SRT_SEND_BUFFER_SIZE 1024 * 1024
+/* Expected bitrate in bits/s the buffers are sized for, 0 if unknown */
+#define SRT_DEFAULT_BITRATE 0
+/* Packets sent with a key before switching to a new one, 0 for the SRT
+ * default of 2^24 */
+#define SRT_DEFAULT_KM_REFRESH_RATE 0
+/* Packets before and after a key switch the next key is announced, 0 for
+ * the SRT default of 2^12 */
+#define SRT_DEFAULT_KM_PREANNOUNCE 0
+/* Minimum time between two keyframe requests, in milliseconds */
+#define SRT_DEFAULT_KEYFRAME_REQUEST_INTERVAL 1000
+
+/* srt_time_now() reads the clock SRT_MSGCTRL.srctime is based on */
+#if defined(SRT_VERSION_VALUE) && \
+  SRT_VERSION_VALUE >= SRT_MAKE_VERSION_VALUE (1, 4, 2)
+#define HAVE_SRT_TIME_NOW 1
+#endif
+
+/* SRTO_PACKETFILTER and the built-in FEC filter */
+#if defined(SRT_VERSION_VALUE) && \
+  SRT_VERSION_VALUE >= SRT_MAKE_VERSION_VALUE (1, 4, 0)
+#define HAVE_SRT_PACKET_FILTER 1
+#endif
+
+/* srt_listen_callback(), to set options on the sockets being accepted */
+#if defined(SRT_VERSION_VALUE) && \
+  SRT_VERSION_VALUE >= SRT_MAKE_VERSION_VALUE (1, 4, 2)
+#define HAVE_SRT_LISTEN_CALLBACK 1
+#endif
 
 G_BEGIN_DECLS
 
+/* Live mode sends messages paced by TSBPD, file mode a byte stream as fast
+ * as the file congestion controller allows */
+typedef enum
+{
+  GST_SRT_TRANSTYPE_LIVE,
+  GST_SRT_TRANSTYPE_FILE,
+} GstSRTTransType;
+
+#define SRT_DEFAULT_TRANSTYPE GST_SRT_TRANSTYPE_LIVE
+
+#define GST_TYPE_SRT_TRANSTYPE (gst_srt_transtype_get_type ())
+GType gst_srt_transtype_get_type (void);
+
+/* Named sets of "srt-options" */
+typedef enum
+{
+  GST_SRT_PROFILE_NONE,
+  GST_SRT_PROFILE_LOW_LATENCY,
+  GST_SRT_PROFILE_HIGH_THROUGHPUT,
+  GST_SRT_PROFILE_LOSSY_LINK,
+} GstSRTProfile;
+
+#define SRT_DEFAULT_PROFILE GST_SRT_PROFILE_NONE
+
+#define GST_TYPE_SRT_PROFILE (gst_srt_profile_get_type ())
+GType gst_srt_profile_get_type (void);
+
+typedef void (*GstSRTSocketFunc) (GstElement * elem, SRTSOCKET sock,
+  GSocketAddress * sockaddr, gpointer user_data);
+
+/* Accumulates the per-interval rates of one or more sockets of an element
+ * into the structure posted by the "stats-interval" timer */
+typedef struct _GstSRTIntervalStats
+{
+  gboolean sender;
+  gdouble elapsed;
+  GValue connections;
+  guint n_connections;
+  gdouble packets_per_sec;
+  gdouble loss_per_sec;
+  gdouble retransmit_per_sec;
+  gdouble goodput_mbps;
+  gdouble rtt_ms;
+} GstSRTIntervalStats;
+
+/* Rate limited keyframe requests, see gst_srt_key_unit_request_push() */
+typedef struct _GstSRTKeyUnitRequest
+{
+  gint pending;
+  GstClockTime last;
+  guint count;
+} GstSRTKeyUnitRequest;
+
 SRTSOCKET
 gst_srt_client_connect(GstElement * elem, int sender,
   const gchar * host, guint16 port, int rendez_vous,
@@ -49,7 +137,68 @@ gst_srt_client_connect_full(GstElement * elem, gboolean sender,
   const gchar * host, guint16 port, gboolean rendezvous,
   const gchar * bind_address, guint16 bind_port, int latency,
   GSocketAddress ** socket_address, gint * poll_id,
-  gchar * passphrase, int key_length);
+  gchar * passphrase, int key_length, int km_refresh_rate,
+  int km_preannounce, const gchar * streamid, const gchar * packet_filter,
+  GstSRTTransType transtype, gint64 bitrate, GstSRTProfile profile,
+  const GstStructure * srt_options);
+
+gboolean
+gst_srt_apply_options (GstElement * elem, SRTSOCKET sock,
+  GstSRTProfile profile, const GstStructure * srt_options);
+
+void
+gst_srt_set_transtype (SRTSOCKET sock, GstSRTTransType transtype);
+
+gboolean
+gst_srt_send (SRTSOCKET sock, GstSRTTransType transtype, const gchar * data,
+  gsize size);
+
+gchar *
+gst_srt_get_streamid (SRTSOCKET sock);
+
+GstStructure *
+gst_srt_parse_streamid (const gchar * streamid);
+
+void
+gst_srt_set_encryption (GstElement * elem, SRTSOCKET sock,
+  const gchar * passphrase, int key_length, int km_refresh_rate,
+  int km_preannounce);
+
+const gchar *
+gst_srt_lookup_passphrase (const GstStructure * passphrases,
+  const gchar * streamid);
+
+gboolean
+gst_srt_set_packet_filter (GstElement * elem, SRTSOCKET sock,
+  const gchar * packet_filter);
+
+int
+gst_srt_set_buffer_sizes (GstElement * elem, SRTSOCKET sock,
+  gboolean is_sender, int latency, gint64 bitrate);
+
+void
+gst_srt_add_buffer_stats (SRTSOCKET sock, GstStructure * s);
+
+void
+gst_srt_interval_stats_init (GstSRTIntervalStats * acc, gboolean sender,
+  GstClockTime elapsed);
+
+void
+gst_srt_interval_stats_add (GstElement * elem, SRTSOCKET sock,
+  GSocketAddress * sockaddr, gpointer user_data);
+
+GstStructure *
+gst_srt_interval_stats_finish (GstSRTIntervalStats * acc);
+
+void
+gst_srt_key_unit_request_init (GstSRTKeyUnitRequest * req);
+
+void
+gst_srt_key_unit_request_mark (GstSRTKeyUnitRequest * req);
+
+gboolean
+gst_srt_key_unit_request_push (GstSRTKeyUnitRequest * req, GstPad * pad,
+  GstClockTime min_interval);
 
 G_END_DECLS
 
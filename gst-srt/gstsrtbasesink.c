@@ -25,6 +25,8 @@
 #endif
 
 #include "gstsrtserversink.h"
+#include "gstsrtmetrics.h"
+#include "gstsrtreactor.h"
 #include "gstsrt.h"
 #include <srt.h>
 
@@ -39,12 +41,41 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_KM_REFRESH_RATE,
+  PROP_KM_PREANNOUNCE,
+  PROP_STATS_INTERVAL,
+  PROP_PACKET_FILTER,
+  PROP_TRANSTYPE,
+  PROP_BITRATE,
+  PROP_SRT_OPTIONS,
+  PROP_PROFILE,
+  PROP_CPU_AFFINITY,
+  PROP_NUMA_NODE,
+  PROP_THREAD_NICE,
+  PROP_THREAD_RT_PRIORITY,
+  PROP_KEYFRAME_REQUEST_INTERVAL,
+  PROP_MAXBW,
+  PROP_INPUTBW,
+  PROP_OHEADBW,
+  PROP_AUTO_INPUTBW,
+  PROP_RECORD_LOCATION,
+  PROP_RECORD_MAX_SIZE,
+  PROP_RECORD_MAX_TIME,
+  PROP_RECORD_DIRECT_IO,
+  PROP_STRIP_NULL_PACKETS,
   /*< private > */
   PROP_LAST
 };
 
 static GParamSpec *properties[PROP_LAST];
 
+/* "auto-inputbw" measures the input rate over windows of this duration */
+#define SRT_INPUTBW_WINDOW (GST_SECOND)
+/* and only updates the sockets when it moved by more than 1/N */
+#define SRT_INPUTBW_THRESHOLD 10
+
+static void gst_srt_base_sink_update_bandwidth (GstSRTBaseSink * self);
+
 static void gst_srt_base_sink_uri_handler_init (gpointer g_iface,
   gpointer iface_data);
 static gchar *gst_srt_base_sink_uri_get_uri (GstURIHandler * handler);
@@ -82,6 +113,72 @@ gst_srt_base_sink_get_property (GObject * object,
   case PROP_KEY_LENGTH:
     g_value_set_int (value, self->key_length);
     break;
+  case PROP_KM_REFRESH_RATE:
+    g_value_set_int (value, self->km_refresh_rate);
+    break;
+  case PROP_KM_PREANNOUNCE:
+    g_value_set_int (value, self->km_preannounce);
+    break;
+  case PROP_STATS_INTERVAL:
+    g_value_set_int (value, self->stats_interval);
+    break;
+  case PROP_PACKET_FILTER:
+    g_value_set_string (value, self->packet_filter);
+    break;
+  case PROP_TRANSTYPE:
+    g_value_set_enum (value, self->transtype);
+    break;
+  case PROP_BITRATE:
+    g_value_set_int64 (value, self->bitrate);
+    break;
+  case PROP_SRT_OPTIONS:
+    gst_value_set_structure (value, self->srt_options);
+    break;
+  case PROP_PROFILE:
+    g_value_set_enum (value, self->profile);
+    break;
+  case PROP_CPU_AFFINITY:
+    g_value_set_string (value, self->thread_config.cpus);
+    break;
+  case PROP_NUMA_NODE:
+    g_value_set_int (value, self->thread_config.numa_node);
+    break;
+  case PROP_THREAD_NICE:
+    g_value_set_int (value, self->thread_config.nice);
+    break;
+  case PROP_THREAD_RT_PRIORITY:
+    g_value_set_int (value, self->thread_config.rt_priority);
+    break;
+  case PROP_KEYFRAME_REQUEST_INTERVAL:
+    g_value_set_int (value, g_atomic_int_get (&self->keyframe_request_interval));
+    break;
+  case PROP_MAXBW:
+    g_value_set_int64 (value, self->maxbw);
+    break;
+  case PROP_INPUTBW:
+    g_value_set_int64 (value, self->inputbw);
+    break;
+  case PROP_OHEADBW:
+    g_value_set_int (value, self->oheadbw);
+    break;
+  case PROP_AUTO_INPUTBW:
+    g_value_set_boolean (value, self->auto_inputbw);
+    break;
+  case PROP_RECORD_LOCATION:
+    g_value_set_string (value, self->record_location);
+    break;
+  case PROP_RECORD_MAX_SIZE:
+    g_value_set_uint64 (value, self->record_max_size);
+    break;
+  case PROP_RECORD_MAX_TIME:
+    g_value_set_uint64 (value, self->record_max_time);
+    break;
+  case PROP_RECORD_DIRECT_IO:
+    g_value_set_boolean (value, self->record_direct_io);
+    break;
+  case PROP_STRIP_NULL_PACKETS:
+    g_value_set_boolean (value, self->strip_null_packets);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -115,6 +212,91 @@ gst_srt_base_sink_set_property (GObject * object,
     self->key_length = key_length;
     break;
   }
+  case PROP_KM_REFRESH_RATE:
+    self->km_refresh_rate = g_value_get_int (value);
+    break;
+  case PROP_KM_PREANNOUNCE:
+    self->km_preannounce = g_value_get_int (value);
+    break;
+  case PROP_STATS_INTERVAL:
+    self->stats_interval = g_value_get_int (value);
+    break;
+  case PROP_PACKET_FILTER:
+    g_free (self->packet_filter);
+    self->packet_filter = g_value_dup_string (value);
+    break;
+  case PROP_TRANSTYPE:
+    self->transtype = g_value_get_enum (value);
+    break;
+  case PROP_BITRATE:
+    self->bitrate = g_value_get_int64 (value);
+    break;
+  case PROP_SRT_OPTIONS:
+  {
+    const GstStructure *s = gst_value_get_structure (value);
+
+    g_clear_pointer (&self->srt_options, gst_structure_free);
+    if (s)
+      self->srt_options = gst_structure_copy (s);
+    break;
+  }
+  case PROP_PROFILE:
+    self->profile = g_value_get_enum (value);
+    break;
+  case PROP_CPU_AFFINITY:
+    g_free (self->thread_config.cpus);
+    self->thread_config.cpus = g_value_dup_string (value);
+    break;
+  case PROP_NUMA_NODE:
+    self->thread_config.numa_node = g_value_get_int (value);
+    break;
+  case PROP_THREAD_NICE:
+    self->thread_config.nice = g_value_get_int (value);
+    break;
+  case PROP_THREAD_RT_PRIORITY:
+    self->thread_config.rt_priority = g_value_get_int (value);
+    break;
+  case PROP_KEYFRAME_REQUEST_INTERVAL:
+    g_atomic_int_set (&self->keyframe_request_interval,
+      g_value_get_int (value));
+    break;
+  case PROP_MAXBW:
+    GST_OBJECT_LOCK (self);
+    self->maxbw = g_value_get_int64 (value);
+    GST_OBJECT_UNLOCK (self);
+    gst_srt_base_sink_update_bandwidth (self);
+    break;
+  case PROP_INPUTBW:
+    GST_OBJECT_LOCK (self);
+    self->inputbw = g_value_get_int64 (value);
+    GST_OBJECT_UNLOCK (self);
+    gst_srt_base_sink_update_bandwidth (self);
+    break;
+  case PROP_OHEADBW:
+    GST_OBJECT_LOCK (self);
+    self->oheadbw = g_value_get_int (value);
+    GST_OBJECT_UNLOCK (self);
+    gst_srt_base_sink_update_bandwidth (self);
+    break;
+  case PROP_AUTO_INPUTBW:
+    self->auto_inputbw = g_value_get_boolean (value);
+    break;
+  case PROP_RECORD_LOCATION:
+    g_free (self->record_location);
+    self->record_location = g_value_dup_string (value);
+    break;
+  case PROP_RECORD_MAX_SIZE:
+    self->record_max_size = g_value_get_uint64 (value);
+    break;
+  case PROP_RECORD_MAX_TIME:
+    self->record_max_time = g_value_get_uint64 (value);
+    break;
+  case PROP_RECORD_DIRECT_IO:
+    self->record_direct_io = g_value_get_boolean (value);
+    break;
+  case PROP_STRIP_NULL_PACKETS:
+    self->strip_null_packets = g_value_get_boolean (value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -129,22 +311,139 @@ gst_srt_base_sink_finalize (GObject * object)
   g_clear_pointer (&self->headers, gst_buffer_list_unref);
   g_clear_pointer (&self->uri, gst_uri_unref);
   g_clear_pointer (&self->passphrase, g_free);
+  g_clear_pointer (&self->packet_filter, g_free);
+  g_clear_pointer (&self->srt_options, gst_structure_free);
+  g_clear_pointer (&self->record_location, g_free);
+  g_clear_pointer (&self->strip_buf, g_free);
+  gst_srt_thread_config_clear (&self->thread_config);
 
-  srt_cleanup ();
-  GST_INFO_OBJECT (self, "SRT cleanup");
+  gst_srt_runtime_unref ();
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static gboolean
-gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+gst_srt_base_sink_stats_tick (GstClock * clock, GstClockTime time,
+  GstClockID id, gpointer user_data)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (user_data);
+  GstSRTBaseSinkClass *bclass = GST_SRT_BASE_SINK_GET_CLASS (self);
+  GstSRTIntervalStats acc;
+  GstClockTime now = gst_clock_get_time (clock);
+
+  gst_srt_interval_stats_init (&acc, TRUE, now - self->stats_last_time);
+  self->stats_last_time = now;
+
+  if (bclass->foreach_socket)
+    bclass->foreach_socket (self, gst_srt_interval_stats_add, &acc);
+
+  gst_element_post_message (GST_ELEMENT_CAST (self),
+    gst_message_new_element (GST_OBJECT_CAST (self),
+      gst_srt_interval_stats_finish (&acc)));
+
+  return TRUE;
+}
+
+static void
+gst_srt_base_sink_start_stats_timer (GstSRTBaseSink * self)
+{
+  GstClock *clock;
+  GstClockTime interval;
+
+  if (self->stats_interval <= 0)
+    return;
+
+  interval = self->stats_interval * GST_MSECOND;
+  clock = gst_system_clock_obtain ();
+  self->stats_last_time = gst_clock_get_time (clock);
+  self->stats_clock_id = gst_clock_new_periodic_id (clock,
+    self->stats_last_time + interval, interval);
+  gst_object_unref (clock);
+
+  GST_DEBUG_OBJECT (self, "Posting stats every %d ms", self->stats_interval);
+  gst_clock_id_wait_async (self->stats_clock_id, gst_srt_base_sink_stats_tick,
+    gst_object_ref (self), (GDestroyNotify)gst_object_unref);
+}
+
+static void
+gst_srt_base_sink_stop_stats_timer (GstSRTBaseSink * self)
+{
+  if (self->stats_clock_id == NULL)
+    return;
+
+  gst_clock_id_unschedule (self->stats_clock_id);
+  gst_clock_id_unref (self->stats_clock_id);
+  self->stats_clock_id = NULL;
+}
+
+static GstStateChangeReturn
+gst_srt_base_sink_change_state (GstElement * element,
+  GstStateChange transition)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (element);
+  GstStateChangeReturn ret;
+
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    gst_srt_key_unit_request_init (&self->key_unit);
+
+    if (self->record_location && self->record_location[0] != '\0') {
+      GError *error = NULL;
+
+      self->recorder = gst_srt_recorder_new (element, self->record_location,
+        self->record_max_size, self->record_max_time, self->record_direct_io,
+        &self->thread_config, &error);
+      if (self->recorder == NULL) {
+        GST_ELEMENT_ERROR (self, RESOURCE, OPEN_WRITE,
+          ("Failed to start the recording"), ("%s", error->message));
+        g_clear_error (&error);
+        return GST_STATE_CHANGE_FAILURE;
+      }
+    }
+  }
+
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    gst_srt_base_sink_stop_stats_timer (self);
+    gst_srt_metrics_unregister (element);
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  /* The streaming thread is stopped, flush and close the recording */
+  if (self->recorder && (transition == GST_STATE_CHANGE_PAUSED_TO_READY
+      || (transition == GST_STATE_CHANGE_READY_TO_PAUSED
+        && ret == GST_STATE_CHANGE_FAILURE)))
+    g_clear_pointer (&self->recorder, gst_srt_recorder_free);
+
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    gst_srt_base_sink_start_stats_timer (self);
+    gst_srt_metrics_register (element);
+  }
+
+  return ret;
+}
+
+/**
+ * gst_srt_base_sink_parse_streamheader:
+ * @self: a #GstSRTBaseSink
+ * @caps: the caps of a sink pad
+ * @headers: (out) (transfer full): the stream headers, %NULL if the caps
+ *   have none
+ *
+ * Collects the buffers of the "streamheader" field of @caps, which are
+ * sent to every client before the stream.
+ *
+ * Returns: %FALSE if the field holds anything but buffers.
+ */
+gboolean
+gst_srt_base_sink_parse_streamheader (GstSRTBaseSink * self, GstCaps * caps,
+  GstBufferList ** headers)
 {
-  GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
   GstStructure *s;
   const GValue *streamheader;
 
-  GST_DEBUG_OBJECT (self, "setcaps %" GST_PTR_FORMAT, caps);
-
-  g_clear_pointer (&self->headers, gst_buffer_list_unref);
+  *headers = NULL;
 
   s = gst_caps_get_structure (caps, 0);
   streamheader = gst_structure_get_value (s, "streamheader");
@@ -154,8 +453,8 @@ gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   }
   else if (GST_VALUE_HOLDS_BUFFER (streamheader)) {
     GST_DEBUG_OBJECT (self, "'streamheader' field holds buffer");
-    self->headers = gst_buffer_list_new_sized (1);
-    gst_buffer_list_add (self->headers, g_value_dup_boxed (streamheader));
+    *headers = gst_buffer_list_new_sized (1);
+    gst_buffer_list_add (*headers, g_value_dup_boxed (streamheader));
   }
   else if (GST_VALUE_HOLDS_ARRAY (streamheader)) {
     guint i, size;
@@ -163,17 +462,18 @@ gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
     GST_DEBUG_OBJECT (self, "'streamheader' field holds array");
 
     size = gst_value_array_get_size (streamheader);
-    self->headers = gst_buffer_list_new_sized (size);
+    *headers = gst_buffer_list_new_sized (size);
 
     for (i = 0; i < size; i++) {
       const GValue *v = gst_value_array_get_value (streamheader, i);
       if (!GST_VALUE_HOLDS_BUFFER (v)) {
         GST_ERROR_OBJECT (self, "'streamheader' item of unexpected type '%s'",
           G_VALUE_TYPE_NAME (v));
+        g_clear_pointer (headers, gst_buffer_list_unref);
         return FALSE;
       }
 
-      gst_buffer_list_add (self->headers, g_value_dup_boxed (v));
+      gst_buffer_list_add (*headers, g_value_dup_boxed (v));
     }
   }
   else {
@@ -183,7 +483,25 @@ gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   }
 
   GST_DEBUG_OBJECT (self, "Collected streamheaders: %u buffers",
-    self->headers ? gst_buffer_list_length (self->headers) : 0);
+    *headers ? gst_buffer_list_length (*headers) : 0);
+
+  return TRUE;
+}
+
+static gboolean
+gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
+
+  GST_DEBUG_OBJECT (self, "setcaps %" GST_PTR_FORMAT, caps);
+
+  g_clear_pointer (&self->headers, gst_buffer_list_unref);
+
+  if (!gst_srt_base_sink_parse_streamheader (self, caps, &self->headers))
+    return FALSE;
+
+  if (self->recorder)
+    gst_srt_recorder_set_headers (self->recorder, self->headers);
 
   return TRUE;
 }
@@ -195,17 +513,193 @@ gst_srt_base_sink_stop (GstBaseSink * sink)
 
   g_clear_pointer (&self->headers, gst_buffer_list_unref);
 
+  GST_OBJECT_LOCK (self);
+  self->measured_inputbw = 0;
+  self->applied_inputbw = 0;
+  self->inputbw_bytes = 0;
+  self->inputbw_start = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (self);
+
   return TRUE;
 }
 
+typedef struct
+{
+  int64_t maxbw;
+  int64_t inputbw;
+  int oheadbw;
+} SRTBandwidth;
+
+static void
+gst_srt_base_sink_get_bandwidth (GstSRTBaseSink * self, SRTBandwidth * bw)
+{
+  GST_OBJECT_LOCK (self);
+  bw->maxbw = self->maxbw;
+  bw->inputbw = self->inputbw;
+  if (self->auto_inputbw && self->measured_inputbw > 0)
+    bw->inputbw = self->measured_inputbw;
+  bw->oheadbw = self->oheadbw;
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* GstSRTSocketFunc, foreach_socket may hold the object lock */
+static void
+gst_srt_base_sink_set_bandwidth (GstElement * elem, SRTSOCKET sock,
+  GSocketAddress * sockaddr, gpointer user_data)
+{
+  SRTBandwidth *bw = user_data;
+
+  srt_setsockflag (sock, SRTO_MAXBW, &bw->maxbw, sizeof (int64_t));
+  srt_setsockflag (sock, SRTO_INPUTBW, &bw->inputbw, sizeof (int64_t));
+  srt_setsockflag (sock, SRTO_OHEADBW, &bw->oheadbw, sizeof (int));
+}
+
+static void
+gst_srt_base_sink_update_bandwidth (GstSRTBaseSink * self)
+{
+  GstSRTBaseSinkClass *bclass = GST_SRT_BASE_SINK_GET_CLASS (self);
+  SRTBandwidth bw;
+
+  if (bclass->foreach_socket == NULL)
+    return;
+
+  gst_srt_base_sink_get_bandwidth (self, &bw);
+  bclass->foreach_socket (self, gst_srt_base_sink_set_bandwidth, &bw);
+}
+
+/* Pushes a new input rate estimate to all the sockets if it moved enough */
+static void
+gst_srt_base_sink_update_inputbw (GstSRTBaseSink * self, gint64 inputbw)
+{
+  gint64 applied;
+
+  GST_OBJECT_LOCK (self);
+  self->measured_inputbw = inputbw;
+  applied = self->applied_inputbw;
+  if (ABS (inputbw - applied) <= applied / SRT_INPUTBW_THRESHOLD) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+  self->applied_inputbw = inputbw;
+  GST_OBJECT_UNLOCK (self);
+
+  GST_DEBUG_OBJECT (self, "Input rate now %" G_GINT64_FORMAT " bytes/s",
+    inputbw);
+
+  gst_srt_base_sink_update_bandwidth (self);
+}
+
+/* Averages the input rate over SRT_INPUTBW_WINDOW of running time */
+static void
+gst_srt_base_sink_measure_inputbw (GstSRTBaseSink * self, gsize size)
+{
+  GstClockTime now = self->render_running_time;
+  gint64 rate, measured;
+
+  if (now == GST_CLOCK_TIME_NONE)
+    return;
+
+  if (self->inputbw_start == GST_CLOCK_TIME_NONE || now < self->inputbw_start) {
+    self->inputbw_start = now;
+    self->inputbw_bytes = 0;
+  }
+
+  self->inputbw_bytes += size;
+  if (now - self->inputbw_start < SRT_INPUTBW_WINDOW)
+    return;
+
+  rate = gst_util_uint64_scale (self->inputbw_bytes, GST_SECOND,
+    now - self->inputbw_start);
+  self->inputbw_start = now;
+  self->inputbw_bytes = 0;
+
+  GST_OBJECT_LOCK (self);
+  measured = self->measured_inputbw;
+  GST_OBJECT_UNLOCK (self);
+
+  /* Smooth out the bursts of VBR streams */
+  if (measured > 0)
+    rate = (3 * measured + rate) / 4;
+
+  gst_srt_base_sink_update_inputbw (self, rate);
+}
+
+static gboolean
+gst_srt_base_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_TAG && self->auto_inputbw) {
+    GstTagList *tags;
+    guint bitrate = 0;
+    gint64 measured;
+
+    gst_event_parse_tag (event, &tags);
+    if (!gst_tag_list_get_uint (tags, GST_TAG_BITRATE, &bitrate))
+      gst_tag_list_get_uint (tags, GST_TAG_NOMINAL_BITRATE, &bitrate);
+
+    GST_OBJECT_LOCK (self);
+    measured = self->measured_inputbw;
+    GST_OBJECT_UNLOCK (self);
+
+    /* Only a first guess until the rate was measured */
+    if (bitrate > 0 && measured == 0) {
+      GST_DEBUG_OBJECT (self, "Input rate from tags: %u bits/s", bitrate);
+      gst_srt_base_sink_update_inputbw (self, bitrate / 8);
+    }
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
+/**
+ * gst_srt_base_sink_strip_null_packets:
+ * @self: a #GstSRTBaseSink
+ * @info: the mapped message to send
+ * @strip_buf: (inout): staging buffer of the pad, grown as needed
+ * @strip_buf_size: (inout): allocated size of @strip_buf
+ *
+ * Points @info to the message without its null packets, staged in
+ * @strip_buf, if #GstSRTBaseSink:strip-null-packets is set in live mode
+ * and the message has any. Each pad streaming on its own thread needs its
+ * own staging buffer.
+ */
+void
+gst_srt_base_sink_strip_null_packets (GstSRTBaseSink * self,
+  GstMapInfo * info, guint8 ** strip_buf, gsize * strip_buf_size)
+{
+  gsize size;
+
+  /* Message boundaries are only kept in live mode */
+  if (!self->strip_null_packets || self->transtype != GST_SRT_TRANSTYPE_LIVE)
+    return;
+
+  if (*strip_buf_size < info->size) {
+    *strip_buf = g_realloc (*strip_buf, info->size);
+    *strip_buf_size = info->size;
+  }
+
+  size = gst_srt_ts_strip_null_packets (info->data, info->size, *strip_buf);
+  if (size == 0)
+    return;
+
+  GST_LOG_OBJECT (self, "Stripped null packets, %" G_GSIZE_FORMAT
+    " of %" G_GSIZE_FORMAT " bytes left", size, info->size);
+  info->data = *strip_buf;
+  info->size = size;
+}
+
 static GstFlowReturn
 gst_srt_base_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
-  GstMapInfo info;
+  GstMapInfo info, send_info;
   GstSRTBaseSinkClass *bclass = GST_SRT_BASE_SINK_GET_CLASS (sink);
   GstFlowReturn ret = GST_FLOW_OK;
 
+  gst_srt_key_unit_request_push (&self->key_unit, GST_BASE_SINK_PAD (sink),
+    g_atomic_int_get (&self->keyframe_request_interval) * GST_MSECOND);
+
   if (self->headers && GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER)) {
     GST_DEBUG_OBJECT (self, "Have streamheaders,"
       " ignoring header %" GST_PTR_FORMAT, buffer);
@@ -229,7 +723,25 @@ gst_srt_base_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 
   }
 
-  if (!bclass->send_buffer (self, &info))
+  self->render_running_time = GST_CLOCK_TIME_NONE;
+  if (GST_BUFFER_DTS_OR_PTS (buffer) != GST_CLOCK_TIME_NONE)
+    self->render_running_time = gst_segment_to_running_time (&sink->segment,
+      GST_FORMAT_TIME, GST_BUFFER_DTS_OR_PTS (buffer));
+  self->render_keyframe =
+    !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  /* The recording shares the buffer rather than a copy of it */
+  if (self->recorder)
+    gst_srt_recorder_push (self->recorder, buffer, self->render_running_time);
+
+  send_info = info;
+  gst_srt_base_sink_strip_null_packets (self, &send_info, &self->strip_buf,
+    &self->strip_buf_size);
+
+  if (self->auto_inputbw)
+    gst_srt_base_sink_measure_inputbw (self, send_info.size);
+
+  if (!bclass->send_buffer (self, &send_info))
     ret = GST_FLOW_ERROR;
 
   gst_buffer_unmap (buffer, &info);
@@ -241,6 +753,7 @@ static void
 gst_srt_base_sink_class_init (GstSRTBaseSinkClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSinkClass *gstbasesink_class = GST_BASE_SINK_CLASS (klass);
 
   gobject_class->set_property = gst_srt_base_sink_set_property;
@@ -271,10 +784,307 @@ gst_srt_base_sink_class_init (GstSRTBaseSinkClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+    * GstSRTBaseSink:km-refresh-rate:
+    *
+    * Number of packets the sender encrypts with a key before switching to
+    * a new one (SRTO_KMREFRESHRATE). Shorter refreshes limit what a leaked
+    * key exposes, at the cost of more key material exchanges. 0 keeps the
+    * SRT default of 2^24 packets.
+    */
+  properties[PROP_KM_REFRESH_RATE] =
+    g_param_spec_int ("km-refresh-rate", "Key Refresh Rate",
+      "Packets sent with a key before switching keys (0 = SRT default)",
+      0, G_MAXINT32, SRT_DEFAULT_KM_REFRESH_RATE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:km-preannounce:
+    *
+    * Number of packets before and after a key switch during which the
+    * sender announces the next key (SRTO_KMPREANNOUNCE), giving the
+    * receiver time to decode it. Must be below half of
+    * #GstSRTBaseSink:km-refresh-rate. 0 keeps the SRT default of 2^12.
+    */
+  properties[PROP_KM_PREANNOUNCE] =
+    g_param_spec_int ("km-preannounce", "Key Pre-announce",
+      "Packets around a key switch the next key is announced for "
+      "(0 = SRT default)", 0, G_MAXINT32, SRT_DEFAULT_KM_PREANNOUNCE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:stats-interval:
+    *
+    * Interval in milliseconds at which an "application/x-srt-interval-statistics"
+    * element message with the rates measured since the previous one is
+    * posted on the bus. 0 disables the messages.
+    */
+  properties[PROP_STATS_INTERVAL] =
+    g_param_spec_int ("stats-interval", "Stats Interval",
+      "Interval between statistics messages in milliseconds (0 = disabled)",
+      0, G_MAXINT32, SRT_DEFAULT_STATS_INTERVAL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:packet-filter:
+    *
+    * SRT packet filter configuration, e.g. "fec,cols:10,rows:5" to protect
+    * the stream with row/column FEC. Only one of the peers needs to set it,
+    * the handshake rejects the connection if both sides set incompatible
+    * configurations. Requires libsrt >= 1.4.0.
+    */
+  properties[PROP_PACKET_FILTER] =
+    g_param_spec_string ("packet-filter", "Packet Filter",
+      "SRT packet filter configuration (e.g. fec,cols:10,rows:5)", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:transtype:
+    *
+    * "live" paces the messages by TSBPD, with the latency as the delivery deadline.
+    * "file" uses the file congestion controller and the stream API, so bulk
+    * transfers run as fast as the link allows, without message boundaries,
+    * loss or drops. Both peers must use the same mode.
+    */
+  properties[PROP_TRANSTYPE] =
+    g_param_spec_enum ("transtype", "Transmission Type",
+      "Live streaming or file transfer", GST_TYPE_SRT_TRANSTYPE,
+      SRT_DEFAULT_TRANSTYPE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:bitrate:
+    *
+    * Expected bitrate of the stream in bits/s. Together with the latency it
+    * sizes the SRT and UDP buffers and the flow control window, which the
+    * stats report. 0 keeps the libsrt defaults, unless
+    * #GstSRTBaseSink:inputbw or an absolute #GstSRTBaseSink:maxbw is set.
+    */
+  properties[PROP_BITRATE] =
+    g_param_spec_int64 ("bitrate", "Bitrate",
+      "Expected bitrate in bits/s to size the buffers for (0 = unknown)",
+      0, G_MAXINT64, SRT_DEFAULT_BITRATE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:srt-options:
+    *
+    * Extra SRT socket options, one field per option named after it without
+    * the SRTO_ prefix, e.g. "srt, lossmaxttl=(int)16, nakreport=true".
+    * Applied last before binding or connecting, over the
+    * #GstSRTBaseSink:profile and the element's own settings.
+    */
+  properties[PROP_SRT_OPTIONS] =
+    g_param_spec_boxed ("srt-options", "SRT Options",
+      "Extra SRT socket options", GST_TYPE_STRUCTURE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:profile:
+    *
+    * Named set of socket options tuned for low latency, high throughput or
+    * lossy links. #GstSRTBaseSink:srt-options override single options of it.
+    */
+  properties[PROP_PROFILE] =
+    g_param_spec_enum ("profile", "Profile", "SRT tuning profile",
+      GST_TYPE_SRT_PROFILE, SRT_DEFAULT_PROFILE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:maxbw:
+    *
+    * Maximum sending bandwidth in bytes/s, retransmissions included. -1
+    * leaves it unlimited, 0 makes it relative: #GstSRTBaseSink:inputbw plus
+    * #GstSRTBaseSink:oheadbw percent of headroom. srtserversink defaults
+    * to 0, srtclientsink to -1.
+    */
+  properties[PROP_MAXBW] =
+    g_param_spec_int64 ("maxbw", "Maximum Bandwidth",
+      "Maximum sending bandwidth in bytes/s (-1 = unlimited, "
+      "0 = relative to the input rate)", -1, G_MAXINT64, SRT_DEFAULT_MAXBW,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:inputbw:
+    *
+    * Input rate of the stream in bytes/s that a relative
+    * #GstSRTBaseSink:maxbw is based on. 0 lets SRT estimate it from the
+    * buffers it is handed.
+    */
+  properties[PROP_INPUTBW] =
+    g_param_spec_int64 ("inputbw", "Input Bandwidth",
+      "Input rate in bytes/s (0 = estimated by SRT)", 0, G_MAXINT64,
+      SRT_DEFAULT_INPUTBW,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:oheadbw:
+    *
+    * Headroom for retransmissions in percent of the input rate, on top of
+    * #GstSRTBaseSink:inputbw when #GstSRTBaseSink:maxbw is relative. SRT
+    * accepts 5 to 100.
+    */
+  properties[PROP_OHEADBW] =
+    g_param_spec_int ("oheadbw", "Overhead Bandwidth",
+      "Retransmission headroom over the input rate in percent, with a "
+      "relative maxbw", 5, 100, SRT_DEFAULT_OHEADBW,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:auto-inputbw:
+    *
+    * Measure the input rate from the rendered buffers, seeded from the
+    * bitrate tags, and keep updating SRTO_INPUTBW with it in place of
+    * #GstSRTBaseSink:inputbw. Only has an effect with a relative
+    * #GstSRTBaseSink:maxbw.
+    */
+  properties[PROP_AUTO_INPUTBW] =
+    g_param_spec_boolean ("auto-inputbw", "Auto Input Bandwidth",
+      "Keep updating the input rate from the measured stream bitrate",
+      SRT_DEFAULT_AUTO_INPUTBW,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:cpu-affinity:
+    *
+    * CPUs the recording thread is pinned to, as a list such as "0-3,8".
+    * Combined with #GstSRTBaseSink:numa-node the thread runs on the CPUs of
+    * the node that are also in the list. The buffers are sent from the
+    * streaming threads of upstream, which the sink leaves alone. Only
+    * supported on Linux.
+    */
+  properties[PROP_CPU_AFFINITY] =
+    g_param_spec_string ("cpu-affinity", "CPU Affinity",
+      "CPUs to pin the recording thread to (e.g. 0-3,8)", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:numa-node:
+    *
+    * NUMA node whose CPUs the recording thread is pinned to, usually the
+    * node of the storage. -1 leaves the thread on any node.
+    */
+  properties[PROP_NUMA_NODE] =
+    g_param_spec_int ("numa-node", "NUMA Node",
+      "NUMA node to run the recording thread on (-1 = any)", -1, G_MAXINT,
+      SRT_DEFAULT_NUMA_NODE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:thread-nice:
+    *
+    * Nice value of the recording thread, from -20 (most favourable) to 19.
+    * Values below the current one need CAP_SYS_NICE or an RLIMIT_NICE.
+    */
+  properties[PROP_THREAD_NICE] =
+    g_param_spec_int ("thread-nice", "Thread Nice",
+      "Nice value of the recording thread", -20, 19,
+      SRT_DEFAULT_THREAD_NICE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:thread-rt-priority:
+    *
+    * Run the recording thread with the SCHED_FIFO realtime policy at this
+    * priority, in place of #GstSRTBaseSink:thread-nice. Needs CAP_SYS_NICE
+    * or an RLIMIT_RTPRIO, a warning is posted when it can't be set.
+    */
+  properties[PROP_THREAD_RT_PRIORITY] =
+    g_param_spec_int ("thread-rt-priority", "Thread Realtime Priority",
+      "SCHED_FIFO priority of the recording thread (0 = not realtime)", 0, 99,
+      SRT_DEFAULT_THREAD_RT_PRIORITY,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:record-location:
+    *
+    * Record the stream sent to the peers to these files, with a printf()
+    * style directive for the segment index, e.g. "rec-%05d.ts". The
+    * buffers are written by reference from a thread of the recorder, so
+    * a slow disk drops buffers from the recording rather than delaying the
+    * delivery. Each segment starts with the stream headers. The name must
+    * have exactly one integer directive, a literal % is written %%, and
+    * starting fails otherwise. Unset disables the recording.
+    */
+  properties[PROP_RECORD_LOCATION] =
+    g_param_spec_string ("record-location", "Record Location",
+      "Recording file names, with a directive for the segment index "
+      "(e.g. rec-%05d.ts)", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:record-max-size:
+    *
+    * Start a new segment at the first keyframe after this many bytes.
+    * 0 disables the rotation by size.
+    */
+  properties[PROP_RECORD_MAX_SIZE] =
+    g_param_spec_uint64 ("record-max-size", "Record Max Size",
+      "Maximum size of a recording segment in bytes (0 = no limit)",
+      0, G_MAXUINT64, SRT_DEFAULT_RECORD_MAX_SIZE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:record-max-time:
+    *
+    * Start a new segment at the first keyframe after this much running
+    * time, in nanoseconds. 0 disables the rotation by time.
+    */
+  properties[PROP_RECORD_MAX_TIME] =
+    g_param_spec_uint64 ("record-max-time", "Record Max Time",
+      "Maximum duration of a recording segment in ns (0 = no limit)",
+      0, G_MAXUINT64, SRT_DEFAULT_RECORD_MAX_TIME,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:record-direct-io:
+    *
+    * Write the recording with O_DIRECT, through an aligned staging block,
+    * so that archiving doesn't evict the page cache. Only supported on
+    * Linux, elsewhere the recording goes through the page cache.
+    */
+  properties[PROP_RECORD_DIRECT_IO] =
+    g_param_spec_boolean ("record-direct-io", "Record Direct I/O",
+      "Write the recording with O_DIRECT", SRT_DEFAULT_RECORD_DIRECT_IO,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:strip-null-packets:
+    *
+    * Leave the null packets (PID 0x1fff) padding a CBR MPEG-TS out of the
+    * messages, and only send their positions. The receiving source must
+    * enable #GstSRTBaseSrc:restore-null-packets to put them back, which
+    * keeps the CBR timing. Live mode only, with messages of whole packets.
+    */
+  properties[PROP_STRIP_NULL_PACKETS] =
+    g_param_spec_boolean ("strip-null-packets", "Strip Null Packets",
+      "Don't send the MPEG-TS null packets, only their positions",
+      SRT_DEFAULT_NULL_PACKETS,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSink:keyframe-request-interval:
+    *
+    * Send a GstForceKeyUnit event upstream when srtclientsink connects, or
+    * when a client of srtserversink joins or moves to another rendition, so
+    * that the receiver doesn't wait for the next keyframe.
+    * Requests are coalesced and sent at most once per interval, in
+    * milliseconds. 0 disables them.
+    */
+  properties[PROP_KEYFRAME_REQUEST_INTERVAL] =
+    g_param_spec_int ("keyframe-request-interval", "Keyframe Request Interval",
+      "Minimum time between two keyframe requests in ms (0 = disabled)",
+      0, G_MAXINT32, SRT_DEFAULT_KEYFRAME_REQUEST_INTERVAL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
+  gstelement_class->change_state =
+    GST_DEBUG_FUNCPTR (gst_srt_base_sink_change_state);
+
   gstbasesink_class->set_caps = GST_DEBUG_FUNCPTR (gst_srt_base_sink_set_caps);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_srt_base_sink_stop);
+  gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_srt_base_sink_event);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_srt_base_sink_render);
 }
 
@@ -283,10 +1093,31 @@ gst_srt_base_sink_init (GstSRTBaseSink * self)
 {
   self->uri = gst_uri_from_string (SRT_DEFAULT_URI);
   self->latency = SRT_DEFAULT_LATENCY;
+  self->render_running_time = GST_CLOCK_TIME_NONE;
   self->passphrase = NULL;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
-  srt_startup ();
-  GST_INFO_OBJECT (self, "SRT startup");
+  self->km_refresh_rate = SRT_DEFAULT_KM_REFRESH_RATE;
+  self->km_preannounce = SRT_DEFAULT_KM_PREANNOUNCE;
+  self->stats_interval = SRT_DEFAULT_STATS_INTERVAL;
+  self->packet_filter = NULL;
+  self->transtype = SRT_DEFAULT_TRANSTYPE;
+  self->bitrate = SRT_DEFAULT_BITRATE;
+  self->srt_options = NULL;
+  self->profile = SRT_DEFAULT_PROFILE;
+  gst_srt_thread_config_init (&self->thread_config);
+  self->keyframe_request_interval = SRT_DEFAULT_KEYFRAME_REQUEST_INTERVAL;
+  gst_srt_key_unit_request_init (&self->key_unit);
+  self->maxbw = SRT_DEFAULT_MAXBW;
+  self->inputbw = SRT_DEFAULT_INPUTBW;
+  self->oheadbw = SRT_DEFAULT_OHEADBW;
+  self->auto_inputbw = SRT_DEFAULT_AUTO_INPUTBW;
+  self->record_location = NULL;
+  self->record_max_size = SRT_DEFAULT_RECORD_MAX_SIZE;
+  self->record_max_time = SRT_DEFAULT_RECORD_MAX_TIME;
+  self->record_direct_io = SRT_DEFAULT_RECORD_DIRECT_IO;
+  self->strip_null_packets = SRT_DEFAULT_NULL_PACKETS;
+  self->inputbw_start = GST_CLOCK_TIME_NONE;
+  gst_srt_runtime_ref ();
 }
 
 static GstURIType
@@ -360,21 +1191,32 @@ gst_srt_base_sink_uri_handler_init (gpointer g_iface, gpointer iface_data)
 gboolean
 gst_srt_base_sink_send_headers (GstSRTBaseSink * self,
   GstSRTBaseSinkSendCallback send_cb, gpointer user_data)
+{
+  g_return_val_if_fail (GST_IS_SRT_BASE_SINK (self), FALSE);
+
+  return gst_srt_base_sink_send_header_list (self, self->headers, send_cb,
+    user_data);
+}
+
+/* Like gst_srt_base_sink_send_headers() with the headers of another pad */
+gboolean
+gst_srt_base_sink_send_header_list (GstSRTBaseSink * self,
+  GstBufferList * headers, GstSRTBaseSinkSendCallback send_cb,
+  gpointer user_data)
 {
   guint size, i;
 
-  g_return_val_if_fail (GST_IS_SRT_BASE_SINK (self), FALSE);
   g_return_val_if_fail (send_cb, FALSE);
 
-  if (!self->headers)
+  if (!headers)
     return TRUE;
 
-  size = gst_buffer_list_length (self->headers);
+  size = gst_buffer_list_length (headers);
 
   GST_DEBUG_OBJECT (self, "Sending %u stream headers", size);
 
   for (i = 0; i < size; i++) {
-    GstBuffer *buffer = gst_buffer_list_get (self->headers, i);
+    GstBuffer *buffer = gst_buffer_list_get (headers, i);
     GstMapInfo info;
     gboolean ret;
 
@@ -411,43 +1253,139 @@ gst_srt_base_sink_get_stats (GSocketAddress * sockaddr, SRTSOCKET sock)
   s = gst_structure_new ("application/x-srt-statistics",
     "sockaddr", G_TYPE_SOCKET_ADDRESS, sockaddr, NULL);
 
+  /* The interval counters are cleared by the "stats-interval" timer, so
+   * only report the totals here */
   ret = srt_bstats (sock, &stats, 0);
   if (ret >= 0) {
     gst_structure_set (s,
       /* number of sent data packets, including retransmissions */
-      "packets-sent", G_TYPE_INT64, stats.pktSent,
+      "packets-sent", G_TYPE_INT64, stats.pktSentTotal,
       /* number of lost packets (sender side) */
-      "packets-sent-lost", G_TYPE_INT, stats.pktSndLoss,
+      "packets-sent-lost", G_TYPE_INT, stats.pktSndLossTotal,
       /* number of retransmitted packets */
-      "packets-retransmitted", G_TYPE_INT, stats.pktRetrans,
+      "packets-retransmitted", G_TYPE_INT, stats.pktRetransTotal,
       /* number of received ACK packets */
-      "packet-ack-received", G_TYPE_INT, stats.pktRecvACK,
+      "packet-ack-received", G_TYPE_INT, stats.pktRecvACKTotal,
       /* number of received NAK packets */
-      "packet-nack-received", G_TYPE_INT, stats.pktRecvNAK,
+      "packet-nack-received", G_TYPE_INT, stats.pktRecvNAKTotal,
       /* time duration when UDT is sending data (idle time exclusive) */
-      "send-duration-us", G_TYPE_INT64, stats.usSndDuration,
+      "send-duration-us", G_TYPE_INT64, stats.usSndDurationTotal,
       /* number of sent data bytes, including retransmissions */
-      "bytes-sent", G_TYPE_UINT64, stats.byteSent,
+      "bytes-sent", G_TYPE_UINT64, stats.byteSentTotal,
       /* number of retransmitted bytes */
-      "bytes-retransmitted", G_TYPE_UINT64, stats.byteRetrans,
+      "bytes-retransmitted", G_TYPE_UINT64, stats.byteRetransTotal,
       /* number of too-late-to-send dropped bytes */
-      "bytes-sent-dropped", G_TYPE_UINT64, stats.byteSndDrop,
+      "bytes-sent-dropped", G_TYPE_UINT64, stats.byteSndDropTotal,
       /* number of too-late-to-send dropped packets */
-      "packets-sent-dropped", G_TYPE_INT, stats.pktSndDrop,
+      "packets-sent-dropped", G_TYPE_INT, stats.pktSndDropTotal,
       /* sending rate in Mb/s */
       "send-rate-mbps", G_TYPE_DOUBLE, stats.mbpsSendRate,
       /* estimated bandwidth, in Mb/s */
       "bandwidth-mbps", G_TYPE_DOUBLE, stats.mbpsBandwidth,
       /* busy sending time (i.e., idle time exclusive) */
-      "send-duration-us", G_TYPE_UINT64, stats.usSndDuration,
+      "send-duration-us", G_TYPE_UINT64, stats.usSndDurationTotal,
       "rtt-ms", G_TYPE_DOUBLE, stats.msRTT, NULL);
+#ifdef HAVE_SRT_PACKET_FILTER
+    gst_structure_set (s,
+      /* number of control packets sent by the packet filter (FEC) */
+      "packets-filter-extra", G_TYPE_INT, stats.pktSndFilterExtraTotal, NULL);
+#endif
 
   }
 
+  gst_srt_add_buffer_stats (sock, s);
+
   g_value_init (&v, G_TYPE_STRING);
   g_value_take_string (&v,
     g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (sockaddr)));
   gst_structure_take_value (s, "sockaddr-str", &v);
 
   return s;
-}
\ No newline at end of file
+}
+/**
+ * gst_srt_base_sink_record_send_latency:
+ * @sink: a #GstSRTBaseSink
+ * @hist: the histogram of the socket the buffer was just sent on
+ * @running_time: the running time of the buffer, in the segment of its pad
+ *
+ * Records the time between @running_time and now, in microseconds. Must be
+ * called right after srt_sendmsg2() returned, with the lock protecting
+ * @hist held.
+ */
+void
+gst_srt_base_sink_record_send_latency (GstSRTBaseSink * sink,
+  GstSRTHistogram * hist, GstClockTime running_time)
+{
+  GstClock *clock = GST_ELEMENT_CLOCK (sink);
+  GstClockTime now;
+
+  if (clock == NULL || running_time == GST_CLOCK_TIME_NONE)
+    return;
+
+  now = gst_clock_get_time (clock) - GST_ELEMENT_CAST (sink)->base_time;
+  if (now < running_time)
+    now = running_time;
+
+  gst_srt_histogram_record (hist, (now - running_time) / GST_USECOND);
+}
+
+/**
+ * gst_srt_base_sink_apply_bandwidth:
+ * @sink: a #GstSRTBaseSink
+ * @sock: a sender socket of @sink
+ *
+ * Applies #GstSRTBaseSink:maxbw, #GstSRTBaseSink:inputbw and
+ * #GstSRTBaseSink:oheadbw to @sock, with the measured input rate in place
+ * of #GstSRTBaseSink:inputbw in "auto-inputbw" mode. These can be changed
+ * at any time, even on connected sockets. Must be called without the object
+ * lock held.
+ */
+void
+gst_srt_base_sink_apply_bandwidth (GstSRTBaseSink * sink, SRTSOCKET sock)
+{
+  SRTBandwidth bw;
+
+  gst_srt_base_sink_get_bandwidth (sink, &bw);
+  gst_srt_base_sink_set_bandwidth (GST_ELEMENT_CAST (sink), sock, NULL, &bw);
+}
+
+/**
+ * gst_srt_base_sink_get_expected_bitrate:
+ * @sink: a #GstSRTBaseSink
+ *
+ * Returns: the bitrate in bits/s to size the socket buffers for:
+ * #GstSRTBaseSink:bitrate, else the configured input or absolute maximum
+ * bandwidth, or 0 if none of these is known.
+ */
+gint64
+gst_srt_base_sink_get_expected_bitrate (GstSRTBaseSink * sink)
+{
+  gint64 bitrate;
+
+  GST_OBJECT_LOCK (sink);
+  if (sink->bitrate > 0)
+    bitrate = sink->bitrate;
+  else if (sink->inputbw > 0)
+    bitrate = sink->inputbw * 8;
+  else if (sink->maxbw > 0)
+    bitrate = sink->maxbw * 8;
+  else
+    bitrate = 0;
+  GST_OBJECT_UNLOCK (sink);
+
+  return bitrate;
+}
+
+/**
+ * gst_srt_base_sink_request_key_unit:
+ * @sink: a #GstSRTBaseSink
+ *
+ * Asks for a keyframe, from any thread. It is sent upstream from the
+ * streaming thread, at most once per
+ * #GstSRTBaseSink:keyframe-request-interval.
+ */
+void
+gst_srt_base_sink_request_key_unit (GstSRTBaseSink * sink)
+{
+  gst_srt_key_unit_request_mark (&sink->key_unit);
+}
@@ -29,6 +29,12 @@
 
 #include <srt.h>
 
+#include "gstsrt.h"
+#include "gstsrthistogram.h"
+#include "gstsrtrecorder.h"
+#include "gstsrtthread.h"
+#include "gstsrttsscan.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_SRT_BASE_SINK               (gst_srt_base_sink_get_type ())
@@ -50,6 +56,48 @@ struct _GstSRTBaseSink {
   gint latency;
   gchar *passphrase;
   gint key_length;
+  gint km_refresh_rate;
+  gint km_preannounce;
+  gint stats_interval;
+  gchar *packet_filter;
+  GstSRTTransType transtype;
+  gint64 bitrate;
+  GstStructure *srt_options;
+  GstSRTProfile profile;
+  GstSRTThreadConfig thread_config;
+  gint keyframe_request_interval;
+  GstSRTKeyUnitRequest key_unit;
+  gint64 maxbw;
+  gint64 inputbw;
+  gint oheadbw;
+  gboolean auto_inputbw;
+  gchar *record_location;
+  guint64 record_max_size;
+  guint64 record_max_time;
+  gboolean record_direct_io;
+  gboolean strip_null_packets;
+
+  /* recording tap, from READY to PAUSED until back to READY */
+  GstSRTRecorder *recorder;
+
+  /* input rate measured for "auto-inputbw", in bytes/s, protected by the
+   * object lock */
+  gint64 measured_inputbw;
+  gint64 applied_inputbw;
+  guint64 inputbw_bytes;
+  GstClockTime inputbw_start;
+
+  GstClockID stats_clock_id;
+  GstClockTime stats_last_time;
+
+  /* running time of the buffer being rendered */
+  GstClockTime render_running_time;
+  /* whether a receiver can start decoding from it */
+  gboolean render_keyframe;
+
+  /* the message without its null packets */
+  guint8 *strip_buf;
+  gsize strip_buf_size;
 
   /*< private >*/
   gpointer _gst_reserved[GST_PADDING];
@@ -62,6 +110,10 @@ struct _GstSRTBaseSinkClass {
   /* ask the subclass to send a buffer */
   gboolean (*send_buffer)       (GstSRTBaseSink *self, const GstMapInfo *mapinfo);
 
+  /* call @func for every connected SRT socket */
+  void (*foreach_socket)        (GstSRTBaseSink *self, GstSRTSocketFunc func,
+                                 gpointer user_data);
+
   gpointer _gst_reserved[GST_PADDING_LARGE];
 
 };
@@ -75,9 +127,29 @@ typedef gboolean (*GstSRTBaseSinkSendCallback) (GstSRTBaseSink *sink,
 gboolean gst_srt_base_sink_send_headers (GstSRTBaseSink *sink,
   GstSRTBaseSinkSendCallback send_cb, gpointer user_data);
 
+gboolean gst_srt_base_sink_send_header_list (GstSRTBaseSink *sink,
+  GstBufferList *headers, GstSRTBaseSinkSendCallback send_cb,
+  gpointer user_data);
+
+gboolean gst_srt_base_sink_parse_streamheader (GstSRTBaseSink *self,
+  GstCaps *caps, GstBufferList **headers);
+
 GstStructure * gst_srt_base_sink_get_stats (GSocketAddress *sockaddr,
   SRTSOCKET sock);
 
+void gst_srt_base_sink_record_send_latency (GstSRTBaseSink *sink,
+  GstSRTHistogram *hist, GstClockTime running_time);
+
+void gst_srt_base_sink_apply_bandwidth (GstSRTBaseSink *sink,
+  SRTSOCKET sock);
+
+void gst_srt_base_sink_strip_null_packets (GstSRTBaseSink *self,
+  GstMapInfo *info, guint8 **strip_buf, gsize *strip_buf_size);
+
+gint64 gst_srt_base_sink_get_expected_bitrate (GstSRTBaseSink *sink);
+
+void gst_srt_base_sink_request_key_unit (GstSRTBaseSink *sink);
+
 G_END_DECLS
 
 #endif /* __GST_SRT_BASE_SINK_H__ */
\ No newline at end of file
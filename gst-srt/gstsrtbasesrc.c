@@ -23,13 +23,20 @@
 #endif
 
 #include "gstsrtbasesrc.h"
+#include "gstsrtmetrics.h"
+#include "gstsrtreactor.h"
 #include "gstsrt.h"
 #include <srt.h>
 #include <gio/gio.h>
+#include <string.h>
 
 #define GST_CAT_DEFAULT gst_debug_srt_base_src
 GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 
+/* Interval between two RTT samples of the auto-latency mode */
+#define SRT_LINK_SAMPLE_INTERVAL (50 * GST_MSECOND)
+#define SRT_SESSION_SAMPLE_INTERVAL (500 * GST_MSECOND)
+
 enum
 {
   PROP_URI = 1,
@@ -37,6 +44,24 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_KM_REFRESH_RATE,
+  PROP_KM_PREANNOUNCE,
+  PROP_STATS_INTERVAL,
+  PROP_PACKET_FILTER,
+  PROP_TRANSTYPE,
+  PROP_BITRATE,
+  PROP_SRT_OPTIONS,
+  PROP_PROFILE,
+  PROP_CPU_AFFINITY,
+  PROP_NUMA_NODE,
+  PROP_THREAD_NICE,
+  PROP_THREAD_RT_PRIORITY,
+  PROP_KEYFRAME_REQUEST_INTERVAL,
+  PROP_AUTO_LATENCY,
+  PROP_AUTO_LATENCY_PROBE,
+  PROP_EFFECTIVE_LATENCY,
+  PROP_TS_CHECK,
+  PROP_RESTORE_NULL_PACKETS,
 
   /*< private > */
   PROP_LAST
@@ -84,6 +109,60 @@ gst_srt_base_src_get_property (GObject * object,
   case PROP_KEY_LENGTH:
     g_value_set_int (value, self->key_length);
     break;
+  case PROP_KM_REFRESH_RATE:
+    g_value_set_int (value, self->km_refresh_rate);
+    break;
+  case PROP_KM_PREANNOUNCE:
+    g_value_set_int (value, self->km_preannounce);
+    break;
+  case PROP_STATS_INTERVAL:
+    g_value_set_int (value, self->stats_interval);
+    break;
+  case PROP_PACKET_FILTER:
+    g_value_set_string (value, self->packet_filter);
+    break;
+  case PROP_TRANSTYPE:
+    g_value_set_enum (value, self->transtype);
+    break;
+  case PROP_BITRATE:
+    g_value_set_int64 (value, self->bitrate);
+    break;
+  case PROP_SRT_OPTIONS:
+    gst_value_set_structure (value, self->srt_options);
+    break;
+  case PROP_PROFILE:
+    g_value_set_enum (value, self->profile);
+    break;
+  case PROP_CPU_AFFINITY:
+    g_value_set_string (value, self->thread_config.cpus);
+    break;
+  case PROP_NUMA_NODE:
+    g_value_set_int (value, self->thread_config.numa_node);
+    break;
+  case PROP_THREAD_NICE:
+    g_value_set_int (value, self->thread_config.nice);
+    break;
+  case PROP_THREAD_RT_PRIORITY:
+    g_value_set_int (value, self->thread_config.rt_priority);
+    break;
+  case PROP_KEYFRAME_REQUEST_INTERVAL:
+    g_value_set_int (value, g_atomic_int_get (&self->keyframe_request_interval));
+    break;
+  case PROP_AUTO_LATENCY:
+    g_value_set_boolean (value, self->auto_latency);
+    break;
+  case PROP_AUTO_LATENCY_PROBE:
+    g_value_set_int (value, self->auto_latency_probe);
+    break;
+  case PROP_EFFECTIVE_LATENCY:
+    g_value_set_int (value, g_atomic_int_get (&self->effective_latency));
+    break;
+  case PROP_TS_CHECK:
+    g_value_set_boolean (value, self->ts_check);
+    break;
+  case PROP_RESTORE_NULL_PACKETS:
+    g_value_set_boolean (value, self->restore_null_packets);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -123,6 +202,66 @@ gst_srt_base_src_set_property (GObject * object,
     self->key_length = key_length;
     break;
   }
+  case PROP_KM_REFRESH_RATE:
+    self->km_refresh_rate = g_value_get_int (value);
+    break;
+  case PROP_KM_PREANNOUNCE:
+    self->km_preannounce = g_value_get_int (value);
+    break;
+  case PROP_STATS_INTERVAL:
+    self->stats_interval = g_value_get_int (value);
+    break;
+  case PROP_PACKET_FILTER:
+    g_free (self->packet_filter);
+    self->packet_filter = g_value_dup_string (value);
+    break;
+  case PROP_TRANSTYPE:
+    self->transtype = g_value_get_enum (value);
+    break;
+  case PROP_BITRATE:
+    self->bitrate = g_value_get_int64 (value);
+    break;
+  case PROP_SRT_OPTIONS:
+  {
+    const GstStructure *s = gst_value_get_structure (value);
+
+    g_clear_pointer (&self->srt_options, gst_structure_free);
+    if (s)
+      self->srt_options = gst_structure_copy (s);
+    break;
+  }
+  case PROP_PROFILE:
+    self->profile = g_value_get_enum (value);
+    break;
+  case PROP_CPU_AFFINITY:
+    g_free (self->thread_config.cpus);
+    self->thread_config.cpus = g_value_dup_string (value);
+    break;
+  case PROP_NUMA_NODE:
+    self->thread_config.numa_node = g_value_get_int (value);
+    break;
+  case PROP_THREAD_NICE:
+    self->thread_config.nice = g_value_get_int (value);
+    break;
+  case PROP_THREAD_RT_PRIORITY:
+    self->thread_config.rt_priority = g_value_get_int (value);
+    break;
+  case PROP_KEYFRAME_REQUEST_INTERVAL:
+    g_atomic_int_set (&self->keyframe_request_interval,
+      g_value_get_int (value));
+    break;
+  case PROP_AUTO_LATENCY:
+    self->auto_latency = g_value_get_boolean (value);
+    break;
+  case PROP_AUTO_LATENCY_PROBE:
+    self->auto_latency_probe = g_value_get_int (value);
+    break;
+  case PROP_TS_CHECK:
+    self->ts_check = g_value_get_boolean (value);
+    break;
+  case PROP_RESTORE_NULL_PACKETS:
+    self->restore_null_packets = g_value_get_boolean (value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -137,11 +276,305 @@ gst_srt_base_src_finalize (GObject * object)
   g_clear_pointer (&self->uri, gst_uri_unref);
   g_clear_pointer (&self->caps, gst_caps_unref);
   g_clear_pointer (&self->passphrase, g_free);
+  g_clear_pointer (&self->packet_filter, g_free);
+  g_clear_pointer (&self->srt_options, gst_structure_free);
+  gst_srt_thread_config_clear (&self->thread_config);
+  g_clear_pointer (&self->links, g_hash_table_unref);
+  g_mutex_clear (&self->probe_lock);
+  g_cond_clear (&self->probe_cond);
 
-  srt_cleanup ();
-  GST_INFO_OBJECT (self, "SRT cleanup");
+  gst_srt_runtime_unref ();
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
+
+static gboolean
+gst_srt_base_src_stats_tick (GstClock * clock, GstClockTime time,
+  GstClockID id, gpointer user_data)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (user_data);
+  GstSRTBaseSrcClass *bclass = GST_SRT_BASE_SRC_GET_CLASS (self);
+  GstSRTIntervalStats acc;
+  GstClockTime now = gst_clock_get_time (clock);
+
+  gst_srt_interval_stats_init (&acc, FALSE, now - self->stats_last_time);
+  self->stats_last_time = now;
+
+  if (bclass->foreach_socket)
+    bclass->foreach_socket (self, gst_srt_interval_stats_add, &acc);
+
+  gst_element_post_message (GST_ELEMENT_CAST (self),
+    gst_message_new_element (GST_OBJECT_CAST (self),
+      gst_srt_interval_stats_finish (&acc)));
+
+  return TRUE;
+}
+
+static void
+gst_srt_base_src_start_stats_timer (GstSRTBaseSrc * self)
+{
+  GstClock *clock;
+  GstClockTime interval;
+
+  if (self->stats_interval <= 0)
+    return;
+
+  interval = self->stats_interval * GST_MSECOND;
+  clock = gst_system_clock_obtain ();
+  self->stats_last_time = gst_clock_get_time (clock);
+  self->stats_clock_id = gst_clock_new_periodic_id (clock,
+    self->stats_last_time + interval, interval);
+  gst_object_unref (clock);
+
+  GST_DEBUG_OBJECT (self, "Posting stats every %d ms", self->stats_interval);
+  gst_clock_id_wait_async (self->stats_clock_id, gst_srt_base_src_stats_tick,
+    gst_object_ref (self), (GDestroyNotify)gst_object_unref);
+}
+
+static void
+gst_srt_base_src_stop_stats_timer (GstSRTBaseSrc * self)
+{
+  if (self->stats_clock_id == NULL)
+    return;
+
+  gst_clock_id_unschedule (self->stats_clock_id);
+  gst_clock_id_unref (self->stats_clock_id);
+  self->stats_clock_id = NULL;
+}
+
+#if GST_VERSION_MINOR >= 10
+/* Applies the placement and priority properties to the streaming thread as
+ * the task of the source pad enters it. Called from that thread */
+static void
+gst_srt_base_src_configure_thread (GstSRTBaseSrc * self)
+{
+  GError *error = NULL;
+
+  if (self->thread_state != NULL
+      || gst_srt_thread_config_is_default (&self->thread_config))
+    return;
+
+  self->thread_state = gst_srt_thread_save ();
+  if (!gst_srt_thread_apply (&self->thread_config, &error)) {
+    GST_ELEMENT_WARNING (self, RESOURCE, SETTINGS,
+      ("Failed to configure the streaming thread"), ("%s", error->message));
+    g_clear_error (&error);
+  }
+}
+
+/* Puts the streaming thread back as it was before the task leaves it, the
+ * thread pool may hand it to another element. Called from that thread */
+static void
+gst_srt_base_src_restore_thread (GstSRTBaseSrc * self)
+{
+  GError *error = NULL;
+
+  if (self->thread_state == NULL)
+    return;
+
+  if (!gst_srt_thread_restore (self->thread_state, &error)) {
+    GST_WARNING_OBJECT (self, "Failed to restore the streaming thread: %s",
+      error->message);
+    g_clear_error (&error);
+  }
+  self->thread_state = NULL;
+}
+
+/* The task of the source pad posts its stream status from its own thread
+ * as it enters and leaves it */
+static gboolean
+gst_srt_base_src_post_message (GstElement * element, GstMessage * message)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (element);
+
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_STREAM_STATUS
+      && GST_MESSAGE_SRC (message) ==
+      GST_OBJECT_CAST (GST_BASE_SRC_PAD (self))) {
+    GstStreamStatusType type;
+    GstElement *owner;
+
+    gst_message_parse_stream_status (message, &type, &owner);
+    if (type == GST_STREAM_STATUS_TYPE_ENTER)
+      gst_srt_base_src_configure_thread (self);
+    else if (type == GST_STREAM_STATUS_TYPE_LEAVE)
+      gst_srt_base_src_restore_thread (self);
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->post_message (element, message);
+}
+#endif
+
+/* The latency to use with @peer in the auto-latency mode, computed from
+ * the cached measurements of the previous sessions. The "latency" property
+ * if the mode is off, -1 if the peer is unknown */
+gint
+gst_srt_base_src_get_latency_for_peer (GstSRTBaseSrc * src, const gchar * peer)
+{
+  gdouble rtt, rtt_dev, loss;
+  gint latency;
+
+  if (!src->auto_latency)
+    return src->latency;
+
+  if (peer == NULL || !gst_srt_latency_cache_lookup (peer, &rtt, &rtt_dev,
+      &loss))
+    return -1;
+
+  latency = gst_srt_latency_compute (rtt, rtt_dev, loss);
+  GST_INFO_OBJECT (src, "Latency %d ms for %s (RTT %.1f ms, deviation "
+    "%.1f ms, loss %.2f%%)", latency, peer, rtt, rtt_dev, loss * 100);
+
+  return latency;
+}
+
+/* Measures the link of the connected @sock for "auto-latency-probe" ms and
+ * caches it. Sets @latency to the one to reconnect with, -1 if the link
+ * could not be measured. Returns FALSE if unlock() cancelled the probe */
+gboolean
+gst_srt_base_src_probe_latency (GstSRTBaseSrc * src, SRTSOCKET sock,
+  const gchar * peer, gint * latency)
+{
+  GstSRTLinkProbe probe;
+  gint64 end, next;
+  gdouble rtt, rtt_dev, loss;
+  gboolean cancelled;
+
+  *latency = -1;
+  gst_srt_link_probe_init (&probe);
+
+  GST_DEBUG_OBJECT (src, "Probing the link to %s for %d ms", peer,
+    src->auto_latency_probe);
+  end = g_get_monotonic_time ()
+    + (gint64) src->auto_latency_probe * G_TIME_SPAN_MILLISECOND;
+  g_mutex_lock (&src->probe_lock);
+  while (!src->probe_cancelled && (next = g_get_monotonic_time ()) < end) {
+    next = MIN (end, next + SRT_LINK_SAMPLE_INTERVAL / GST_USECOND);
+    if (g_cond_wait_until (&src->probe_cond, &src->probe_lock, next))
+      continue;
+    gst_srt_link_probe_sample (&probe, sock);
+  }
+  cancelled = src->probe_cancelled;
+  g_mutex_unlock (&src->probe_lock);
+
+  if (cancelled) {
+    GST_DEBUG_OBJECT (src, "Probing the link to %s cancelled", peer);
+    return FALSE;
+  }
+
+  if (!gst_srt_link_probe_get (&probe, &rtt, &rtt_dev, &loss)) {
+    GST_WARNING_OBJECT (src, "No data from %s to measure the link", peer);
+    return TRUE;
+  }
+
+  gst_srt_latency_cache_store (peer, &probe);
+  *latency = gst_srt_latency_compute (rtt, rtt_dev, loss);
+  GST_INFO_OBJECT (src, "Latency %d ms for %s (RTT %.1f ms, deviation "
+    "%.1f ms, loss %.2f%%)", *latency, peer, rtt, rtt_dev, loss * 100);
+
+  return TRUE;
+}
+
+/* Reports the receiver latency @sock ended up with, the largest of ours
+ * and of the sender's */
+void
+gst_srt_base_src_set_effective_latency (GstSRTBaseSrc * src, SRTSOCKET sock)
+{
+  int latency = -1;
+  int len = sizeof (latency);
+
+  if (srt_getsockflag (sock, SRTO_RCVLATENCY, &latency, &len) == SRT_ERROR)
+    return;
+
+  GST_INFO_OBJECT (src, "Receiver latency %d ms", latency);
+  g_atomic_int_set (&src->effective_latency, latency);
+  g_object_notify_by_pspec (G_OBJECT (src),
+    properties[PROP_EFFECTIVE_LATENCY]);
+
+  gst_element_post_message (GST_ELEMENT_CAST (src),
+    gst_message_new_element (GST_OBJECT_CAST (src),
+      gst_structure_new ("application/x-srt-latency",
+        "latency", G_TYPE_INT, latency,
+        "auto", G_TYPE_BOOLEAN, src->auto_latency, NULL)));
+}
+
+/* Called from the streaming thread only */
+static void
+sample_link (GstElement * elem, SRTSOCKET sock, GSocketAddress * sockaddr,
+  gpointer user_data)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (elem);
+  gchar *peer = gst_srt_latency_peer_name (sockaddr);
+  GstSRTLinkProbe *probe;
+
+  if (peer == NULL)
+    return;
+
+  /* Every path of a merge, or publisher of a server, is its own link */
+  probe = g_hash_table_lookup (self->links, peer);
+  if (probe == NULL) {
+    probe = g_new (GstSRTLinkProbe, 1);
+    gst_srt_link_probe_init (probe);
+    g_hash_table_insert (self->links, peer, probe);
+  } else {
+    g_free (peer);
+  }
+
+  gst_srt_link_probe_sample (probe, sock);
+}
+
+static GstStateChangeReturn
+gst_srt_base_src_change_state (GstElement * element,
+  GstStateChange transition)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (element);
+  GstStateChangeReturn ret;
+
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    self->restore_warned = FALSE;
+    g_mutex_lock (&self->probe_lock);
+    self->probe_cancelled = FALSE;
+    g_mutex_unlock (&self->probe_lock);
+    gst_srt_key_unit_request_init (&self->key_unit);
+    g_hash_table_remove_all (self->links);
+    self->link_last_sample = 0;
+    g_atomic_int_set (&self->effective_latency, -1);
+    GST_OBJECT_LOCK (self);
+    gst_srt_ts_scanner_reset (&self->ts_scanner);
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    gst_srt_base_src_stop_stats_timer (self);
+    gst_srt_metrics_unregister (element);
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    gst_srt_base_src_reset_latency (self);
+    gst_srt_base_src_start_stats_timer (self);
+    gst_srt_metrics_register (element);
+  }
+
+  /* The streaming thread is stopped, what this session measured serves
+   * the next ones */
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    if (self->auto_latency) {
+      GHashTableIter iter;
+      gpointer peer, probe;
+
+      g_hash_table_iter_init (&iter, self->links);
+      while (g_hash_table_iter_next (&iter, &peer, &probe))
+        gst_srt_latency_cache_store (peer, probe);
+    }
+    g_hash_table_remove_all (self->links);
+    g_atomic_int_set (&self->effective_latency, -1);
+  }
+
+  return ret;
+}
+
 GstStructure *
 gst_srt_base_src_get_stats (SRTSOCKET sock)
 {
@@ -152,35 +585,48 @@ gst_srt_base_src_get_stats (SRTSOCKET sock)
   if (sock == SRT_INVALID_SOCK)
     return s;
 
+  /* The interval counters are cleared by the "stats-interval" timer, so
+   * only report the totals here */
   ret = srt_bstats (sock, &stats, 0);
   if (ret >= 0) {
     gst_structure_set (s,
       /* number of received data packets */
-      "packets-recv", G_TYPE_INT64, stats.pktRecv,
+      "packets-recv", G_TYPE_INT64, stats.pktRecvTotal,
       /* number of lost packets, receiver side (some packets lost is expected) */
-      "packets-recv-lost", G_TYPE_INT, stats.pktRcvLoss,
+      "packets-recv-lost", G_TYPE_INT, stats.pktRcvLossTotal,
       /* number of retransmitted packets */
-      "packets-retransmitted", G_TYPE_INT, stats.pktRetrans,
+      "packets-retransmitted", G_TYPE_INT, stats.pktRetransTotal,
       /* number of received ACK packets */
-      "packet-ack-received", G_TYPE_INT, stats.pktRecvACK,
+      "packet-ack-received", G_TYPE_INT, stats.pktRecvACKTotal,
       /* number of received NAK packets */
-      "packet-nack-received", G_TYPE_INT, stats.pktRecvNAK,
+      "packet-nack-received", G_TYPE_INT, stats.pktRecvNAKTotal,
       /* number of received data bytes */
-      "bytes-received", G_TYPE_UINT64, stats.byteRecv,
+      "bytes-received", G_TYPE_UINT64, stats.byteRecvTotal,
       /* number of retransmitted bytes */
-      "bytes-retransmitted", G_TYPE_UINT64, stats.byteRetrans,
+      "bytes-retransmitted", G_TYPE_UINT64, stats.byteRetransTotal,
       /* number of too-late-to-play dropped bytes  (estimate based on average packet size) */
-      "bytes-recv-dropped", G_TYPE_UINT64, stats.byteRcvLoss,
+      "bytes-recv-dropped", G_TYPE_UINT64, stats.byteRcvLossTotal,
       /* number of too-late-to-play dropped packets */
-      "packets-recv-dropped", G_TYPE_INT, stats.pktRcvDrop,
+      "packets-recv-dropped", G_TYPE_INT, stats.pktRcvDropTotal,
       /* receiving rate in Mb/s */
       "recv-rate-mbps", G_TYPE_DOUBLE, stats.mbpsRecvRate,
       /* estimated bandwidth, in Mb/s */
       "bandwidth-mbps", G_TYPE_DOUBLE, stats.mbpsBandwidth,
       /* RTT, in milliseconds */
       "rtt-ms", G_TYPE_DOUBLE, stats.msRTT, NULL);
+#ifdef HAVE_SRT_PACKET_FILTER
+    gst_structure_set (s,
+      /* number of control packets received by the packet filter (FEC) */
+      "packets-filter-extra", G_TYPE_INT, stats.pktRcvFilterExtraTotal,
+      /* number of packets rebuilt by the packet filter */
+      "packets-filter-supply", G_TYPE_INT, stats.pktRcvFilterSupplyTotal,
+      /* number of packets the packet filter failed to rebuild */
+      "packets-filter-loss", G_TYPE_INT, stats.pktRcvFilterLossTotal, NULL);
+#endif
   }
 
+  gst_srt_add_buffer_stats (sock, s);
+
   return s;
 }
 
@@ -213,10 +659,168 @@ gst_srt_base_src_get_caps (GstBaseSrc * src, GstCaps * filter)
 }
 
 
+/* Returns @buf with the null packets the sender stripped put back */
+static GstBuffer *
+gst_srt_base_src_restore_null_packets (GstSRTBaseSrc * self, GstBuffer * buf)
+{
+  GstMapInfo in, out;
+  GstBuffer *outbuf;
+  gsize size;
+
+  if (!gst_buffer_map (buf, &in, GST_MAP_READ))
+    return buf;
+
+  size = gst_srt_ts_restored_size (in.data, in.size);
+  if (size == 0) {
+    gst_buffer_unmap (buf, &in);
+    return buf;
+  }
+
+  outbuf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
+  gst_srt_ts_restore_null_packets (in.data, in.size, out.data);
+  gst_buffer_unmap (outbuf, &out);
+
+  gst_buffer_unmap (buf, &in);
+  gst_buffer_unref (buf);
+
+  return outbuf;
+}
+
+/* Puts the null packets back into @buf, given by downstream and which can't
+ * be replaced, by growing it into its spare memory. Returns FALSE if the
+ * restored message doesn't fit */
+static gboolean
+gst_srt_base_src_restore_null_packets_in_place (GstSRTBaseSrc * self,
+  GstBuffer * buf)
+{
+  GstMapInfo info;
+  gsize size, offset, maxsize, stripped_size;
+  guint8 *stripped;
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ))
+    return TRUE;
+
+  size = gst_srt_ts_restored_size (info.data, info.size);
+  gst_buffer_get_sizes (buf, &offset, &maxsize);
+  if (size == 0 || size > maxsize - offset) {
+    gst_buffer_unmap (buf, &info);
+    return size == 0;
+  }
+
+  /* The restored packets overlap the stripped message */
+  stripped_size = info.size;
+  stripped = g_malloc (stripped_size);
+  memcpy (stripped, info.data, stripped_size);
+  gst_buffer_unmap (buf, &info);
+
+  gst_buffer_set_size (buf, size);
+  if (gst_buffer_map (buf, &info, GST_MAP_WRITE)) {
+    gst_srt_ts_restore_null_packets (stripped, stripped_size, info.data);
+    gst_buffer_unmap (buf, &info);
+  }
+  g_free (stripped);
+
+  return TRUE;
+}
+
+static void
+gst_srt_base_src_scan_ts (GstSRTBaseSrc * self, GstBuffer * buf)
+{
+  GstMapInfo info;
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ))
+    return;
+
+  GST_OBJECT_LOCK (self);
+  /* Another sender took over, its counters start anywhere */
+  if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DISCONT))
+    gst_srt_ts_scanner_discont (&self->ts_scanner);
+  gst_srt_ts_scanner_scan (&self->ts_scanner, info.data, info.size);
+  GST_OBJECT_UNLOCK (self);
+
+  gst_buffer_unmap (buf, &info);
+}
+
+/* Subclasses chain up from their own unlock and unlock_stop */
+static gboolean
+gst_srt_base_src_unlock (GstBaseSrc * src)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (src);
+
+  g_mutex_lock (&self->probe_lock);
+  self->probe_cancelled = TRUE;
+  g_cond_broadcast (&self->probe_cond);
+  g_mutex_unlock (&self->probe_lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_srt_base_src_unlock_stop (GstBaseSrc * src)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (src);
+
+  g_mutex_lock (&self->probe_lock);
+  self->probe_cancelled = FALSE;
+  g_mutex_unlock (&self->probe_lock);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_srt_base_src_create (GstBaseSrc * src, guint64 offset, guint size,
+  GstBuffer ** buf)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (src);
+  /* a buffer to fill was given, it can't be replaced */
+  gboolean own_buffer = *buf == NULL;
+  GstFlowReturn ret;
+
+  ret = GST_BASE_SRC_CLASS (parent_class)->create (src, offset, size, buf);
+
+  if (ret == GST_FLOW_OK && self->auto_latency) {
+    GstSRTBaseSrcClass *bclass = GST_SRT_BASE_SRC_GET_CLASS (self);
+    GstClockTime now = gst_util_get_timestamp ();
+
+    if (now - self->link_last_sample >= SRT_SESSION_SAMPLE_INTERVAL
+        && bclass->foreach_socket) {
+      self->link_last_sample = now;
+      bclass->foreach_socket (self, sample_link, NULL);
+    }
+  }
+
+  /* The scan below understands stripped messages either way */
+  if (ret == GST_FLOW_OK && self->restore_null_packets) {
+    if (own_buffer)
+      *buf = gst_srt_base_src_restore_null_packets (self, *buf);
+    else if (!gst_srt_base_src_restore_null_packets_in_place (self, *buf)
+        && !self->restore_warned) {
+      self->restore_warned = TRUE;
+      GST_ELEMENT_WARNING (self, STREAM, FAILED,
+        ("Null packets could not be restored"),
+        ("Downstream provided buffers too small for the restored messages, "
+          "the stream is pushed without its null packets"));
+    }
+  }
+
+  if (ret == GST_FLOW_OK && self->ts_check)
+    gst_srt_base_src_scan_ts (self, *buf);
+
+  /* Ahead of the buffer that showed the loss */
+  if (ret == GST_FLOW_OK)
+    gst_srt_key_unit_request_push (&self->key_unit, GST_BASE_SRC_PAD (src),
+      g_atomic_int_get (&self->keyframe_request_interval) * GST_MSECOND);
+
+  return ret;
+}
+
 static void
 gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_base_src_set_property;
@@ -256,9 +860,261 @@ gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+    * GstSRTBaseSrc:km-refresh-rate:
+    *
+    * Number of packets the sender encrypts with a key before switching to
+    * a new one (SRTO_KMREFRESHRATE). Shorter refreshes limit what a leaked
+    * key exposes, at the cost of more key material exchanges. 0 keeps the
+    * SRT default of 2^24 packets.
+    */
+  properties[PROP_KM_REFRESH_RATE] =
+    g_param_spec_int ("km-refresh-rate", "Key Refresh Rate",
+      "Packets sent with a key before switching keys (0 = SRT default)",
+      0, G_MAXINT32, SRT_DEFAULT_KM_REFRESH_RATE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:km-preannounce:
+    *
+    * Number of packets before and after a key switch during which the
+    * sender announces the next key (SRTO_KMPREANNOUNCE), giving the
+    * receiver time to decode it. Must be below half of
+    * #GstSRTBaseSrc:km-refresh-rate. 0 keeps the SRT default of 2^12.
+    */
+  properties[PROP_KM_PREANNOUNCE] =
+    g_param_spec_int ("km-preannounce", "Key Pre-announce",
+      "Packets around a key switch the next key is announced for "
+      "(0 = SRT default)", 0, G_MAXINT32, SRT_DEFAULT_KM_PREANNOUNCE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:stats-interval:
+    *
+    * Interval in milliseconds at which an "application/x-srt-interval-statistics"
+    * element message with the rates measured since the previous one is
+    * posted on the bus. 0 disables the messages.
+    */
+  properties[PROP_STATS_INTERVAL] =
+    g_param_spec_int ("stats-interval", "Stats Interval",
+      "Interval between statistics messages in milliseconds (0 = disabled)",
+      0, G_MAXINT32, SRT_DEFAULT_STATS_INTERVAL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:packet-filter:
+    *
+    * SRT packet filter configuration, e.g. "fec,cols:10,rows:5" to protect
+    * the stream with row/column FEC. Only one of the peers needs to set it,
+    * the handshake rejects the connection if both sides set incompatible
+    * configurations. Requires libsrt >= 1.4.0.
+    */
+  properties[PROP_PACKET_FILTER] =
+    g_param_spec_string ("packet-filter", "Packet Filter",
+      "SRT packet filter configuration (e.g. fec,cols:10,rows:5)", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:transtype:
+    *
+    * "live" paces the delivery by TSBPD, with the latency as the delivery deadline.
+    * "file" uses the file congestion controller and the stream API, so bulk
+    * transfers run as fast as the link allows, without message boundaries,
+    * loss or drops. Both peers must use the same mode,
+    * and a larger #GstBaseSrc:blocksize cuts the per-read overhead.
+    */
+  properties[PROP_TRANSTYPE] =
+    g_param_spec_enum ("transtype", "Transmission Type",
+      "Live streaming or file transfer", GST_TYPE_SRT_TRANSTYPE,
+      SRT_DEFAULT_TRANSTYPE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:bitrate:
+    *
+    * Expected bitrate of the stream in bits/s. Together with the latency it
+    * sizes the SRT and UDP buffers and the flow control window, which the
+    * stats report. 0 keeps the libsrt defaults.
+    */
+  properties[PROP_BITRATE] =
+    g_param_spec_int64 ("bitrate", "Bitrate",
+      "Expected bitrate in bits/s to size the buffers for (0 = unknown)",
+      0, G_MAXINT64, SRT_DEFAULT_BITRATE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:srt-options:
+    *
+    * Extra SRT socket options, one field per option named after it without
+    * the SRTO_ prefix, e.g. "srt, lossmaxttl=(int)16, nakreport=true".
+    * Applied last before binding or connecting, over the
+    * #GstSRTBaseSrc:profile and the element's own settings.
+    */
+  properties[PROP_SRT_OPTIONS] =
+    g_param_spec_boxed ("srt-options", "SRT Options",
+      "Extra SRT socket options", GST_TYPE_STRUCTURE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:profile:
+    *
+    * Named set of socket options tuned for low latency, high throughput or
+    * lossy links. #GstSRTBaseSrc:srt-options override single options of it.
+    */
+  properties[PROP_PROFILE] =
+    g_param_spec_enum ("profile", "Profile", "SRT tuning profile",
+      GST_TYPE_SRT_PROFILE, SRT_DEFAULT_PROFILE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:cpu-affinity:
+    *
+    * CPUs the streaming thread is pinned to, as a list such as "0-3,8".
+    * Combined with #GstSRTBaseSrc:numa-node the thread runs on the CPUs of
+    * the node that are also in the list. The thread settings are applied
+    * as the streaming thread starts and undone as it stops, since it comes
+    * from a pool shared with other elements. Only supported on Linux, with
+    * GStreamer 1.10 or later.
+    */
+  properties[PROP_CPU_AFFINITY] =
+    g_param_spec_string ("cpu-affinity", "CPU Affinity",
+      "CPUs to pin the streaming thread to (e.g. 0-3,8)", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:numa-node:
+    *
+    * NUMA node whose CPUs the streaming thread is pinned to, usually the
+    * node of the network card, so the buffers it allocates are local to
+    * it. -1 leaves the thread on any node.
+    */
+  properties[PROP_NUMA_NODE] =
+    g_param_spec_int ("numa-node", "NUMA Node",
+      "NUMA node to run the streaming thread on (-1 = any)", -1, G_MAXINT,
+      SRT_DEFAULT_NUMA_NODE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:thread-nice:
+    *
+    * Nice value of the streaming thread, from -20 (most favourable) to 19.
+    * Values below the current one need CAP_SYS_NICE or an RLIMIT_NICE.
+    */
+  properties[PROP_THREAD_NICE] =
+    g_param_spec_int ("thread-nice", "Thread Nice",
+      "Nice value of the streaming thread", -20, 19,
+      SRT_DEFAULT_THREAD_NICE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:thread-rt-priority:
+    *
+    * Run the streaming thread with the SCHED_FIFO realtime policy at this
+    * priority, in place of #GstSRTBaseSrc:thread-nice. Needs CAP_SYS_NICE
+    * or an RLIMIT_RTPRIO, a warning is posted when it can't be set.
+    */
+  properties[PROP_THREAD_RT_PRIORITY] =
+    g_param_spec_int ("thread-rt-priority", "Thread Realtime Priority",
+      "SCHED_FIFO priority of the streaming thread (0 = not realtime)", 0, 99,
+      SRT_DEFAULT_THREAD_RT_PRIORITY,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:keyframe-request-interval:
+    *
+    * Send a GstForceKeyUnit event downstream when messages were lost, so that
+    * an encoder downstream recovers without waiting for the next keyframe.
+    * Requests are coalesced and sent at most once per interval, in
+    * milliseconds. 0 disables them.
+    */
+  properties[PROP_KEYFRAME_REQUEST_INTERVAL] =
+    g_param_spec_int ("keyframe-request-interval", "Keyframe Request Interval",
+      "Minimum time between two keyframe requests in ms (0 = disabled)",
+      0, G_MAXINT32, SRT_DEFAULT_KEYFRAME_REQUEST_INTERVAL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:auto-latency:
+    *
+    * Choose the receiver latency per peer instead of using
+    * #GstSRTBaseSrc:latency: a multiple of the RTT growing with the loss
+    * rate, plus a jitter margin. The RTT and loss are measured during every
+    * session and cached per peer address for the next ones, also across
+    * processes if GST_SRT_LATENCY_CACHE names a file. A client meeting an
+    * unknown peer first measures the link for
+    * #GstSRTBaseSrc:auto-latency-probe. The chosen value is reported by
+    * #GstSRTBaseSrc:effective-latency.
+    */
+  properties[PROP_AUTO_LATENCY] =
+    g_param_spec_boolean ("auto-latency", "Automatic Latency",
+      "Choose the latency from the measured RTT and loss of the peer",
+      SRT_DEFAULT_AUTO_LATENCY,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_AUTO_LATENCY_PROBE] =
+    g_param_spec_int ("auto-latency-probe", "Automatic Latency Probe",
+      "Time in ms to measure an unknown peer before reconnecting "
+      "(0 = use the latency property until it is known)", 0, 60000,
+      SRT_DEFAULT_AUTO_LATENCY_PROBE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:effective-latency:
+    *
+    * The receiver latency in ms of the current connection, after the
+    * negotiation with the sender which may have asked for more. An
+    * "application/x-srt-latency" element message is posted when it is
+    * known. -1 when not connected.
+    */
+  properties[PROP_EFFECTIVE_LATENCY] =
+    g_param_spec_int ("effective-latency", "Effective Latency",
+      "Negotiated receiver latency in ms (-1 = not connected)", -1,
+      G_MAXINT32, -1, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:ts-check:
+    *
+    * Check the received bytes as MPEG-TS: the alignment on sync bytes and
+    * the continuity counter of every PID. The packets lost on the way, as
+    * seen from the stream itself, are then reported by the "ts-*" fields
+    * of the statistics, with no tsparse element needed downstream.
+    */
+  properties[PROP_TS_CHECK] =
+    g_param_spec_boolean ("ts-check", "TS Check",
+      "Count the MPEG-TS sync and continuity errors of the received stream",
+      SRT_DEFAULT_TS_CHECK,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTBaseSrc:restore-null-packets:
+    *
+    * Put back the null packets left out by a sender with
+    * #GstSRTBaseSink:strip-null-packets, so that the CBR timing of the
+    * MPEG-TS is kept. Messages that weren't stripped go through as they
+    * are. When downstream provides the buffers, they must have room for
+    * the restored message, otherwise the null packets are left out and a
+    * warning is posted.
+    */
+  properties[PROP_RESTORE_NULL_PACKETS] =
+    g_param_spec_boolean ("restore-null-packets", "Restore Null Packets",
+      "Put back the MPEG-TS null packets stripped by the sender",
+      SRT_DEFAULT_NULL_PACKETS,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
+  gstelement_class->change_state =
+    GST_DEBUG_FUNCPTR (gst_srt_base_src_change_state);
+#if GST_VERSION_MINOR >= 10
+  gstelement_class->post_message =
+    GST_DEBUG_FUNCPTR (gst_srt_base_src_post_message);
+#endif
+
   gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gst_srt_base_src_get_caps);
+  gstbasesrc_class->create = GST_DEBUG_FUNCPTR (gst_srt_base_src_create);
+  gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_srt_base_src_unlock);
+  gstbasesrc_class->unlock_stop =
+    GST_DEBUG_FUNCPTR (gst_srt_base_src_unlock_stop);
 }
 
 static void
@@ -270,9 +1126,30 @@ gst_srt_base_src_init (GstSRTBaseSrc * self)
   self->latency = SRT_DEFAULT_LATENCY;
   self->passphrase = NULL;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
+  self->km_refresh_rate = SRT_DEFAULT_KM_REFRESH_RATE;
+  self->km_preannounce = SRT_DEFAULT_KM_PREANNOUNCE;
+  self->stats_interval = SRT_DEFAULT_STATS_INTERVAL;
+  self->packet_filter = NULL;
+  self->transtype = SRT_DEFAULT_TRANSTYPE;
+  self->bitrate = SRT_DEFAULT_BITRATE;
+  self->srt_options = NULL;
+  self->profile = SRT_DEFAULT_PROFILE;
+  gst_srt_thread_config_init (&self->thread_config);
+  self->keyframe_request_interval = SRT_DEFAULT_KEYFRAME_REQUEST_INTERVAL;
+  gst_srt_key_unit_request_init (&self->key_unit);
+  self->auto_latency = SRT_DEFAULT_AUTO_LATENCY;
+  self->auto_latency_probe = SRT_DEFAULT_AUTO_LATENCY_PROBE;
+  g_mutex_init (&self->probe_lock);
+  g_cond_init (&self->probe_cond);
+  self->effective_latency = -1;
+  self->links = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+    g_free);
+  self->ts_check = SRT_DEFAULT_TS_CHECK;
+  self->restore_null_packets = SRT_DEFAULT_NULL_PACKETS;
+  gst_srt_ts_scanner_reset (&self->ts_scanner);
   self->caps = NULL;
-  srt_startup ();
-  GST_INFO_OBJECT (self, "SRT startup");
+  gst_srt_base_src_reset_latency (self);
+  gst_srt_runtime_ref ();
 }
 
 static GstURIType
@@ -339,3 +1216,111 @@ gst_srt_base_src_uri_handler_init (gpointer g_iface, gpointer iface_data)
   iface->get_uri = gst_srt_base_src_uri_get_uri;
   iface->set_uri = gst_srt_base_src_uri_set_uri;
 }
+
+/**
+ * gst_srt_base_src_reset_latency:
+ * @src: a #GstSRTBaseSrc
+ *
+ * Clears the latency statistics, e.g. when a new peer connects.
+ */
+void
+gst_srt_base_src_reset_latency (GstSRTBaseSrc * src)
+{
+  GST_OBJECT_LOCK (src);
+  gst_srt_histogram_reset (&src->recv_latency);
+  gst_srt_histogram_reset (&src->recv_jitter);
+  src->last_transit = G_MININT64;
+  src->jitter = 0;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gst_srt_base_src_record_latency:
+ * @src: a #GstSRTBaseSrc
+ * @ctrl: the message control filled by srt_recvmsg2()
+ *
+ * Records the time between the source time of the message and now, which
+ * is right before the buffer is pushed downstream, and the inter-arrival
+ * jitter as in RFC 3550.
+ */
+void
+gst_srt_base_src_record_latency (GstSRTBaseSrc * src,
+  const SRT_MSGCTRL * ctrl)
+{
+  gint64 now, transit;
+
+  if (ctrl->srctime == 0)
+    return;
+
+#ifdef HAVE_SRT_TIME_NOW
+  now = srt_time_now ();
+#else
+  now = g_get_monotonic_time ();
+#endif
+  transit = now - (gint64)ctrl->srctime;
+
+  GST_OBJECT_LOCK (src);
+#ifdef HAVE_SRT_TIME_NOW
+  /* Without srt_time_now() the clocks are unrelated, so only the jitter
+   * is meaningful */
+  gst_srt_histogram_record (&src->recv_latency, MAX (transit, 0));
+#endif
+
+  if (src->last_transit != G_MININT64) {
+    gint64 d = ABS (transit - src->last_transit);
+
+    gst_srt_histogram_record (&src->recv_jitter, d);
+    src->jitter += (d - src->jitter) / 16.0;
+  }
+  src->last_transit = transit;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gst_srt_base_src_add_latency_stats:
+ * @src: a #GstSRTBaseSrc
+ * @s: the statistics structure to fill
+ *
+ * Adds the "recv-latency-*" and "jitter-*" fields to @s.
+ */
+void
+gst_srt_base_src_add_latency_stats (GstSRTBaseSrc * src, GstStructure * s)
+{
+  GST_OBJECT_LOCK (src);
+#ifdef HAVE_SRT_TIME_NOW
+  gst_srt_histogram_add_to_structure (&src->recv_latency, s, "recv-latency");
+#endif
+  gst_srt_histogram_add_to_structure (&src->recv_jitter, s, "jitter");
+  gst_structure_set (s, "jitter-us", G_TYPE_DOUBLE, src->jitter, NULL);
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gst_srt_base_src_add_ts_stats:
+ * @src: a #GstSRTBaseSrc
+ * @s: the statistics structure to fill
+ *
+ * Adds the "ts-*" fields to @s when #GstSRTBaseSrc:ts-check is enabled.
+ */
+void
+gst_srt_base_src_add_ts_stats (GstSRTBaseSrc * src, GstStructure * s)
+{
+  GST_OBJECT_LOCK (src);
+  if (src->ts_check)
+    gst_srt_ts_scanner_add_to_structure (&src->ts_scanner, s);
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gst_srt_base_src_request_key_unit:
+ * @src: a #GstSRTBaseSrc
+ *
+ * Asks for a keyframe, from any thread. It is sent downstream ahead of
+ * the next buffer, at most once per
+ * #GstSRTBaseSrc:keyframe-request-interval.
+ */
+void
+gst_srt_base_src_request_key_unit (GstSRTBaseSrc * src)
+{
+  gst_srt_key_unit_request_mark (&src->key_unit);
+}
@@ -27,6 +27,12 @@
 
 #include <srt.h>
 
+#include "gstsrt.h"
+#include "gstsrthistogram.h"
+#include "gstsrtlatency.h"
+#include "gstsrtthread.h"
+#include "gstsrttsscan.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_SRT_BASE_SRC               (gst_srt_base_src_get_type ())
@@ -49,6 +55,49 @@ struct _GstSRTBaseSrc {
   gint latency;
   gchar *passphrase;
   gint key_length;
+  gint km_refresh_rate;
+  gint km_preannounce;
+  gint stats_interval;
+  gchar *packet_filter;
+  GstSRTTransType transtype;
+  gint64 bitrate;
+  GstStructure *srt_options;
+  GstSRTProfile profile;
+  GstSRTThreadConfig thread_config;
+  /* the streaming thread before thread_config was applied to it, NULL if
+   * it was not */
+  GstSRTThreadState *thread_state;
+  gint keyframe_request_interval;
+  GstSRTKeyUnitRequest key_unit;
+  gboolean auto_latency;
+  gint auto_latency_probe;
+  /* wakes a probe in start() on unlock() */
+  GMutex probe_lock;
+  GCond probe_cond;
+  gboolean probe_cancelled;
+  /* receiver latency of the current connection, -1 if none */
+  gint effective_latency;
+
+  /* RTT and loss of the session per peer address, for the latency cache */
+  GHashTable *links;
+  GstClockTime link_last_sample;
+
+  GstClockID stats_clock_id;
+  GstClockTime stats_last_time;
+
+  /* latency statistics, protected by the object lock */
+  GstSRTHistogram recv_latency;
+  GstSRTHistogram recv_jitter;
+  gint64 last_transit;
+  gdouble jitter;
+
+  gboolean restore_null_packets;
+  /* a given buffer was too small to restore into, warned once */
+  gboolean restore_warned;
+
+  /* MPEG-TS continuity, protected by the object lock */
+  gboolean ts_check;
+  GstSRTTsScanner ts_scanner;
 
   /*< private >*/
   gpointer _gst_reserved[GST_PADDING];
@@ -58,6 +107,10 @@ struct _GstSRTBaseSrc {
 struct _GstSRTBaseSrcClass {
   GstPushSrcClass parent_class;
 
+  /* call @func for every connected SRT socket */
+  void (*foreach_socket)        (GstSRTBaseSrc *self, GstSRTSocketFunc func,
+                                 gpointer user_data);
+
   gpointer _gst_reserved[GST_PADDING_LARGE];
 
 };
@@ -67,6 +120,27 @@ GType gst_srt_base_src_get_type (void);
 
 GstStructure * gst_srt_base_src_get_stats (SRTSOCKET sock);
 
+void gst_srt_base_src_reset_latency (GstSRTBaseSrc *src);
+
+void gst_srt_base_src_record_latency (GstSRTBaseSrc *src,
+  const SRT_MSGCTRL *ctrl);
+
+void gst_srt_base_src_add_latency_stats (GstSRTBaseSrc *src,
+  GstStructure *s);
+
+void gst_srt_base_src_add_ts_stats (GstSRTBaseSrc *src, GstStructure *s);
+
+void gst_srt_base_src_request_key_unit (GstSRTBaseSrc *src);
+
+gint gst_srt_base_src_get_latency_for_peer (GstSRTBaseSrc *src,
+  const gchar *peer);
+
+gboolean gst_srt_base_src_probe_latency (GstSRTBaseSrc *src,
+  SRTSOCKET sock, const gchar *peer, gint *latency);
+
+void gst_srt_base_src_set_effective_latency (GstSRTBaseSrc *src,
+  SRTSOCKET sock);
+
 G_END_DECLS
 
 #endif /* __GST_SRT_BASE_SRC_H__ */
\ No newline at end of file
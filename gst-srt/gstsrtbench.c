@@ -0,0 +1,692 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* gst-srt-bench: loopback benchmarks of the SRT elements.
+ *
+ *   gst-srt-bench <benchmark> [OPTION...]
+ *
+ * Every benchmark runs its pipelines in this process, over 127.0.0.1, and
+ * writes one row per measurement to --output as CSV or JSON. The plugin is
+ * loaded from the build directory unless --plugin-path is given. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#include <gst/base/gstbasesink.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#ifndef SRT_BENCH_PLUGIN_DIR
+#define SRT_BENCH_PLUGIN_DIR ".libs"
+#endif
+
+struct _GstSRTBenchOutput
+{
+  GPtrArray *rows;
+};
+
+static const GstSRTBenchCommand *commands[] = {
+  &gst_srt_bench_throughput,
+  &gst_srt_bench_fanout,
+  &gst_srt_bench_join,
+  &gst_srt_bench_relay,
+  &gst_srt_bench_fec,
+  &gst_srt_bench_crypto,
+  NULL
+};
+
+static gint next_port;
+
+/* Render times of the timed sink, in microseconds */
+static GMutex render_lock;
+static GstSRTHistogram render_hist;
+static GstFlowReturn (*parent_render) (GstBaseSink * sink, GstBuffer * buf);
+
+gint
+gst_srt_bench_next_port (const GstSRTBenchOptions * options)
+{
+  /* A fresh port for every run, so that a socket still lingering from
+   * the previous run can't be picked up */
+  if (next_port == 0)
+    next_port = options->port;
+
+  return next_port++;
+}
+
+/**
+ * gst_srt_bench_launch:
+ * @format: printf format of a gst-launch pipeline description
+ *
+ * Returns: (transfer full): the pipeline, or %NULL after printing the error
+ */
+GstElement *
+gst_srt_bench_launch (const gchar * format, ...)
+{
+  GError *error = NULL;
+  GstElement *pipeline;
+  gchar *description;
+  va_list args;
+
+  va_start (args, format);
+  description = g_strdup_vprintf (format, args);
+  va_end (args);
+
+  pipeline = gst_parse_launch (description, &error);
+  if (pipeline == NULL || error != NULL) {
+    g_printerr ("Could not create pipeline \"%s\": %s\n", description,
+      error ? error->message : "unknown error");
+    g_clear_error (&error);
+    g_clear_object (&pipeline);
+  }
+  g_free (description);
+
+  return pipeline;
+}
+
+gboolean
+gst_srt_bench_play (GstElement * pipeline)
+{
+  if (gst_element_set_state (pipeline,
+      GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_printerr ("Could not start %s\n", GST_OBJECT_NAME (pipeline));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void
+gst_srt_bench_stop (GstElement * pipeline)
+{
+  if (pipeline == NULL)
+    return;
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+/**
+ * gst_srt_bench_wait:
+ * @pipelines: the pipelines to watch
+ * @n_pipelines: the number of @pipelines
+ * @timeout: how long to wait
+ *
+ * Waits for @timeout, or until one of the pipelines posts an error or EOS.
+ *
+ * Returns: %FALSE if an error or EOS was posted
+ */
+gboolean
+gst_srt_bench_wait (GstElement ** pipelines, guint n_pipelines,
+  GstClockTime timeout)
+{
+  GstClockTime end = gst_util_get_timestamp () + timeout;
+  GstClockTime now;
+
+  while ((now = gst_util_get_timestamp ()) < end) {
+    GstClockTime slice = MIN (end - now, 10 * GST_MSECOND);
+    guint i;
+
+    for (i = 0; i < n_pipelines; i++) {
+      GstBus *bus = gst_element_get_bus (pipelines[i]);
+      GstMessage *msg = gst_bus_timed_pop_filtered (bus,
+        i == 0 ? slice : 0, GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
+
+      gst_object_unref (bus);
+      if (msg == NULL)
+        continue;
+
+      if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+        GError *error = NULL;
+        gchar *debug = NULL;
+
+        gst_message_parse_error (msg, &error, &debug);
+        g_printerr ("Error from %s: %s (%s)\n", GST_OBJECT_NAME (msg->src),
+          error->message, GST_STR_NULL (debug));
+        g_clear_error (&error);
+        g_free (debug);
+      }
+      else {
+        g_printerr ("Unexpected EOS from %s\n", GST_OBJECT_NAME (msg->src));
+      }
+      gst_message_unref (msg);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+counter_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstSRTBenchCounter *counter = user_data;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    guint i, len = gst_buffer_list_length (list);
+
+    for (i = 0; i < len; i++)
+      g_atomic_pointer_add (&counter->bytes,
+        gst_buffer_get_size (gst_buffer_list_get (list, i)));
+    g_atomic_pointer_add (&counter->buffers, len);
+  }
+  else {
+    g_atomic_pointer_add (&counter->bytes,
+      gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info)));
+    g_atomic_pointer_add (&counter->buffers, 1);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Counts what reaches the sink pad of @element_name */
+void
+gst_srt_bench_counter_attach (GstSRTBenchCounter * counter,
+  GstElement * pipeline, const gchar * element_name)
+{
+  GstElement *element = gst_bin_get_by_name (GST_BIN (pipeline),
+    element_name);
+  GstPad *pad = gst_element_get_static_pad (element, "sink");
+
+  memset (counter, 0, sizeof (GstSRTBenchCounter));
+  gst_pad_add_probe (pad,
+    GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+    counter_probe, counter, NULL);
+
+  gst_object_unref (pad);
+  gst_object_unref (element);
+}
+
+static GstFlowReturn
+timed_sink_render (GstBaseSink * sink, GstBuffer * buf)
+{
+  GstClockTime start = gst_util_get_timestamp ();
+  GstFlowReturn ret = parent_render (sink, buf);
+  GstClockTime duration = gst_util_get_timestamp () - start;
+
+  g_mutex_lock (&render_lock);
+  gst_srt_histogram_record (&render_hist, duration / GST_USECOND);
+  g_mutex_unlock (&render_lock);
+
+  return ret;
+}
+
+static void
+timed_sink_class_init (gpointer g_class, gpointer class_data)
+{
+  GstBaseSinkClass *basesink_class = GST_BASE_SINK_CLASS (g_class);
+
+  parent_render = basesink_class->render;
+  basesink_class->render = timed_sink_render;
+}
+
+/**
+ * gst_srt_bench_register_timed_sink:
+ * @parent_name: factory name of a #GstBaseSink, e.g. "srtserversink"
+ * @name: factory name to register
+ *
+ * Registers a subclass of @parent_name whose render calls are timed, as
+ * the plugin isn't linked in and can't be instrumented directly. Only one
+ * timed sink can be registered.
+ */
+gboolean
+gst_srt_bench_register_timed_sink (const gchar * parent_name,
+  const gchar * name)
+{
+  GstElementFactory *factory = gst_element_factory_find (parent_name);
+  GTypeInfo info = { 0, };
+  GTypeQuery query;
+  GType parent, type;
+  gchar *type_name;
+
+  g_return_val_if_fail (parent_render == NULL, FALSE);
+
+  if (factory == NULL)
+    return FALSE;
+  factory = GST_ELEMENT_FACTORY (gst_plugin_feature_load
+    (GST_PLUGIN_FEATURE (factory)));
+  if (factory == NULL)
+    return FALSE;
+  parent = gst_element_factory_get_element_type (factory);
+  gst_object_unref (factory);
+
+  g_type_query (parent, &query);
+  info.class_size = query.class_size;
+  info.instance_size = query.instance_size;
+  info.class_init = timed_sink_class_init;
+
+  type_name = g_strdup_printf ("%sTimed", g_type_name (parent));
+  type = g_type_register_static (parent, type_name, &info, 0);
+  g_free (type_name);
+
+  return gst_element_register (NULL, name, GST_RANK_NONE, type);
+}
+
+void
+gst_srt_bench_timed_sink_reset (void)
+{
+  g_mutex_lock (&render_lock);
+  gst_srt_histogram_reset (&render_hist);
+  g_mutex_unlock (&render_lock);
+}
+
+/* Copies the render times since the last reset into @hist */
+void
+gst_srt_bench_timed_sink_get (GstSRTHistogram * hist)
+{
+  g_mutex_lock (&render_lock);
+  *hist = render_hist;
+  g_mutex_unlock (&render_lock);
+}
+
+/* User and system CPU time of the process, in seconds */
+gdouble
+gst_srt_bench_cpu_time (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+    usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#else
+  return 0;
+#endif
+}
+
+static gint64
+value_to_int64 (const GValue * value)
+{
+  switch (G_VALUE_TYPE (value)) {
+  case G_TYPE_INT:
+    return g_value_get_int (value);
+  case G_TYPE_UINT:
+    return g_value_get_uint (value);
+  case G_TYPE_INT64:
+    return g_value_get_int64 (value);
+  case G_TYPE_UINT64:
+    return (gint64)g_value_get_uint64 (value);
+  case G_TYPE_DOUBLE:
+    return (gint64)g_value_get_double (value);
+  default:
+    return 0;
+  }
+}
+
+static gint64
+structure_get_stat (const GstStructure * s, const gchar * field)
+{
+  const GValue *value = s ? gst_structure_get_value (s, field) : NULL;
+
+  return value ? value_to_int64 (value) : 0;
+}
+
+/**
+ * gst_srt_bench_get_stat:
+ * @pipeline: a pipeline
+ * @element_name: name of a SRT element in @pipeline
+ * @field: a field of its "stats" structure
+ *
+ * Returns: the value of @field, summed over all the connections of a
+ * server sink, or 0 if the element has no such statistic.
+ */
+gint64
+gst_srt_bench_get_stat (GstElement * pipeline, const gchar * element_name,
+  const gchar * field)
+{
+  GstElement *element = gst_bin_get_by_name (GST_BIN (pipeline),
+    element_name);
+  GParamSpec *pspec;
+  GValue value = G_VALUE_INIT;
+  gint64 result = 0;
+
+  if (element == NULL)
+    return 0;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+    "stats");
+  if (pspec == NULL)
+    goto out;
+
+  g_value_init (&value, pspec->value_type);
+  g_object_get_property (G_OBJECT (element), "stats", &value);
+
+  if (GST_VALUE_HOLDS_ARRAY (&value)) {
+    guint i;
+
+    for (i = 0; i < gst_value_array_get_size (&value); i++)
+      result += structure_get_stat (gst_value_get_structure
+        (gst_value_array_get_value (&value, i)), field);
+  }
+  else if (G_VALUE_HOLDS (&value, GST_TYPE_STRUCTURE)) {
+    result = structure_get_stat (gst_value_get_structure (&value), field);
+  }
+  g_value_unset (&value);
+
+out:
+  gst_object_unref (element);
+  return result;
+}
+
+/* Parses a comma separated list of integers, e.g. "188,1316" */
+gint *
+gst_srt_bench_parse_list (const gchar * list, guint * n_values)
+{
+  gchar **items = g_strsplit (list, ",", -1);
+  gint *values = g_new0 (gint, g_strv_length (items) + 1);
+  guint i, n = 0;
+
+  for (i = 0; items[i]; i++) {
+    gchar *end = NULL;
+    gint64 value = g_ascii_strtoll (items[i], &end, 10);
+
+    if (end == items[i] || *end != '\0' || value <= 0 || value > G_MAXINT) {
+      g_printerr ("Ignoring invalid value '%s'\n", items[i]);
+      continue;
+    }
+    values[n++] = (gint)value;
+  }
+  g_strfreev (items);
+
+  *n_values = n;
+  return values;
+}
+
+void
+gst_srt_bench_output_add (GstSRTBenchOutput * out, GstStructure * row)
+{
+  gchar *str = gst_structure_to_string (row);
+
+  /* Progress on the terminal, stdout may get the results at the end */
+  g_printerr ("%s\n", str);
+  g_free (str);
+
+  g_ptr_array_add (out->rows, row);
+}
+
+/* Quotes @str as a JSON string */
+static gchar *
+json_quote (const gchar * str)
+{
+  GString *out = g_string_new ("\"");
+
+  for (; *str; str++) {
+    guchar c = *str;
+
+    switch (c) {
+    case '"':
+      g_string_append (out, "\\\"");
+      break;
+    case '\\':
+      g_string_append (out, "\\\\");
+      break;
+    case '\n':
+      g_string_append (out, "\\n");
+      break;
+    case '\r':
+      g_string_append (out, "\\r");
+      break;
+    case '\t':
+      g_string_append (out, "\\t");
+      break;
+    default:
+      /* UTF-8 sequences go through as they are */
+      if (c < 0x20)
+        g_string_append_printf (out, "\\u%04x", c);
+      else
+        g_string_append_c (out, c);
+      break;
+    }
+  }
+  g_string_append_c (out, '"');
+
+  return g_string_free (out, FALSE);
+}
+
+static gchar *
+value_serialize (const GValue * value, gboolean json)
+{
+  if (G_VALUE_HOLDS_STRING (value)) {
+    const gchar *str = g_value_get_string (value);
+
+    if (json)
+      return json_quote (str ? str : "");
+    return g_strdup (str ? str : "");
+  }
+  if (G_VALUE_HOLDS_DOUBLE (value)) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (json && !isfinite (g_value_get_double (value)))
+      return g_strdup ("null");
+
+    return g_strdup (g_ascii_formatd (buf, sizeof (buf), "%.6g",
+        g_value_get_double (value)));
+  }
+  if (G_VALUE_HOLDS_BOOLEAN (value))
+    return g_strdup (g_value_get_boolean (value) ? "true" : "false");
+
+  /* Anything but an integer is not a JSON number */
+  if (json && !G_VALUE_HOLDS_INT (value) && !G_VALUE_HOLDS_UINT (value)
+      && !G_VALUE_HOLDS_INT64 (value) && !G_VALUE_HOLDS_UINT64 (value)) {
+    gchar *str = gst_value_serialize (value);
+    gchar *quoted = json_quote (str ? str : "");
+
+    g_free (str);
+    return quoted;
+  }
+
+  return gst_value_serialize (value);
+}
+
+static void
+write_csv (GstSRTBenchOutput * out, GString * str)
+{
+  guint i, j;
+
+  for (i = 0; i < out->rows->len; i++) {
+    GstStructure *row = g_ptr_array_index (out->rows, i);
+    guint n = gst_structure_n_fields (row);
+
+    /* A new header whenever the columns change, e.g. between the two
+     * directions of a benchmark */
+    if (i == 0 || !gst_structure_has_name (g_ptr_array_index (out->rows,
+          i - 1), gst_structure_get_name (row))) {
+      g_string_append (str, "benchmark");
+      for (j = 0; j < n; j++)
+        g_string_append_printf (str, ",%s", gst_structure_nth_field_name (row,
+            j));
+      g_string_append_c (str, '\n');
+    }
+
+    g_string_append (str, gst_structure_get_name (row));
+    for (j = 0; j < n; j++) {
+      gchar *value = value_serialize (gst_structure_get_value (row,
+          gst_structure_nth_field_name (row, j)), FALSE);
+
+      g_string_append_printf (str, ",%s", value);
+      g_free (value);
+    }
+    g_string_append_c (str, '\n');
+  }
+}
+
+static void
+write_json (GstSRTBenchOutput * out, GString * str)
+{
+  guint i, j;
+
+  g_string_append (str, "[\n");
+  for (i = 0; i < out->rows->len; i++) {
+    GstStructure *row = g_ptr_array_index (out->rows, i);
+    gchar *name = json_quote (gst_structure_get_name (row));
+
+    g_string_append_printf (str, "  {\"benchmark\": %s", name);
+    g_free (name);
+    for (j = 0; j < gst_structure_n_fields (row); j++) {
+      const gchar *field = gst_structure_nth_field_name (row, j);
+      gchar *key = json_quote (field);
+      gchar *value = value_serialize (gst_structure_get_value (row, field),
+        TRUE);
+
+      g_string_append_printf (str, ", %s: %s", key, value);
+      g_free (key);
+      g_free (value);
+    }
+    g_string_append_printf (str, "}%s\n", i + 1 < out->rows->len ? "," : "");
+  }
+  g_string_append (str, "]\n");
+}
+
+static void
+print_usage (void)
+{
+  guint i;
+
+  g_printerr ("Usage: gst-srt-bench <benchmark> [OPTION...]\n\n"
+    "Benchmarks:\n");
+  for (i = 0; commands[i]; i++)
+    g_printerr ("  %-12s %s\n", commands[i]->name, commands[i]->description);
+  g_printerr ("\nRun gst-srt-bench <benchmark> --help for its options.\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  const GstSRTBenchCommand *command = NULL;
+  GstSRTBenchOptions options = {
+    SRT_BENCH_DEFAULT_PORT, SRT_BENCH_DEFAULT_DURATION,
+    SRT_BENCH_DEFAULT_WARMUP, SRT_BENCH_DEFAULT_LATENCY
+  };
+  gchar *output = NULL, *format = NULL, *plugin_path = NULL;
+  GOptionEntry entries[] = {
+    {"port", 'p', 0, G_OPTION_ARG_INT, &options.port,
+      "First UDP port to use", "PORT"},
+    {"duration", 'd', 0, G_OPTION_ARG_INT, &options.duration,
+      "Seconds to measure for, per run", "SECONDS"},
+    {"warmup", 'w', 0, G_OPTION_ARG_INT, &options.warmup,
+      "Seconds to run before measuring", "SECONDS"},
+    {"latency", 'l', 0, G_OPTION_ARG_INT, &options.latency,
+      "SRT latency in milliseconds", "MS"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+      "Write the results to this file instead of stdout", "FILE"},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+      "csv or json, guessed from the output file name by default", "FORMAT"},
+    {"plugin-path", 0, 0, G_OPTION_ARG_FILENAME, &plugin_path,
+      "Directory to load the SRT plugin from", "DIR"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GstPluginFeature *feature;
+  GError *error = NULL;
+  GstSRTBenchOutput out;
+  GString *str;
+  gboolean ret;
+  gchar *summary;
+  guint i;
+
+  if (argc < 2 || argv[1][0] == '-') {
+    print_usage ();
+    return 1;
+  }
+
+  for (i = 0; commands[i]; i++) {
+    if (g_str_equal (commands[i]->name, argv[1]))
+      command = commands[i];
+  }
+  if (command == NULL) {
+    g_printerr ("Unknown benchmark '%s'\n\n", argv[1]);
+    print_usage ();
+    return 1;
+  }
+
+  summary = g_strdup_printf ("%s: %s", command->name, command->description);
+  ctx = g_option_context_new (command->name);
+  g_option_context_set_summary (ctx, summary);
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  if (command->add_options)
+    command->add_options (ctx);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+  /* Skip the benchmark name */
+  argv[1] = argv[0];
+  argc--;
+  argv++;
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_clear_error (&error);
+    return 1;
+  }
+  g_option_context_free (ctx);
+  g_free (summary);
+
+  if (format == NULL)
+    format = g_strdup (output && g_str_has_suffix (output, ".json") ?
+      "json" : "csv");
+  if (!g_str_equal (format, "csv") && !g_str_equal (format, "json")) {
+    g_printerr ("Unknown output format '%s'\n", format);
+    return 1;
+  }
+
+  gst_registry_scan_path (gst_registry_get (),
+    plugin_path ? plugin_path : SRT_BENCH_PLUGIN_DIR);
+  feature = gst_registry_lookup_feature (gst_registry_get (),
+    "srtserversink");
+  if (feature == NULL) {
+    g_printerr ("SRT plugin not found, use --plugin-path\n");
+    return 1;
+  }
+  gst_object_unref (feature);
+
+  out.rows = g_ptr_array_new_with_free_func ((GDestroyNotify)
+    gst_structure_free);
+  ret = command->run (&options, &out);
+
+  str = g_string_new (NULL);
+  if (g_str_equal (format, "json"))
+    write_json (&out, str);
+  else
+    write_csv (&out, str);
+
+  if (output == NULL) {
+    fputs (str->str, stdout);
+  }
+  else if (!g_file_set_contents (output, str->str, str->len, &error)) {
+    g_printerr ("Could not write %s: %s\n", output, error->message);
+    g_clear_error (&error);
+    ret = FALSE;
+  }
+
+  g_string_free (str, TRUE);
+  g_ptr_array_unref (out.rows);
+  g_free (plugin_path);
+  g_free (format);
+  g_free (output);
+
+  return ret ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_BENCH_H__
+#define __GST_SRT_BENCH_H__
+
+#include <gst/gst.h>
+
+#include "gstsrthistogram.h"
+
+G_BEGIN_DECLS
+
+#define SRT_BENCH_DEFAULT_PORT 7100
+#define SRT_BENCH_DEFAULT_DURATION 5
+#define SRT_BENCH_DEFAULT_WARMUP 1
+#define SRT_BENCH_DEFAULT_LATENCY 125
+
+/* Results of a benchmark, one structure per measurement, written as CSV or
+ * JSON once the benchmark is done */
+typedef struct _GstSRTBenchOutput GstSRTBenchOutput;
+
+/* Options shared by all benchmarks */
+typedef struct
+{
+  gint port;
+  gint duration;
+  gint warmup;
+  gint latency;
+} GstSRTBenchOptions;
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *description;
+  /* Adds its own options to @ctx */
+  void (*add_options) (GOptionContext * ctx);
+  gboolean (*run) (const GstSRTBenchOptions * options,
+    GstSRTBenchOutput * out);
+} GstSRTBenchCommand;
+
+/* What the impairment relay does to the packets going through it */
+typedef struct
+{
+  /* percentage of packets dropped at random */
+  gdouble loss;
+  /* percentage of packets starting a loss burst, and its mean length in
+   * packets (Gilbert-Elliott model) */
+  gdouble burst_enter;
+  gdouble burst_length;
+  /* fixed delay, plus a uniformly distributed jitter, in milliseconds */
+  gint delay;
+  gint jitter;
+  /* percentage of packets held back by reorder_delay milliseconds, letting
+   * the following packets overtake them */
+  gdouble reorder;
+  gint reorder_delay;
+  /* bottleneck bandwidth in kbit/s (0 for unlimited) and how many
+   * milliseconds of data it queues before dropping */
+  gint bandwidth;
+  gint queue;
+  /* also impair the return path, i.e. the ACKs and NAKs */
+  gboolean both_ways;
+  gint seed;
+} GstSRTBenchImpairment;
+
+/* A UDP relay on 127.0.0.1 that applies a #GstSRTBenchImpairment */
+typedef struct _GstSRTBenchRelay GstSRTBenchRelay;
+
+/* Counts the buffers flowing through a pad */
+typedef struct
+{
+  volatile gsize buffers;
+  volatile gsize bytes;
+} GstSRTBenchCounter;
+
+extern const GstSRTBenchCommand gst_srt_bench_throughput;
+extern const GstSRTBenchCommand gst_srt_bench_fanout;
+extern const GstSRTBenchCommand gst_srt_bench_join;
+extern const GstSRTBenchCommand gst_srt_bench_relay;
+extern const GstSRTBenchCommand gst_srt_bench_fec;
+extern const GstSRTBenchCommand gst_srt_bench_crypto;
+
+gint gst_srt_bench_next_port (const GstSRTBenchOptions * options);
+
+GstElement * gst_srt_bench_launch (const gchar * format, ...)
+  G_GNUC_PRINTF (1, 2);
+
+gboolean gst_srt_bench_play (GstElement * pipeline);
+
+void gst_srt_bench_stop (GstElement * pipeline);
+
+gboolean gst_srt_bench_wait (GstElement ** pipelines, guint n_pipelines,
+  GstClockTime timeout);
+
+void gst_srt_bench_counter_attach (GstSRTBenchCounter * counter,
+  GstElement * pipeline, const gchar * element_name);
+
+gdouble gst_srt_bench_cpu_time (void);
+
+gint64 gst_srt_bench_get_stat (GstElement * pipeline,
+  const gchar * element_name, const gchar * field);
+
+gint * gst_srt_bench_parse_list (const gchar * list, guint * n_values);
+
+gboolean gst_srt_bench_register_timed_sink (const gchar * parent_name,
+  const gchar * name);
+
+void gst_srt_bench_timed_sink_reset (void);
+
+void gst_srt_bench_timed_sink_get (GstSRTHistogram * hist);
+
+void gst_srt_bench_impairment_add_options (GOptionContext * ctx,
+  GstSRTBenchImpairment * impairment);
+
+GstSRTBenchRelay * gst_srt_bench_relay_new (gint port, gint target_port,
+  const GstSRTBenchImpairment * impairment);
+
+void gst_srt_bench_relay_add_stats (GstSRTBenchRelay * relay,
+  GstStructure * row);
+
+void gst_srt_bench_relay_free (GstSRTBenchRelay * relay);
+
+void gst_srt_bench_output_add (GstSRTBenchOutput * out, GstStructure * row);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_BENCH_H__ */
@@ -0,0 +1,161 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The "crypto" benchmark: the CPU cost of encryption. The same stream goes
+ * srtclientsink -> srtserversrc unencrypted and with AES-128, AES-192 and
+ * AES-256, at a range of bitrates. Both ends run in this process, so the
+ * CPU time covers the encryption and the decryption; the difference to the
+ * unencrypted row of the same bitrate is what the cipher costs. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#define SRT_BENCH_DEFAULT_CRYPTO_BITRATES "10,50,200"
+#define SRT_BENCH_DEFAULT_CRYPTO_SIZE 1316
+#define SRT_BENCH_CRYPTO_PASSPHRASE "gst-srt-bench-passphrase"
+
+/* 0 for no encryption */
+static const gint key_lengths[] = { 0, 16, 24, 32 };
+
+static gchar *bitrates_list;
+static gint size = SRT_BENCH_DEFAULT_CRYPTO_SIZE;
+static gint km_refresh_rate = 0;
+
+static GOptionEntry entries[] = {
+  {"bitrates", 'b', 0, G_OPTION_ARG_STRING, &bitrates_list,
+    "Bitrates in Mb/s (default: " SRT_BENCH_DEFAULT_CRYPTO_BITRATES ")",
+    "LIST"},
+  {"size", 's', 0, G_OPTION_ARG_INT, &size,
+    "Payload size in bytes", "BYTES"},
+  {"km-refresh-rate", 'r', 0, G_OPTION_ARG_INT, &km_refresh_rate,
+    "Packets between two key switches (default: the SRT one)", "PACKETS"},
+  {NULL}
+};
+
+static void
+crypto_add_options (GOptionContext * ctx)
+{
+  g_option_context_add_main_entries (ctx, entries, NULL);
+}
+
+static gboolean
+crypto_run_one (const GstSRTBenchOptions * options, gint key_length,
+  gint mbps, GstSRTBenchOutput * out)
+{
+  gint port = gst_srt_bench_next_port (options);
+  GstElement *pipelines[2] = { NULL, NULL };
+  GstSRTBenchCounter counter;
+  gchar *encryption;
+  gsize start_bytes;
+  gdouble start_cpu, cpu, elapsed, achieved;
+  GstClockTime start_time;
+  gboolean ret = FALSE;
+
+  if (key_length > 0)
+    encryption = g_strdup_printf ("passphrase=%s key-length=%d",
+      SRT_BENCH_CRYPTO_PASSPHRASE, key_length);
+  else
+    encryption = g_strdup ("");
+
+  pipelines[0] = gst_srt_bench_launch ("srtserversrc name=srt "
+    "uri=srt://:%d latency=%d %s ! fakesink name=sink sync=false "
+    "async=false", port, options->latency, encryption);
+  if (pipelines[0] == NULL)
+    goto out;
+  gst_srt_bench_counter_attach (&counter, pipelines[0], "sink");
+  if (!gst_srt_bench_play (pipelines[0]))
+    goto out;
+
+  pipelines[1] = gst_srt_bench_launch ("fakesrc sizetype=fixed sizemax=%d "
+    "filltype=zero format=time datarate=%" G_GINT64_FORMAT " ! "
+    "srtclientsink name=srt uri=srt://127.0.0.1:%d latency=%d %s "
+    "km-refresh-rate=%d", size, (gint64)mbps * 1000000 / 8, port,
+    options->latency, encryption, km_refresh_rate);
+  if (pipelines[1] == NULL || !gst_srt_bench_play (pipelines[1]))
+    goto out;
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->warmup * GST_SECOND))
+    goto out;
+
+  start_bytes = g_atomic_pointer_get (&counter.bytes);
+  start_cpu = gst_srt_bench_cpu_time ();
+  start_time = gst_util_get_timestamp ();
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->duration * GST_SECOND))
+    goto out;
+
+  cpu = gst_srt_bench_cpu_time () - start_cpu;
+  elapsed = (gdouble)(gst_util_get_timestamp () - start_time) / GST_SECOND;
+  achieved = (g_atomic_pointer_get (&counter.bytes) - start_bytes) * 8 /
+    elapsed / 1e6;
+
+  gst_srt_bench_output_add (out, gst_structure_new ("crypto",
+    "cipher", G_TYPE_STRING, key_length == 16 ? "aes-128" :
+    key_length == 24 ? "aes-192" : key_length == 32 ? "aes-256" : "none",
+    "payload-size", G_TYPE_INT, size,
+    "target-mbps", G_TYPE_INT, mbps,
+    "achieved-mbps", G_TYPE_DOUBLE, achieved,
+    "cpu-percent", G_TYPE_DOUBLE, cpu / elapsed * 100,
+    /* CPU seconds per gigabit, sender and receiver together */
+    "cpu-seconds-per-gbit", G_TYPE_DOUBLE,
+    achieved > 0 ? cpu / (achieved * elapsed / 1000) : 0.0,
+    "packets-lost", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-recv-lost"),
+    "packets-dropped", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-recv-dropped"),
+    NULL));
+  ret = TRUE;
+
+out:
+  /* Receiver first, so that it doesn't see the sender go away */
+  gst_srt_bench_stop (pipelines[0]);
+  gst_srt_bench_stop (pipelines[1]);
+  g_free (encryption);
+
+  return ret;
+}
+
+static gboolean
+crypto_run (const GstSRTBenchOptions * options, GstSRTBenchOutput * out)
+{
+  guint n_bitrates, i, j;
+  gint *bitrates = gst_srt_bench_parse_list (bitrates_list ? bitrates_list :
+    SRT_BENCH_DEFAULT_CRYPTO_BITRATES, &n_bitrates);
+  gboolean ret = TRUE;
+
+  for (i = 0; i < n_bitrates; i++) {
+    for (j = 0; j < G_N_ELEMENTS (key_lengths); j++) {
+      if (!crypto_run_one (options, key_lengths[j], bitrates[i], out))
+        ret = FALSE;
+    }
+  }
+
+  g_free (bitrates);
+
+  return ret;
+}
+
+const GstSRTBenchCommand gst_srt_bench_crypto = {
+  "crypto",
+  "CPU cost of AES-128/192/256 encryption at a range of bitrates",
+  crypto_add_options,
+  crypto_run
+};
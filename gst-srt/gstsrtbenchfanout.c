@@ -0,0 +1,212 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Fan-out scaling of srtserversink: one sender and N loopback srtclientsrc
+ * receivers, for every N of --clients.
+ *
+ * The server sink is a subclass whose render calls are timed, which gives
+ * the time it takes to send one buffer to every client. Receivers never
+ * leave on their own, so every "client-removed" during a run is a client
+ * dropped for failing to keep up (MAX_SEND_FAILS) or a failed send. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#define SRT_BENCH_DEFAULT_CLIENTS "1,10,50,100,200,500"
+#define SRT_BENCH_DEFAULT_FANOUT_BITRATE 2
+#define SRT_BENCH_DEFAULT_FANOUT_SIZE 1316
+
+static gchar *clients_list;
+static gint bitrate = SRT_BENCH_DEFAULT_FANOUT_BITRATE;
+static gint size = SRT_BENCH_DEFAULT_FANOUT_SIZE;
+
+static GOptionEntry entries[] = {
+  {"clients", 'c', 0, G_OPTION_ARG_STRING, &clients_list,
+    "Numbers of receivers (default: " SRT_BENCH_DEFAULT_CLIENTS ")", "LIST"},
+  {"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+    "Bitrate of the stream in Mb/s", "MBPS"},
+  {"size", 's', 0, G_OPTION_ARG_INT, &size,
+    "Payload size in bytes", "BYTES"},
+  {NULL}
+};
+
+static void
+fanout_add_options (GOptionContext * ctx)
+{
+  g_option_context_add_main_entries (ctx, entries, NULL);
+}
+
+static void
+client_added_cb (GstElement * sink, gint sock, GObject * addr,
+  gint * added)
+{
+  g_atomic_int_inc (added);
+}
+
+static void
+client_removed_cb (GstElement * sink, gint sock, GObject * addr,
+  gint * removed)
+{
+  g_atomic_int_inc (removed);
+}
+
+static gboolean
+fanout_run_one (const GstSRTBenchOptions * options, guint n_clients,
+  GstSRTBenchOutput * out)
+{
+  gint port = gst_srt_bench_next_port (options);
+  GstElement **pipelines = g_new0 (GstElement *, n_clients + 1);
+  GstSRTBenchCounter *counters = g_new0 (GstSRTBenchCounter, n_clients);
+  gsize *start_bytes = g_new0 (gsize, n_clients);
+  GstElement *sender, *srt = NULL;
+  gint added = 0, removed = 0, start_removed;
+  gdouble start_cpu, cpu, elapsed, total = 0, min = G_MAXDOUBLE, max = 0;
+  GstClockTime start_time;
+  GstSRTHistogram render;
+  gboolean ret = FALSE;
+  guint i;
+
+  sender = gst_srt_bench_launch ("fakesrc sizetype=fixed sizemax=%d "
+    "filltype=zero format=time datarate=%d ! srtbenchserversink name=srt "
+    "uri=srt://:%d latency=%d", size, bitrate * 1000000 / 8, port,
+    options->latency);
+  if (sender == NULL)
+    goto out;
+  pipelines[0] = sender;
+
+  srt = gst_bin_get_by_name (GST_BIN (sender), "srt");
+  g_signal_connect (srt, "client-added", G_CALLBACK (client_added_cb),
+    &added);
+  g_signal_connect (srt, "client-removed", G_CALLBACK (client_removed_cb),
+    &removed);
+  if (!gst_srt_bench_play (sender))
+    goto out;
+
+  for (i = 0; i < n_clients; i++) {
+    pipelines[i + 1] = gst_srt_bench_launch ("srtclientsrc "
+      "uri=srt://127.0.0.1:%d latency=%d ! fakesink name=sink sync=false "
+      "async=false", port, options->latency);
+    if (pipelines[i + 1] == NULL)
+      goto out;
+    gst_srt_bench_counter_attach (&counters[i], pipelines[i + 1], "sink");
+    if (!gst_srt_bench_play (pipelines[i + 1]))
+      goto out;
+  }
+
+  if (!gst_srt_bench_wait (pipelines, n_clients + 1,
+      options->warmup * GST_SECOND))
+    goto out;
+
+  for (i = 0; i < n_clients; i++)
+    start_bytes[i] = g_atomic_pointer_get (&counters[i].bytes);
+  start_removed = g_atomic_int_get (&removed);
+  gst_srt_bench_timed_sink_reset ();
+  start_cpu = gst_srt_bench_cpu_time ();
+  start_time = gst_util_get_timestamp ();
+
+  if (!gst_srt_bench_wait (pipelines, n_clients + 1,
+      options->duration * GST_SECOND))
+    goto out;
+
+  gst_srt_bench_timed_sink_get (&render);
+  cpu = gst_srt_bench_cpu_time () - start_cpu;
+  elapsed = (gdouble)(gst_util_get_timestamp () - start_time) / GST_SECOND;
+
+  for (i = 0; i < n_clients; i++) {
+    gdouble mbps = (g_atomic_pointer_get (&counters[i].bytes) -
+      start_bytes[i]) * 8 / elapsed / 1e6;
+
+    total += mbps;
+    min = MIN (min, mbps);
+    max = MAX (max, mbps);
+  }
+
+  gst_srt_bench_output_add (out, gst_structure_new ("fanout",
+    "clients", G_TYPE_UINT, n_clients,
+    "bitrate-mbps", G_TYPE_INT, bitrate,
+    "payload-size", G_TYPE_INT, size,
+    "render-calls", G_TYPE_UINT64, render.samples,
+    "render-p50-us", G_TYPE_UINT64, gst_srt_histogram_percentile (&render,
+      50.0),
+    "render-p99-us", G_TYPE_UINT64, gst_srt_histogram_percentile (&render,
+      99.0),
+    "render-p999-us", G_TYPE_UINT64, gst_srt_histogram_percentile (&render,
+      99.9),
+    "render-max-us", G_TYPE_UINT64, render.max,
+    "cpu-percent", G_TYPE_DOUBLE, cpu / elapsed * 100,
+    "goodput-min-mbps", G_TYPE_DOUBLE, n_clients ? min : 0.0,
+    "goodput-avg-mbps", G_TYPE_DOUBLE, n_clients ? total / n_clients : 0.0,
+    "goodput-max-mbps", G_TYPE_DOUBLE, max,
+    "goodput-total-mbps", G_TYPE_DOUBLE, total,
+    "clients-connected", G_TYPE_INT,
+    g_atomic_int_get (&added) - g_atomic_int_get (&removed),
+    "clients-removed", G_TYPE_INT, g_atomic_int_get (&removed) -
+    start_removed, NULL));
+  ret = TRUE;
+
+out:
+  for (i = n_clients; i > 0; i--)
+    gst_srt_bench_stop (pipelines[i]);
+  if (srt != NULL) {
+    g_signal_handlers_disconnect_by_data (srt, &added);
+    g_signal_handlers_disconnect_by_data (srt, &removed);
+    gst_object_unref (srt);
+  }
+  gst_srt_bench_stop (sender);
+
+  g_free (start_bytes);
+  g_free (counters);
+  g_free (pipelines);
+
+  return ret;
+}
+
+static gboolean
+fanout_run (const GstSRTBenchOptions * options, GstSRTBenchOutput * out)
+{
+  guint n_clients, i;
+  gint *clients = gst_srt_bench_parse_list (clients_list ? clients_list :
+    SRT_BENCH_DEFAULT_CLIENTS, &n_clients);
+  gboolean ret = TRUE;
+
+  if (!gst_srt_bench_register_timed_sink ("srtserversink",
+      "srtbenchserversink")) {
+    g_printerr ("Could not register the timed srtserversink\n");
+    g_free (clients);
+    return FALSE;
+  }
+
+  for (i = 0; i < n_clients; i++) {
+    if (!fanout_run_one (options, clients[i], out))
+      ret = FALSE;
+  }
+
+  g_free (clients);
+
+  return ret;
+}
+
+const GstSRTBenchCommand gst_srt_bench_fanout = {
+  "fanout",
+  "srtserversink render time, CPU, goodput and drops for N receivers",
+  fanout_add_options,
+  fanout_run
+};
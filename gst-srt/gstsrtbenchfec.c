@@ -0,0 +1,240 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The "fec" benchmark: the same stream through the impairment relay with
+ * plain ARQ, with FEC backed by ARQ, and with FEC alone, for a range of
+ * loss rates and latencies. The bandwidth overhead counts both the
+ * retransmissions and the FEC control packets against the original data
+ * packets, so the recovery of each mode can be weighed against its cost. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#include <string.h>
+
+#define SRT_BENCH_DEFAULT_FEC_FILTER "fec,cols:10,rows:5"
+#define SRT_BENCH_DEFAULT_FEC_LATENCIES "40,125"
+#define SRT_BENCH_DEFAULT_FEC_LOSSES "0.5,1,2,5"
+#define SRT_BENCH_DEFAULT_FEC_BITRATE 10
+#define SRT_BENCH_DEFAULT_FEC_SIZE 1316
+
+typedef struct
+{
+  const gchar *name;
+  /* appended to the filter configuration, NULL for no filter at all */
+  const gchar *arq;
+} FecMode;
+
+static const FecMode modes[] = {
+  {"arq", NULL},
+  {"fec+arq", ",arq:onreq"},
+  {"fec", ",arq:never"},
+};
+
+static GstSRTBenchImpairment impairment = {
+  0.0, 0.0, 1.0, 50, 0, 0.0, 10, 0, 100, TRUE, 1
+};
+static gchar *filter = NULL;
+static gchar *latencies_list;
+static gchar *losses_list;
+static gint bitrate = SRT_BENCH_DEFAULT_FEC_BITRATE;
+static gint size = SRT_BENCH_DEFAULT_FEC_SIZE;
+
+static GOptionEntry entries[] = {
+  {"filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+    "FEC configuration (default: " SRT_BENCH_DEFAULT_FEC_FILTER ")",
+    "FILTER"},
+  {"latencies", 'L', 0, G_OPTION_ARG_STRING, &latencies_list,
+    "SRT latencies in ms (default: " SRT_BENCH_DEFAULT_FEC_LATENCIES ")",
+    "LIST"},
+  {"losses", 'l', 0, G_OPTION_ARG_STRING, &losses_list,
+    "Loss percentages (default: " SRT_BENCH_DEFAULT_FEC_LOSSES ")", "LIST"},
+  {"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+    "Bitrate of the stream in Mb/s", "MBPS"},
+  {"size", 's', 0, G_OPTION_ARG_INT, &size,
+    "Payload size in bytes", "BYTES"},
+  {NULL}
+};
+
+static void
+fec_add_options (GOptionContext * ctx)
+{
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  gst_srt_bench_impairment_add_options (ctx, &impairment);
+}
+
+static gdouble *
+fec_parse_losses (const gchar * list, guint * n_values)
+{
+  gchar **items = g_strsplit (list, ",", -1);
+  gdouble *values = g_new0 (gdouble, g_strv_length (items) + 1);
+  guint i, n = 0;
+
+  for (i = 0; items[i]; i++) {
+    gchar *end = NULL;
+    gdouble value = g_ascii_strtod (items[i], &end);
+
+    if (end == items[i] || *end != '\0' || value < 0 || value >= 100) {
+      g_printerr ("Ignoring invalid loss '%s'\n", items[i]);
+      continue;
+    }
+    values[n++] = value;
+  }
+  g_strfreev (items);
+
+  *n_values = n;
+  return values;
+}
+
+static gboolean
+fec_run_one (const GstSRTBenchOptions * options, const FecMode * mode,
+  gint latency, GstSRTBenchOutput * out)
+{
+  gint port = gst_srt_bench_next_port (options);
+  gint relay_port = gst_srt_bench_next_port (options);
+  GstElement *pipelines[2] = { NULL, NULL };
+  GstSRTBenchRelay *relay = NULL;
+  GstSRTBenchCounter counter;
+  gchar *packet_filter;
+  gsize start_bytes;
+  gdouble elapsed, overhead = 0;
+  gint64 sent, retransmitted, filter_extra;
+  GstClockTime start_time;
+  GstStructure *row;
+  gboolean ret = FALSE;
+
+  if (mode->arq != NULL)
+    packet_filter = g_strconcat (filter ? filter : SRT_BENCH_DEFAULT_FEC_FILTER,
+      mode->arq, NULL);
+  else
+    packet_filter = g_strdup ("");
+
+  pipelines[0] = gst_srt_bench_launch ("srtserversrc name=srt "
+    "uri=srt://:%d latency=%d ! fakesink name=sink sync=false async=false",
+    port, latency);
+  if (pipelines[0] == NULL)
+    goto out;
+  gst_srt_bench_counter_attach (&counter, pipelines[0], "sink");
+  if (!gst_srt_bench_play (pipelines[0]))
+    goto out;
+
+  relay = gst_srt_bench_relay_new (relay_port, port, &impairment);
+  if (relay == NULL)
+    goto out;
+
+  /* Only the caller sets the filter, the listener takes it from the
+   * handshake */
+  pipelines[1] = gst_srt_bench_launch ("fakesrc sizetype=fixed sizemax=%d "
+    "filltype=zero format=time datarate=%d ! srtclientsink name=srt "
+    "uri=srt://127.0.0.1:%d latency=%d packet-filter=\"%s\"", size,
+    bitrate * 1000000 / 8, relay_port, latency, packet_filter);
+  if (pipelines[1] == NULL || !gst_srt_bench_play (pipelines[1]))
+    goto out;
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->warmup * GST_SECOND))
+    goto out;
+
+  start_bytes = g_atomic_pointer_get (&counter.bytes);
+  start_time = gst_util_get_timestamp ();
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->duration * GST_SECOND))
+    goto out;
+
+  elapsed = (gdouble)(gst_util_get_timestamp () - start_time) / GST_SECOND;
+
+  sent = gst_srt_bench_get_stat (pipelines[1], "srt", "packets-sent");
+  retransmitted =
+    gst_srt_bench_get_stat (pipelines[1], "srt", "packets-retransmitted");
+  filter_extra =
+    gst_srt_bench_get_stat (pipelines[1], "srt", "packets-filter-extra");
+  if (sent - retransmitted > 0)
+    overhead = 100.0 * (retransmitted + filter_extra) / (sent - retransmitted);
+
+  row = gst_structure_new ("fec",
+    "mode", G_TYPE_STRING, mode->name,
+    "filter", G_TYPE_STRING, packet_filter,
+    "latency-ms", G_TYPE_INT, latency,
+    "bitrate-mbps", G_TYPE_INT, bitrate,
+    "loss-percent", G_TYPE_DOUBLE, impairment.loss,
+    "delay-ms", G_TYPE_INT, impairment.delay,
+    "achieved-mbps", G_TYPE_DOUBLE,
+    (g_atomic_pointer_get (&counter.bytes) - start_bytes) * 8 / elapsed / 1e6,
+    "packets-lost", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-recv-lost"),
+    "packets-dropped", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-recv-dropped"),
+    "packets-retransmitted", G_TYPE_INT64, retransmitted,
+    "packets-filter-extra", G_TYPE_INT64, filter_extra,
+    "packets-filter-supply", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-filter-supply"),
+    "packets-filter-loss", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-filter-loss"),
+    "overhead-percent", G_TYPE_DOUBLE, overhead,
+    "recv-latency-p50-us", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "recv-latency-p50-us"),
+    "recv-latency-p99-us", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "recv-latency-p99-us"),
+    NULL);
+  gst_srt_bench_relay_add_stats (relay, row);
+  gst_srt_bench_output_add (out, row);
+  ret = TRUE;
+
+out:
+  gst_srt_bench_stop (pipelines[0]);
+  gst_srt_bench_stop (pipelines[1]);
+  gst_srt_bench_relay_free (relay);
+  g_free (packet_filter);
+
+  return ret;
+}
+
+static gboolean
+fec_run (const GstSRTBenchOptions * options, GstSRTBenchOutput * out)
+{
+  guint n_latencies, n_losses, i, j, k;
+  gint *latencies = gst_srt_bench_parse_list (latencies_list ?
+    latencies_list : SRT_BENCH_DEFAULT_FEC_LATENCIES, &n_latencies);
+  gdouble *losses = fec_parse_losses (losses_list ?
+    losses_list : SRT_BENCH_DEFAULT_FEC_LOSSES, &n_losses);
+  gboolean ret = TRUE;
+
+  for (i = 0; i < n_losses; i++) {
+    impairment.loss = losses[i];
+    for (j = 0; j < n_latencies; j++) {
+      for (k = 0; k < G_N_ELEMENTS (modes); k++) {
+        if (!fec_run_one (options, &modes[k], latencies[j], out))
+          ret = FALSE;
+      }
+    }
+  }
+
+  g_free (latencies);
+  g_free (losses);
+
+  return ret;
+}
+
+const GstSRTBenchCommand gst_srt_bench_fec = {
+  "fec",
+  "FEC against ARQ through an impairment relay, for a range of loss rates",
+  fec_add_options,
+  fec_run
+};
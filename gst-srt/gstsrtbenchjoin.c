@@ -0,0 +1,356 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Viewer join latency of srtserversink: the time from srt_connect() to the
+ * first decodable frame, split into
+ *
+ *   handshake: srt_connect() until it returns
+ *   header:    connected until the streamheader arrives
+ *   keyframe:  streamheader until the first keyframe arrives
+ *
+ * The stream is synthetic: fakesrc frames of one packet each, with the
+ * frame type in the first byte ('K' keyframe, 'D' delta), a keyframe every
+ * --gop frames and a streamheader ('H') in the caps. Every run starts a
+ * fresh server and lets a storm of viewers connect at the same time, the
+ * viewers being plain libsrt sockets so the handshake can be timed. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#include <gio/gio.h>
+#include <gio/gnetworking.h>
+#include <srt.h>
+#include <string.h>
+
+#define SRT_BENCH_DEFAULT_GOPS "15,30,60,120"
+#define SRT_BENCH_DEFAULT_STORMS "1,100,250"
+#define SRT_BENCH_DEFAULT_FPS 30
+#define SRT_BENCH_FRAME_SIZE 1316
+#define SRT_BENCH_JOIN_TIMEOUT 10000
+
+static gchar *gops_list;
+static gchar *storms_list;
+static gint fps = SRT_BENCH_DEFAULT_FPS;
+
+static GOptionEntry entries[] = {
+  {"gops", 'g', 0, G_OPTION_ARG_STRING, &gops_list,
+    "GOP lengths in frames (default: " SRT_BENCH_DEFAULT_GOPS ")", "LIST"},
+  {"storms", 's', 0, G_OPTION_ARG_STRING, &storms_list,
+    "Viewers joining at once (default: " SRT_BENCH_DEFAULT_STORMS ")",
+    "LIST"},
+  {"fps", 0, 0, G_OPTION_ARG_INT, &fps, "Frames per second", "FPS"},
+  {NULL}
+};
+
+typedef struct
+{
+  gint gop;
+  guint64 frame;
+} JoinStream;
+
+typedef struct
+{
+  /* shared by all the viewers of a storm */
+  GMutex *lock;
+  GCond *cond;
+  gboolean *go;
+  gint port;
+  gint latency;
+
+  gboolean ok;
+  gboolean got_header;
+  gint64 handshake;
+  gint64 header;
+  gint64 keyframe;
+  gint64 total;
+} JoinViewer;
+
+static void
+join_add_options (GOptionContext * ctx)
+{
+  g_option_context_add_main_entries (ctx, entries, NULL);
+}
+
+static void
+handoff_cb (GstElement * src, GstBuffer * buf, GstPad * pad,
+  JoinStream * stream)
+{
+  gboolean keyframe = stream->frame % stream->gop == 0;
+  GstMapInfo info;
+
+  if (gst_buffer_map (buf, &info, GST_MAP_WRITE)) {
+    info.data[0] = keyframe ? 'K' : 'D';
+    memcpy (info.data + 1, &stream->frame, sizeof (stream->frame));
+    gst_buffer_unmap (buf, &info);
+  }
+
+  if (keyframe)
+    GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+  else
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  stream->frame++;
+}
+
+static GstCaps *
+join_caps (void)
+{
+  GstBuffer *header = gst_buffer_new_allocate (NULL, 188, NULL);
+  GValue array = G_VALUE_INIT, value = G_VALUE_INIT;
+  GstCaps *caps = gst_caps_new_empty_simple ("application/x-srt-bench");
+
+  gst_buffer_memset (header, 0, 0, 188);
+  gst_buffer_memset (header, 0, 'H', 1);
+  GST_BUFFER_FLAG_SET (header, GST_BUFFER_FLAG_HEADER);
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  g_value_init (&value, GST_TYPE_BUFFER);
+  g_value_take_boxed (&value, header);
+  gst_value_array_append_and_take_value (&array, &value);
+  gst_caps_set_value (caps, "streamheader", &array);
+  g_value_unset (&array);
+
+  return caps;
+}
+
+static gpointer
+join_viewer_func (gpointer data)
+{
+  JoinViewer *viewer = data;
+  GInetAddress *inet = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *addr = g_inet_socket_address_new (inet, viewer->port);
+  struct sockaddr_storage sa;
+  gint on = 1, off = 0, timeout = SRT_BENCH_JOIN_TIMEOUT;
+  gchar buf[SRT_BENCH_FRAME_SIZE];
+  gint64 start, connected, header = 0;
+  gint sa_len = g_socket_address_get_native_size (addr);
+  SRTSOCKET sock;
+
+  g_socket_address_to_native (addr, &sa, sizeof (sa), NULL);
+  g_object_unref (addr);
+  g_object_unref (inet);
+
+  sock = srt_socket (AF_INET, SOCK_DGRAM, 0);
+  srt_setsockopt (sock, 0, SRTO_TSBPDMODE, &on, sizeof (int));
+  srt_setsockopt (sock, 0, SRTO_RCVSYN, &on, sizeof (int));
+  srt_setsockopt (sock, 0, SRTO_LINGER, &off, sizeof (int));
+  srt_setsockopt (sock, 0, SRTO_RCVLATENCY, &viewer->latency, sizeof (int));
+  srt_setsockopt (sock, 0, SRTO_RCVTIMEO, &timeout, sizeof (int));
+
+  g_mutex_lock (viewer->lock);
+  while (!*viewer->go)
+    g_cond_wait (viewer->cond, viewer->lock);
+  g_mutex_unlock (viewer->lock);
+
+  start = g_get_monotonic_time ();
+  if (srt_connect (sock, (struct sockaddr *)&sa, sa_len) == SRT_ERROR)
+    goto out;
+  connected = g_get_monotonic_time ();
+
+  while (TRUE) {
+    gint len = srt_recvmsg (sock, buf, sizeof (buf));
+
+    if (len <= 0)
+      goto out;
+
+    if (buf[0] == 'H' && !viewer->got_header) {
+      viewer->got_header = TRUE;
+      header = g_get_monotonic_time ();
+    }
+    else if (buf[0] == 'K') {
+      gint64 now = g_get_monotonic_time ();
+
+      if (!viewer->got_header)
+        header = connected;
+      viewer->handshake = connected - start;
+      viewer->header = header - connected;
+      viewer->keyframe = now - header;
+      viewer->total = now - start;
+      viewer->ok = TRUE;
+      break;
+    }
+  }
+
+out:
+  srt_close (sock);
+  return NULL;
+}
+
+static void
+add_percentiles (GstStructure * s, const gchar * prefix,
+  const GstSRTHistogram * hist)
+{
+  gchar *p50 = g_strconcat (prefix, "-p50-us", NULL);
+  gchar *p99 = g_strconcat (prefix, "-p99-us", NULL);
+  gchar *max = g_strconcat (prefix, "-max-us", NULL);
+
+  gst_structure_set (s,
+    p50, G_TYPE_UINT64, gst_srt_histogram_percentile (hist, 50.0),
+    p99, G_TYPE_UINT64, gst_srt_histogram_percentile (hist, 99.0),
+    max, G_TYPE_UINT64, hist->max, NULL);
+
+  g_free (max);
+  g_free (p99);
+  g_free (p50);
+}
+
+static gboolean
+join_run_one (const GstSRTBenchOptions * options, gint gop, guint storm,
+  GstSRTBenchOutput * out)
+{
+  gint port = gst_srt_bench_next_port (options);
+  JoinViewer *viewers = g_new0 (JoinViewer, storm);
+  GThread **threads = g_new0 (GThread *, storm);
+  JoinStream stream = { gop, 0 };
+  GstSRTHistogram *handshake = g_new0 (GstSRTHistogram, 1);
+  GstSRTHistogram *header = g_new0 (GstSRTHistogram, 1);
+  GstSRTHistogram *keyframe = g_new0 (GstSRTHistogram, 1);
+  GstSRTHistogram *total = g_new0 (GstSRTHistogram, 1);
+  GstElement *sender, *src = NULL, *filter = NULL;
+  GMutex lock;
+  GCond cond;
+  gboolean go = FALSE, ret = FALSE;
+  guint i, joined = 0, missing_header = 0;
+  GstCaps *caps;
+  GstStructure *row;
+
+  g_mutex_init (&lock);
+  g_cond_init (&cond);
+
+  sender = gst_srt_bench_launch ("fakesrc name=src sizetype=fixed "
+    "sizemax=%d filltype=zero format=time datarate=%d signal-handoffs=true "
+    "! capsfilter name=caps ! srtserversink uri=srt://:%d latency=%d",
+    SRT_BENCH_FRAME_SIZE, SRT_BENCH_FRAME_SIZE * fps, port,
+    options->latency);
+  if (sender == NULL)
+    goto out;
+
+  src = gst_bin_get_by_name (GST_BIN (sender), "src");
+  g_signal_connect (src, "handoff", G_CALLBACK (handoff_cb), &stream);
+  filter = gst_bin_get_by_name (GST_BIN (sender), "caps");
+  caps = join_caps ();
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  if (!gst_srt_bench_play (sender))
+    goto out;
+  if (!gst_srt_bench_wait (&sender, 1, options->warmup * GST_SECOND))
+    goto out;
+
+  for (i = 0; i < storm; i++) {
+    viewers[i].lock = &lock;
+    viewers[i].cond = &cond;
+    viewers[i].go = &go;
+    viewers[i].port = port;
+    viewers[i].latency = options->latency;
+    threads[i] = g_thread_new ("srtbenchviewer", join_viewer_func,
+      &viewers[i]);
+  }
+
+  /* Release the whole storm at once */
+  g_mutex_lock (&lock);
+  go = TRUE;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+
+  for (i = 0; i < storm; i++) {
+    g_thread_join (threads[i]);
+    if (!viewers[i].ok)
+      continue;
+
+    joined++;
+    if (!viewers[i].got_header)
+      missing_header++;
+    gst_srt_histogram_record (handshake, viewers[i].handshake);
+    gst_srt_histogram_record (header, viewers[i].header);
+    gst_srt_histogram_record (keyframe, viewers[i].keyframe);
+    gst_srt_histogram_record (total, viewers[i].total);
+  }
+
+  row = gst_structure_new ("join",
+    "gop", G_TYPE_INT, gop,
+    "fps", G_TYPE_INT, fps,
+    "latency-ms", G_TYPE_INT, options->latency,
+    "viewers", G_TYPE_UINT, storm,
+    "joined", G_TYPE_UINT, joined,
+    "missing-header", G_TYPE_UINT, missing_header, NULL);
+  add_percentiles (row, "handshake", handshake);
+  add_percentiles (row, "header", header);
+  add_percentiles (row, "keyframe", keyframe);
+  add_percentiles (row, "total", total);
+  gst_srt_bench_output_add (out, row);
+  ret = TRUE;
+
+out:
+  g_clear_object (&filter);
+  g_clear_object (&src);
+  gst_srt_bench_stop (sender);
+
+  g_free (total);
+  g_free (keyframe);
+  g_free (header);
+  g_free (handshake);
+  g_free (threads);
+  g_free (viewers);
+  g_cond_clear (&cond);
+  g_mutex_clear (&lock);
+
+  return ret;
+}
+
+static gboolean
+join_run (const GstSRTBenchOptions * options, GstSRTBenchOutput * out)
+{
+  guint n_gops, n_storms, i, j;
+  gint *gops, *storms;
+  gboolean ret = TRUE;
+
+  if (fps <= 0) {
+    g_printerr ("Invalid frame rate %d\n", fps);
+    return FALSE;
+  }
+
+  gops = gst_srt_bench_parse_list (gops_list ? gops_list :
+    SRT_BENCH_DEFAULT_GOPS, &n_gops);
+  storms = gst_srt_bench_parse_list (storms_list ? storms_list :
+    SRT_BENCH_DEFAULT_STORMS, &n_storms);
+
+  srt_startup ();
+  for (i = 0; i < n_gops; i++) {
+    for (j = 0; j < n_storms; j++) {
+      if (!join_run_one (options, gops[i], storms[j], out))
+        ret = FALSE;
+    }
+  }
+  srt_cleanup ();
+
+  g_free (storms);
+  g_free (gops);
+
+  return ret;
+}
+
+const GstSRTBenchCommand gst_srt_bench_join = {
+  "join",
+  "srtserversink viewer join time, for GOP lengths and join storms",
+  join_add_options,
+  join_run
+};
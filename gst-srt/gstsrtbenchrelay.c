@@ -0,0 +1,535 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* A UDP relay that sits between two SRT elements on loopback and impairs
+ * the traffic going through it: random and burst loss, delay and jitter,
+ * reordering and a bandwidth bottleneck with a finite queue. All the
+ * randomness comes from a seeded GRand, so runs are reproducible.
+ *
+ * The caller connects to the relay port, the relay forwards to the target
+ * port and sends the replies back to the last address it heard from.
+ *
+ * The "relay" benchmark uses it to show how the latency setting trades
+ * off against retransmissions and unrecovered losses. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#include <gio/gio.h>
+#include <gio/gnetworking.h>
+#include <string.h>
+
+#define SRT_BENCH_RELAY_MTU 1500
+#define SRT_BENCH_RELAY_POLL_TIMEOUT 50
+#define SRT_BENCH_RELAY_SOCKET_BUFFER (4 * 1024 * 1024)
+
+#define SRT_BENCH_DEFAULT_LATENCIES "20,40,80,125,250,500"
+#define SRT_BENCH_DEFAULT_RELAY_BITRATE 10
+#define SRT_BENCH_DEFAULT_RELAY_SIZE 1316
+
+typedef struct
+{
+  GstClockTime time;
+  gboolean upstream;
+  gsize size;
+  gchar data[SRT_BENCH_RELAY_MTU];
+} RelayPacket;
+
+/* State of one direction */
+typedef struct
+{
+  gboolean burst;
+  GstClockTime last_in_order;
+  GstClockTime link_free;
+} RelayPath;
+
+struct _GstSRTBenchRelay
+{
+  GstSRTBenchImpairment impairment;
+  GSocket *listener;
+  GSocket *upstream;
+  GSocketAddress *target;
+  GSocketAddress *client;
+
+  GThread *thread;
+  volatile gint running;
+  GRand *rand;
+  RelayPath paths[2];
+  /* RelayPacket sorted by departure time */
+  GQueue queue;
+
+  volatile gint forwarded;
+  volatile gint lost;
+  volatile gint burst_lost;
+  volatile gint queue_dropped;
+  volatile gint reordered;
+};
+
+static GstClockTime
+relay_now (void)
+{
+  return g_get_monotonic_time () * GST_USECOND;
+}
+
+static gboolean
+relay_chance (GstSRTBenchRelay * relay, gdouble percent)
+{
+  return percent > 0 && g_rand_double (relay->rand) * 100 < percent;
+}
+
+/* Decides if and when a packet leaves the relay */
+static gboolean
+relay_impair (GstSRTBenchRelay * relay, gboolean upstream, gsize size,
+  GstClockTime now, GstClockTime * time)
+{
+  const GstSRTBenchImpairment *imp = &relay->impairment;
+  RelayPath *path = &relay->paths[upstream ? 1 : 0];
+  GstClockTime t = now;
+
+  if (!upstream && !imp->both_ways) {
+    *time = now;
+    return TRUE;
+  }
+
+  if (path->burst) {
+    if (imp->burst_length <= 1 ||
+      g_rand_double (relay->rand) * imp->burst_length < 1)
+      path->burst = FALSE;
+  }
+  else if (relay_chance (relay, imp->burst_enter)) {
+    path->burst = TRUE;
+  }
+
+  if (path->burst) {
+    g_atomic_int_inc (&relay->burst_lost);
+    return FALSE;
+  }
+
+  if (relay_chance (relay, imp->loss)) {
+    g_atomic_int_inc (&relay->lost);
+    return FALSE;
+  }
+
+  t += imp->delay * GST_MSECOND;
+  if (imp->jitter > 0)
+    t += g_rand_int_range (relay->rand, 0, imp->jitter * 1000) * GST_USECOND;
+
+  /* Jitter alone doesn't reorder, like on a real link */
+  if (relay_chance (relay, imp->reorder)) {
+    t += imp->reorder_delay * GST_MSECOND;
+    g_atomic_int_inc (&relay->reordered);
+  }
+  else {
+    t = MAX (t, path->last_in_order);
+    path->last_in_order = t;
+  }
+
+  if (imp->bandwidth > 0) {
+    GstClockTime start = MAX (t, path->link_free);
+
+    if (start - t > imp->queue * GST_MSECOND) {
+      g_atomic_int_inc (&relay->queue_dropped);
+      return FALSE;
+    }
+    path->link_free = start + gst_util_uint64_scale (size * 8, GST_SECOND,
+      imp->bandwidth * 1000);
+    t = path->link_free;
+  }
+
+  *time = t;
+  return TRUE;
+}
+
+static void
+relay_enqueue (GstSRTBenchRelay * relay, RelayPacket * packet)
+{
+  GList *item = relay->queue.tail;
+
+  while (item != NULL && ((RelayPacket *)item->data)->time > packet->time)
+    item = item->prev;
+
+  if (item == NULL)
+    g_queue_push_head (&relay->queue, packet);
+  else
+    g_queue_insert_after (&relay->queue, item, packet);
+}
+
+static void
+relay_receive (GstSRTBenchRelay * relay, GSocket * socket, gboolean upstream)
+{
+  while (TRUE) {
+    RelayPacket *packet = g_new (RelayPacket, 1);
+    GSocketAddress *from = NULL;
+    gssize len;
+
+    len = g_socket_receive_from (socket, &from, packet->data,
+      sizeof (packet->data), NULL, NULL);
+    if (len < 0) {
+      g_free (packet);
+      return;
+    }
+
+    if (upstream) {
+      /* Replies go to whoever sent to the relay last */
+      g_clear_object (&relay->client);
+      relay->client = from;
+    }
+    else {
+      g_clear_object (&from);
+    }
+
+    packet->upstream = upstream;
+    packet->size = len;
+    if (relay_impair (relay, upstream, len, relay_now (), &packet->time))
+      relay_enqueue (relay, packet);
+    else
+      g_free (packet);
+  }
+}
+
+static gpointer
+relay_thread_func (gpointer data)
+{
+  GstSRTBenchRelay *relay = data;
+  GPollFD fds[2];
+
+  fds[0].fd = g_socket_get_fd (relay->listener);
+  fds[0].events = G_IO_IN;
+  fds[1].fd = g_socket_get_fd (relay->upstream);
+  fds[1].events = G_IO_IN;
+
+  while (g_atomic_int_get (&relay->running)) {
+    GstClockTime now = relay_now ();
+    gint timeout = SRT_BENCH_RELAY_POLL_TIMEOUT;
+    RelayPacket *packet;
+
+    while ((packet = g_queue_peek_head (&relay->queue)) != NULL &&
+      packet->time <= now) {
+      g_queue_pop_head (&relay->queue);
+
+      if (packet->upstream)
+        g_socket_send_to (relay->upstream, relay->target, packet->data,
+          packet->size, NULL, NULL);
+      else if (relay->client != NULL)
+        g_socket_send_to (relay->listener, relay->client, packet->data,
+          packet->size, NULL, NULL);
+      g_atomic_int_inc (&relay->forwarded);
+      g_free (packet);
+    }
+
+    if (packet != NULL)
+      timeout = MIN (timeout,
+        (gint)((packet->time - now + GST_MSECOND - 1) / GST_MSECOND));
+
+    fds[0].revents = fds[1].revents = 0;
+    if (g_poll (fds, 2, timeout) <= 0)
+      continue;
+
+    if (fds[0].revents & G_IO_IN)
+      relay_receive (relay, relay->listener, TRUE);
+    if (fds[1].revents & G_IO_IN)
+      relay_receive (relay, relay->upstream, FALSE);
+  }
+
+  return NULL;
+}
+
+static GSocket *
+relay_socket (gint port, GError ** error)
+{
+  GInetAddress *inet = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *addr = g_inet_socket_address_new (inet, port);
+  GSocket *socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+    G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, error);
+
+  if (socket != NULL && !g_socket_bind (socket, addr, TRUE, error))
+    g_clear_object (&socket);
+
+  if (socket != NULL) {
+    g_socket_set_blocking (socket, FALSE);
+    /* Bursts at high bitrates would otherwise overflow the defaults */
+    g_socket_set_option (socket, SOL_SOCKET, SO_RCVBUF,
+      SRT_BENCH_RELAY_SOCKET_BUFFER, NULL);
+    g_socket_set_option (socket, SOL_SOCKET, SO_SNDBUF,
+      SRT_BENCH_RELAY_SOCKET_BUFFER, NULL);
+  }
+
+  g_object_unref (addr);
+  g_object_unref (inet);
+
+  return socket;
+}
+
+/**
+ * gst_srt_bench_relay_new:
+ * @port: the port to listen on
+ * @target_port: the port to forward to
+ * @impairment: what to do to the packets
+ *
+ * Returns: (transfer full): a running relay, or %NULL on error
+ */
+GstSRTBenchRelay *
+gst_srt_bench_relay_new (gint port, gint target_port,
+  const GstSRTBenchImpairment * impairment)
+{
+  GstSRTBenchRelay *relay = g_new0 (GstSRTBenchRelay, 1);
+  GInetAddress *inet = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GError *error = NULL;
+
+  relay->impairment = *impairment;
+  relay->rand = g_rand_new_with_seed (impairment->seed);
+  relay->target = g_inet_socket_address_new (inet, target_port);
+  g_object_unref (inet);
+  g_queue_init (&relay->queue);
+
+  relay->listener = relay_socket (port, &error);
+  if (relay->listener == NULL)
+    goto failed;
+  relay->upstream = relay_socket (0, &error);
+  if (relay->upstream == NULL)
+    goto failed;
+
+  relay->running = TRUE;
+  relay->thread = g_thread_new ("srtbenchrelay", relay_thread_func, relay);
+
+  return relay;
+
+failed:
+  g_printerr ("Could not create relay on port %d: %s\n", port,
+    error->message);
+  g_clear_error (&error);
+  gst_srt_bench_relay_free (relay);
+  return NULL;
+}
+
+/* Adds the relay counters to a result row */
+void
+gst_srt_bench_relay_add_stats (GstSRTBenchRelay * relay, GstStructure * row)
+{
+  gst_structure_set (row,
+    "relay-forwarded", G_TYPE_INT, g_atomic_int_get (&relay->forwarded),
+    "relay-lost", G_TYPE_INT, g_atomic_int_get (&relay->lost),
+    "relay-burst-lost", G_TYPE_INT, g_atomic_int_get (&relay->burst_lost),
+    "relay-queue-dropped", G_TYPE_INT,
+    g_atomic_int_get (&relay->queue_dropped),
+    "relay-reordered", G_TYPE_INT, g_atomic_int_get (&relay->reordered),
+    NULL);
+}
+
+void
+gst_srt_bench_relay_free (GstSRTBenchRelay * relay)
+{
+  if (relay == NULL)
+    return;
+
+  if (relay->thread != NULL) {
+    g_atomic_int_set (&relay->running, FALSE);
+    g_thread_join (relay->thread);
+  }
+
+  g_queue_foreach (&relay->queue, (GFunc)g_free, NULL);
+  g_queue_clear (&relay->queue);
+  g_clear_object (&relay->listener);
+  g_clear_object (&relay->upstream);
+  g_clear_object (&relay->target);
+  g_clear_object (&relay->client);
+  g_rand_free (relay->rand);
+  g_free (relay);
+}
+
+/**
+ * gst_srt_bench_impairment_add_options:
+ * @ctx: the option context of a benchmark
+ * @impairment: (out caller-allocates): where to store the options, must
+ *   outlive the parsing
+ *
+ * Adds the --loss, --burst-*, --delay, --jitter, --reorder*, --bandwidth,
+ * --queue, --both-ways and --seed options.
+ */
+void
+gst_srt_bench_impairment_add_options (GOptionContext * ctx,
+  GstSRTBenchImpairment * impairment)
+{
+  GOptionEntry entries[] = {
+    {"loss", 0, 0, G_OPTION_ARG_DOUBLE, &impairment->loss,
+      "Percentage of packets lost at random", "PERCENT"},
+    {"burst-enter", 0, 0, G_OPTION_ARG_DOUBLE, &impairment->burst_enter,
+      "Percentage of packets starting a loss burst", "PERCENT"},
+    {"burst-length", 0, 0, G_OPTION_ARG_DOUBLE, &impairment->burst_length,
+      "Mean length of a loss burst", "PACKETS"},
+    {"delay", 0, 0, G_OPTION_ARG_INT, &impairment->delay,
+      "One way delay", "MS"},
+    {"jitter", 0, 0, G_OPTION_ARG_INT, &impairment->jitter,
+      "Uniform jitter on top of the delay", "MS"},
+    {"reorder", 0, 0, G_OPTION_ARG_DOUBLE, &impairment->reorder,
+      "Percentage of packets reordered", "PERCENT"},
+    {"reorder-delay", 0, 0, G_OPTION_ARG_INT, &impairment->reorder_delay,
+      "How late reordered packets arrive", "MS"},
+    {"bandwidth", 0, 0, G_OPTION_ARG_INT, &impairment->bandwidth,
+      "Bottleneck bandwidth, 0 for unlimited", "KBPS"},
+    {"queue", 0, 0, G_OPTION_ARG_INT, &impairment->queue,
+      "Bottleneck queue before dropping", "MS"},
+    {"both-ways", 0, 0, G_OPTION_ARG_NONE, &impairment->both_ways,
+      "Also impair the ACKs and NAKs", NULL},
+    {"seed", 0, 0, G_OPTION_ARG_INT, &impairment->seed,
+      "Seed of the random generator", "SEED"},
+    {NULL}
+  };
+  GOptionGroup *group = g_option_group_new ("impairment",
+    "Network impairment options", "Show the network impairment options",
+    NULL, NULL);
+
+  g_option_group_add_entries (group, entries);
+  g_option_context_add_group (ctx, group);
+}
+
+/* The "relay" benchmark */
+
+static GstSRTBenchImpairment impairment = {
+  1.0, 0.0, 1.0, 0, 0, 0.0, 10, 0, 100, FALSE, 1
+};
+static gchar *latencies_list;
+static gint bitrate = SRT_BENCH_DEFAULT_RELAY_BITRATE;
+static gint size = SRT_BENCH_DEFAULT_RELAY_SIZE;
+
+static GOptionEntry entries[] = {
+  {"latencies", 'L', 0, G_OPTION_ARG_STRING, &latencies_list,
+    "SRT latencies in ms (default: " SRT_BENCH_DEFAULT_LATENCIES ")",
+    "LIST"},
+  {"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+    "Bitrate of the stream in Mb/s", "MBPS"},
+  {"size", 's', 0, G_OPTION_ARG_INT, &size,
+    "Payload size in bytes", "BYTES"},
+  {NULL}
+};
+
+static void
+relay_add_options (GOptionContext * ctx)
+{
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  gst_srt_bench_impairment_add_options (ctx, &impairment);
+}
+
+static gboolean
+relay_run_one (const GstSRTBenchOptions * options, gint latency,
+  GstSRTBenchOutput * out)
+{
+  gint port = gst_srt_bench_next_port (options);
+  gint relay_port = gst_srt_bench_next_port (options);
+  GstElement *pipelines[2] = { NULL, NULL };
+  GstSRTBenchRelay *relay = NULL;
+  GstSRTBenchCounter counter;
+  gsize start_bytes;
+  gdouble elapsed;
+  GstClockTime start_time;
+  GstStructure *row;
+  gboolean ret = FALSE;
+
+  pipelines[0] = gst_srt_bench_launch ("srtserversrc name=srt "
+    "uri=srt://:%d latency=%d ! fakesink name=sink sync=false async=false",
+    port, latency);
+  if (pipelines[0] == NULL)
+    goto out;
+  gst_srt_bench_counter_attach (&counter, pipelines[0], "sink");
+  if (!gst_srt_bench_play (pipelines[0]))
+    goto out;
+
+  relay = gst_srt_bench_relay_new (relay_port, port, &impairment);
+  if (relay == NULL)
+    goto out;
+
+  pipelines[1] = gst_srt_bench_launch ("fakesrc sizetype=fixed sizemax=%d "
+    "filltype=zero format=time datarate=%d ! srtclientsink name=srt "
+    "uri=srt://127.0.0.1:%d latency=%d", size, bitrate * 1000000 / 8,
+    relay_port, latency);
+  if (pipelines[1] == NULL || !gst_srt_bench_play (pipelines[1]))
+    goto out;
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->warmup * GST_SECOND))
+    goto out;
+
+  start_bytes = g_atomic_pointer_get (&counter.bytes);
+  start_time = gst_util_get_timestamp ();
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->duration * GST_SECOND))
+    goto out;
+
+  elapsed = (gdouble)(gst_util_get_timestamp () - start_time) / GST_SECOND;
+
+  row = gst_structure_new ("relay",
+    "latency-ms", G_TYPE_INT, latency,
+    "bitrate-mbps", G_TYPE_INT, bitrate,
+    "loss-percent", G_TYPE_DOUBLE, impairment.loss,
+    "burst-enter-percent", G_TYPE_DOUBLE, impairment.burst_enter,
+    "burst-length", G_TYPE_DOUBLE, impairment.burst_length,
+    "delay-ms", G_TYPE_INT, impairment.delay,
+    "jitter-ms", G_TYPE_INT, impairment.jitter,
+    "reorder-percent", G_TYPE_DOUBLE, impairment.reorder,
+    "bandwidth-kbps", G_TYPE_INT, impairment.bandwidth,
+    "achieved-mbps", G_TYPE_DOUBLE,
+    (g_atomic_pointer_get (&counter.bytes) - start_bytes) * 8 / elapsed / 1e6,
+    "packets-lost", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-recv-lost"),
+    "packets-dropped", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "packets-recv-dropped"),
+    "packets-retransmitted", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[1], "srt", "packets-retransmitted"),
+    "recv-latency-p50-us", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "recv-latency-p50-us"),
+    "recv-latency-p99-us", G_TYPE_INT64,
+    gst_srt_bench_get_stat (pipelines[0], "srt", "recv-latency-p99-us"),
+    NULL);
+  gst_srt_bench_relay_add_stats (relay, row);
+  gst_srt_bench_output_add (out, row);
+  ret = TRUE;
+
+out:
+  gst_srt_bench_stop (pipelines[0]);
+  gst_srt_bench_stop (pipelines[1]);
+  gst_srt_bench_relay_free (relay);
+
+  return ret;
+}
+
+static gboolean
+relay_run (const GstSRTBenchOptions * options, GstSRTBenchOutput * out)
+{
+  guint n_latencies, i;
+  gint *latencies = gst_srt_bench_parse_list (latencies_list ?
+    latencies_list : SRT_BENCH_DEFAULT_LATENCIES, &n_latencies);
+  gboolean ret = TRUE;
+
+  for (i = 0; i < n_latencies; i++) {
+    if (!relay_run_one (options, latencies[i], out))
+      ret = FALSE;
+  }
+
+  g_free (latencies);
+
+  return ret;
+}
+
+const GstSRTBenchCommand gst_srt_bench_relay = {
+  "relay",
+  "Loss recovery through an impairment relay, for a range of latencies",
+  relay_add_options,
+  relay_run
+};
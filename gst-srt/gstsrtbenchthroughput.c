@@ -0,0 +1,182 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Loopback throughput of srtclientsink -> srtserversrc and
+ * srtserversink -> srtclientsrc, at a range of payload sizes and bitrates.
+ *
+ * fakesrc timestamps its buffers at the requested bitrate and the SRT sink
+ * syncs on them, so the achieved rate shows whether the elements keep up.
+ * Both ends run in this process, so the CPU time covers the sender and the
+ * receiver. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtbench.h"
+
+#define SRT_BENCH_DEFAULT_SIZES "188,752,1316"
+#define SRT_BENCH_DEFAULT_BITRATES "10,50,100,200"
+
+static gchar *sizes_list;
+static gchar *bitrates_list;
+
+static GOptionEntry entries[] = {
+  {"sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_list,
+    "Payload sizes in bytes (default: " SRT_BENCH_DEFAULT_SIZES ")", "LIST"},
+  {"bitrates", 'b', 0, G_OPTION_ARG_STRING, &bitrates_list,
+    "Bitrates in Mb/s (default: " SRT_BENCH_DEFAULT_BITRATES ")", "LIST"},
+  {NULL}
+};
+
+static void
+throughput_add_options (GOptionContext * ctx)
+{
+  g_option_context_add_main_entries (ctx, entries, NULL);
+}
+
+static gboolean
+throughput_run_one (const GstSRTBenchOptions * options, gboolean server_sink,
+  gint size, gint mbps, GstSRTBenchOutput * out)
+{
+  gint port = gst_srt_bench_next_port (options);
+  gint64 rate = (gint64)mbps * 1000000 / 8;
+  GstElement *pipelines[2] = { NULL, NULL };
+  GstElement *sender = NULL, *receiver = NULL;
+  GstSRTBenchCounter counter;
+  gsize start_bytes, start_buffers, bytes, buffers;
+  gdouble start_cpu, cpu, elapsed, achieved;
+  GstClockTime start_time;
+  gboolean ret = FALSE;
+
+  if (rate > G_MAXINT) {
+    g_printerr ("Bitrate %d Mb/s is too high\n", mbps);
+    return FALSE;
+  }
+
+  /* The listener always starts first */
+  if (server_sink) {
+    sender = gst_srt_bench_launch ("fakesrc sizetype=fixed sizemax=%d "
+      "filltype=zero format=time datarate=%d ! srtserversink name=srt "
+      "uri=srt://:%d latency=%d", size, (gint)rate, port, options->latency);
+    if (sender == NULL || !gst_srt_bench_play (sender))
+      goto out;
+    receiver = gst_srt_bench_launch ("srtclientsrc name=srt "
+      "uri=srt://127.0.0.1:%d latency=%d ! fakesink name=sink sync=false "
+      "async=false", port, options->latency);
+    if (receiver == NULL)
+      goto out;
+    gst_srt_bench_counter_attach (&counter, receiver, "sink");
+    if (!gst_srt_bench_play (receiver))
+      goto out;
+  }
+  else {
+    receiver = gst_srt_bench_launch ("srtserversrc name=srt "
+      "uri=srt://:%d latency=%d ! fakesink name=sink sync=false async=false",
+      port, options->latency);
+    if (receiver == NULL)
+      goto out;
+    gst_srt_bench_counter_attach (&counter, receiver, "sink");
+    if (!gst_srt_bench_play (receiver))
+      goto out;
+    sender = gst_srt_bench_launch ("fakesrc sizetype=fixed sizemax=%d "
+      "filltype=zero format=time datarate=%d ! srtclientsink name=srt "
+      "uri=srt://127.0.0.1:%d latency=%d", size, (gint)rate, port,
+      options->latency);
+    if (sender == NULL || !gst_srt_bench_play (sender))
+      goto out;
+  }
+  pipelines[0] = receiver;
+  pipelines[1] = sender;
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->warmup * GST_SECOND))
+    goto out;
+
+  start_bytes = g_atomic_pointer_get (&counter.bytes);
+  start_buffers = g_atomic_pointer_get (&counter.buffers);
+  start_cpu = gst_srt_bench_cpu_time ();
+  start_time = gst_util_get_timestamp ();
+
+  if (!gst_srt_bench_wait (pipelines, 2, options->duration * GST_SECOND))
+    goto out;
+
+  bytes = g_atomic_pointer_get (&counter.bytes) - start_bytes;
+  buffers = g_atomic_pointer_get (&counter.buffers) - start_buffers;
+  cpu = gst_srt_bench_cpu_time () - start_cpu;
+  elapsed = (gdouble)(gst_util_get_timestamp () - start_time) / GST_SECOND;
+  achieved = bytes * 8 / elapsed / 1e6;
+
+  gst_srt_bench_output_add (out, gst_structure_new ("throughput",
+    "direction", G_TYPE_STRING, server_sink ? "srtserversink-srtclientsrc" :
+    "srtclientsink-srtserversrc",
+    "payload-size", G_TYPE_INT, size,
+    "target-mbps", G_TYPE_INT, mbps,
+    "achieved-mbps", G_TYPE_DOUBLE, achieved,
+    "packets", G_TYPE_UINT64, (guint64)buffers,
+    "cpu-percent", G_TYPE_DOUBLE, cpu / elapsed * 100,
+    "cpu-percent-per-mbps", G_TYPE_DOUBLE,
+    achieved > 0 ? cpu / elapsed * 100 / achieved : 0.0,
+    /* the SRT counters cover the warmup too */
+    "packets-lost", G_TYPE_INT64,
+    gst_srt_bench_get_stat (receiver, "srt", "packets-recv-lost"),
+    "packets-dropped", G_TYPE_INT64,
+    gst_srt_bench_get_stat (receiver, "srt", "packets-recv-dropped") +
+    gst_srt_bench_get_stat (sender, "srt", "packets-sent-dropped"),
+    "packets-retransmitted", G_TYPE_INT64,
+    gst_srt_bench_get_stat (sender, "srt", "packets-retransmitted"), NULL));
+  ret = TRUE;
+
+out:
+  /* Receiver first, so that it doesn't see the sender go away */
+  gst_srt_bench_stop (receiver);
+  gst_srt_bench_stop (sender);
+
+  return ret;
+}
+
+static gboolean
+throughput_run (const GstSRTBenchOptions * options, GstSRTBenchOutput * out)
+{
+  guint n_sizes, n_bitrates, i, j, k;
+  gint *sizes = gst_srt_bench_parse_list (sizes_list ? sizes_list :
+    SRT_BENCH_DEFAULT_SIZES, &n_sizes);
+  gint *bitrates = gst_srt_bench_parse_list (bitrates_list ? bitrates_list :
+    SRT_BENCH_DEFAULT_BITRATES, &n_bitrates);
+  gboolean ret = TRUE;
+
+  for (k = 0; k < 2; k++) {
+    for (i = 0; i < n_sizes; i++) {
+      for (j = 0; j < n_bitrates; j++) {
+        if (!throughput_run_one (options, k == 1, sizes[i], bitrates[j], out))
+          ret = FALSE;
+      }
+    }
+  }
+
+  g_free (bitrates);
+  g_free (sizes);
+
+  return ret;
+}
+
+const GstSRTBenchCommand gst_srt_bench_throughput = {
+  "throughput",
+  "Loopback throughput, CPU and drops at a range of payload sizes and bitrates",
+  throughput_add_options,
+  throughput_run
+};
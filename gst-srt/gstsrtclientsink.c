@@ -43,6 +43,7 @@
 
 #include "gstsrtclientsink.h"
 #include "gstsrt.h"
+#include "gstsrttracer.h"
 #include <srt.h>
 #include <gio/gio.h>
 
@@ -60,18 +61,21 @@ struct _GstSRTClientSinkPrivate
 {
   SRTSOCKET sock;
   GSocketAddress *sockaddr;
-  gint poll_id;
   ///NOTE: This is not currently used, since we removed the epoll thing
   gint poll_timeout;
 
   gboolean rendezvous;
   gchar *bind_address;
   guint16 bind_port;
+  gchar *streamid;
 
   gint prevSndDrop;
   gint prevSndLoss;
 
   gboolean sent_headers;
+
+  /* protected by the object lock */
+  GstSRTHistogram send_latency;
 };
 
 #define GST_SRT_CLIENT_SINK_GET_PRIVATE(obj)  \
@@ -83,6 +87,7 @@ enum
   PROP_BIND_ADDRESS,
   PROP_BIND_PORT,
   PROP_RENDEZ_VOUS,
+  PROP_STREAMID,
 #if GST_VERSION_MINOR >= 14
   PROP_STATS,
 #endif
@@ -115,14 +120,25 @@ gst_srt_client_sink_get_property (GObject * object,
   case PROP_BIND_ADDRESS:
     g_value_set_string (value, priv->bind_address);
     break;
+  case PROP_STREAMID:
+    g_value_set_string (value, priv->streamid);
+    break;
   case PROP_RENDEZ_VOUS:
     g_value_set_boolean (value, priv->bind_port);
     break;
 #if GST_VERSION_MINOR >= 14
   case PROP_STATS:
-    g_value_take_boxed (value, gst_srt_base_sink_get_stats (priv->sockaddr,
-      priv->sock));
+  {
+    GstStructure *s;
+
+    GST_OBJECT_LOCK (self);
+    s = gst_srt_base_sink_get_stats (priv->sockaddr, priv->sock);
+    gst_srt_histogram_add_to_structure (&priv->send_latency, s,
+      "send-latency");
+    GST_OBJECT_UNLOCK (self);
+    g_value_take_boxed (value, s);
     break;
+  }
 #endif
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -151,12 +167,27 @@ gst_srt_client_sink_set_property (GObject * object,
   case PROP_RENDEZ_VOUS:
     priv->rendezvous = g_value_get_boolean (value);
     break;
+  case PROP_STREAMID:
+    g_free (priv->streamid);
+    priv->streamid = g_value_dup_string (value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
   }
 }
 
+static void
+gst_srt_client_sink_finalize (GObject * object)
+{
+  GstSRTClientSink *self = GST_SRT_CLIENT_SINK (object);
+  GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
+
+  g_free (priv->bind_address);
+  g_free (priv->streamid);
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_srt_client_sink_start (GstBaseSink * sink)
 {
@@ -164,12 +195,35 @@ gst_srt_client_sink_start (GstBaseSink * sink)
   GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
   GstSRTBaseSink *base = GST_SRT_BASE_SINK (sink);
   GstUri *uri = gst_uri_ref (GST_SRT_BASE_SINK (self)->uri);
+  GSocketAddress *sockaddr = NULL;
+  SRTSOCKET sock;
 
   GST_DEBUG_OBJECT (self, "Will start SRT client sink");
-  priv->sock = gst_srt_client_connect_full (GST_ELEMENT (sink), TRUE,
+  GST_OBJECT_LOCK (self);
+  gst_srt_histogram_reset (&priv->send_latency);
+  GST_OBJECT_UNLOCK (self);
+
+  sock = gst_srt_client_connect_full (GST_ELEMENT (sink), TRUE,
     gst_uri_get_host (uri), gst_uri_get_port (uri), priv->rendezvous,
     priv->bind_address, priv->bind_port, base->latency,
-    &priv->sockaddr, &priv->poll_id, base->passphrase, base->key_length);
+    &sockaddr, NULL, base->passphrase, base->key_length,
+    base->km_refresh_rate, base->km_preannounce, priv->streamid,
+    base->packet_filter, base->transtype,
+    gst_srt_base_sink_get_expected_bitrate (base), base->profile,
+    base->srt_options);
+
+  /* foreach_socket may run from another thread */
+  GST_OBJECT_LOCK (self);
+  priv->sock = sock;
+  priv->sockaddr = sockaddr;
+  GST_OBJECT_UNLOCK (self);
+
+  if (priv->sock != SRT_INVALID_SOCK) {
+    gst_srt_base_sink_apply_bandwidth (base, priv->sock);
+    /* The receiver can start decoding without waiting for the encoder's
+     * next keyframe */
+    gst_srt_base_sink_request_key_unit (base);
+  }
 
   g_clear_pointer (&uri, gst_uri_unref);
 
@@ -182,29 +236,37 @@ send_buffer_internal (GstSRTBaseSink * sink,
   const GstMapInfo * mapinfo, gpointer user_data)
 {
   SRTSOCKET sock = GPOINTER_TO_INT (user_data);
+  GstClockTime start = gst_srt_tracer_now ();
 
-  if (srt_sendmsg2 (sock, (char *)mapinfo->data, (int)mapinfo->size,
-    0) == SRT_ERROR) {
+  if (!gst_srt_send (sock, sink->transtype, (char *)mapinfo->data,
+    mapinfo->size)) {
     GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, NULL,
       ("%s", srt_getlasterror_str ()));
     return FALSE;
   }
+  gst_srt_tracer_log_send (GST_ELEMENT_CAST (sink), start, mapinfo->size);
   GST_DEBUG_OBJECT (sink, "Sent %i bytes", (int)mapinfo->size);
 
   GstSRTClientSink *self = GST_SRT_CLIENT_SINK (sink);
   GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
+
+  GST_OBJECT_LOCK (self);
+  gst_srt_base_sink_record_send_latency (sink, &priv->send_latency,
+    sink->render_running_time);
+  GST_OBJECT_UNLOCK (self);
+
   SRT_TRACEBSTATS stats;
   int ret = srt_bstats (sock, &stats, 0);
   if (ret >= 0) {
-      int delSndDrop = stats.pktSndDrop - priv->prevSndDrop;
-      int delSndLoss = stats.pktSndLoss - priv->prevSndLoss;
+      int delSndDrop = stats.pktSndDropTotal - priv->prevSndDrop;
+      int delSndLoss = stats.pktSndLossTotal - priv->prevSndLoss;
 
       //if (delSndDrop != 0 || delSndLoss != 0){
       if (delSndDrop != 0){
           GST_WARNING_OBJECT (sink, "Dropped %i pkts loss %i. Total drop: %i loss:%i recv:%ld",
-              delSndDrop, delSndLoss, stats.pktSndDrop, stats.pktSndLoss, stats.pktSent);
-          priv->prevSndDrop = stats.pktSndDrop;
-          priv->prevSndLoss = stats.pktSndLoss;
+              delSndDrop, delSndLoss, stats.pktSndDropTotal, stats.pktSndLossTotal, stats.pktSentTotal);
+          priv->prevSndDrop = stats.pktSndDropTotal;
+          priv->prevSndLoss = stats.pktSndLossTotal;
       }
 
   }
@@ -230,26 +292,37 @@ gst_srt_client_sink_send_buffer (GstSRTBaseSink * sink,
   return send_buffer_internal (sink, mapinfo, GINT_TO_POINTER (priv->sock));
 }
 
+static void
+gst_srt_client_sink_foreach_socket (GstSRTBaseSink * sink,
+  GstSRTSocketFunc func, gpointer user_data)
+{
+  GstSRTClientSink *self = GST_SRT_CLIENT_SINK (sink);
+  GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
+
+  GST_OBJECT_LOCK (sink);
+  if (priv->sock != SRT_INVALID_SOCK)
+    func (GST_ELEMENT_CAST (sink), priv->sock, priv->sockaddr, user_data);
+  GST_OBJECT_UNLOCK (sink);
+}
+
 static gboolean
 gst_srt_client_sink_stop (GstBaseSink * sink)
 {
   GstSRTClientSink *self = GST_SRT_CLIENT_SINK (sink);
   GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
+  SRTSOCKET sock;
 
   GST_DEBUG_OBJECT (self, "closing SRT connection");
 
-  if (priv->poll_id != SRT_ERROR) {
-    srt_epoll_remove_usock (priv->poll_id, priv->sock);
-    srt_epoll_release (priv->poll_id);
-    priv->poll_id = SRT_ERROR;
-  }
+  GST_OBJECT_LOCK (self);
+  sock = priv->sock;
+  priv->sock = SRT_INVALID_SOCK;
+  g_clear_object (&priv->sockaddr);
+  GST_OBJECT_UNLOCK (self);
 
-  if (priv->sock != SRT_INVALID_SOCK) {
-    srt_close (priv->sock);
-    priv->sock = SRT_INVALID_SOCK;
-  }
+  if (sock != SRT_INVALID_SOCK)
+    srt_close (sock);
 
-  g_clear_object (&priv->sockaddr);
   priv->sent_headers = FALSE;
   return GST_BASE_SINK_CLASS (parent_class)->stop (sink);
 }
@@ -264,6 +337,7 @@ gst_srt_client_sink_class_init (GstSRTClientSinkClass * klass)
 
   gobject_class->set_property = gst_srt_client_sink_set_property;
   gobject_class->get_property = gst_srt_client_sink_get_property;
+  gobject_class->finalize = gst_srt_client_sink_finalize;
 
   properties[PROP_POLL_TIMEOUT] =
     g_param_spec_int ("poll-timeout", "Poll Timeout",
@@ -287,6 +361,18 @@ gst_srt_client_sink_class_init (GstSRTClientSinkClass * klass)
       "Work in Rendez-Vous mode instead of client/caller mode", FALSE,
       G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
 
+  /**
+    * GstSRTClientSink:streamid:
+    *
+    * Stream ID sent to the listener when connecting (SRTO_STREAMID), up
+    * to 512 characters. Listeners pick the stream, role or passphrase from
+    * it, e.g. "#!::r=live,m=publish".
+    */
+  properties[PROP_STREAMID] =
+    g_param_spec_string ("streamid", "Stream ID",
+      "Stream ID sent to the listener when connecting", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
 #if GST_VERSION_MINOR >= 14
   properties[PROP_STATS] = g_param_spec_boxed ("stats", "Statistics",
     "SRT Statistics", GST_TYPE_STRUCTURE,
@@ -306,6 +392,8 @@ gst_srt_client_sink_class_init (GstSRTClientSinkClass * klass)
 
   gstsrtbasesink_class->send_buffer =
     GST_DEBUG_FUNCPTR (gst_srt_client_sink_send_buffer);
+  gstsrtbasesink_class->foreach_socket =
+    GST_DEBUG_FUNCPTR (gst_srt_client_sink_foreach_socket);
   GST_DEBUG ("SRT client init");
 }
 
@@ -313,5 +401,6 @@ static void
 gst_srt_client_sink_init (GstSRTClientSink * self)
 {
   GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
+  priv->sock = SRT_INVALID_SOCK;
   priv->poll_timeout = SRT_DEFAULT_POLL_TIMEOUT;
 }
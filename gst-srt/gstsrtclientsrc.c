@@ -48,6 +48,7 @@
 #include <gio/gio.h>
 
 #include "gstsrt.h"
+#include "gstsrttracer.h"
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
   GST_PAD_SRC,
@@ -60,6 +61,7 @@ GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 struct _GstSRTClientSrcPrivate
 {
   SRTSOCKET sock;
+  GSocketAddress *sockaddr;
   gint poll_id;
   gint poll_timeout;
   gint last_msg_num;
@@ -67,6 +69,7 @@ struct _GstSRTClientSrcPrivate
   gboolean rendezvous;
   gchar *bind_address;
   guint16 bind_port;
+  gchar *streamid;
 };
 
 #define GST_SRT_CLIENT_SRC_GET_PRIVATE(obj)  \
@@ -79,6 +82,7 @@ enum
   PROP_BIND_ADDRESS,
   PROP_BIND_PORT,
   PROP_RENDEZ_VOUS,
+  PROP_STREAMID,
 #if GST_VERSION_MINOR >= 14
   PROP_STATS,
 #endif
@@ -114,13 +118,22 @@ gst_srt_client_src_get_property (GObject * object,
   case PROP_BIND_ADDRESS:
     g_value_set_string (value, priv->bind_address);
     break;
+  case PROP_STREAMID:
+    g_value_set_string (value, priv->streamid);
+    break;
   case PROP_RENDEZ_VOUS:
     g_value_set_boolean (value, priv->bind_port);
     break;
 #if GST_VERSION_MINOR >= 14
   case PROP_STATS:
-    g_value_take_boxed (value, gst_srt_base_src_get_stats (priv->sock));
+  {
+    GstStructure *s = gst_srt_base_src_get_stats (priv->sock);
+
+    gst_srt_base_src_add_latency_stats (GST_SRT_BASE_SRC (self), s);
+    gst_srt_base_src_add_ts_stats (GST_SRT_BASE_SRC (self), s);
+    g_value_take_boxed (value, s);
     break;
+  }
 #endif
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -149,6 +162,10 @@ gst_srt_client_src_set_property (GObject * object,
   case PROP_RENDEZ_VOUS:
     priv->rendezvous = g_value_get_boolean (value);
     break;
+  case PROP_STREAMID:
+    g_free (priv->streamid);
+    priv->streamid = g_value_dup_string (value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -171,7 +188,9 @@ gst_srt_client_src_finalize (GObject * object)
     priv->sock = SRT_INVALID_SOCK;
   }
 
+  g_clear_object (&priv->sockaddr);
   g_free (priv->bind_address);
+  g_free (priv->streamid);
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -180,12 +199,14 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
 {
   GstSRTClientSrc *self = GST_SRT_CLIENT_SRC (src);
   GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (src);
   GstFlowReturn ret = GST_FLOW_OK;
   GstMapInfo info;
   /*int numSockets = 1;*/
   /*SRTSOCKET readySocket = 0;*/
   gint recv_len;
   SRT_MSGCTRL ctrl;
+  GstClockTime start;
 
   /*
   if (srt_epoll_wait (priv->poll_id,
@@ -215,13 +236,25 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
   }
 
   GST_LOG_OBJECT(self, "Will recv");
-  recv_len = srt_recvmsg2 (priv->sock, (char*)info.data,
-      (int)gst_buffer_get_size (outbuf), &ctrl);
+  start = gst_srt_tracer_now ();
+  if (base->transtype == GST_SRT_TRANSTYPE_FILE)
+    recv_len = srt_recv (priv->sock, (char*)info.data,
+        (int)gst_buffer_get_size (outbuf));
+  else
+    recv_len = srt_recvmsg2 (priv->sock, (char*)info.data,
+        (int)gst_buffer_get_size (outbuf), &ctrl);
+  gst_srt_tracer_log_recv (GST_ELEMENT_CAST (self), start, recv_len);
   GST_LOG_OBJECT(self, "recieved");
 
   gst_buffer_unmap (outbuf, &info);
 
-  if (recv_len == SRT_ERROR) {
+  /* A file transfer ends with the sender closing the connection */
+  if (recv_len == SRT_ERROR && base->transtype == GST_SRT_TRANSTYPE_FILE
+      && srt_getlasterror (NULL) == SRT_ECONNLOST) {
+    GST_DEBUG_OBJECT (self, "SRT transfer done");
+    ret = GST_FLOW_EOS;
+    goto out;
+  } else if (recv_len == SRT_ERROR) {
     GST_ELEMENT_ERROR (self, RESOURCE, READ,
       (NULL), ("srt_recvmsg error: %s", srt_getlasterror_str ()));
     ret = GST_FLOW_ERROR;
@@ -231,17 +264,21 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     ret = GST_FLOW_EOS;
     goto out;
   }
-  else if (recv_len != 1316) {
-      GST_WARNING ("Weird received size of %d", recv_len);
-  }
 
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE) {
+    /* Stripped of their null packets, messages are shorter */
+    if (recv_len != 1316 && !base->restore_null_packets) {
+        GST_WARNING ("Weird received size of %d", recv_len);
+    }
 
-  // Check if we've dropped some packets
-  if (priv->last_msg_num != 0
-      && (ctrl.msgno - priv->last_msg_num) > 1) {
-      GST_WARNING_OBJECT (self, "Dropped %d. %d->%d", (ctrl.msgno - priv->last_msg_num - 1), priv->last_msg_num, ctrl.msgno);
+    // Check if we've dropped some packets
+    if (priv->last_msg_num != 0
+        && (ctrl.msgno - priv->last_msg_num) > 1) {
+        GST_WARNING_OBJECT (self, "Dropped %d. %d->%d", (ctrl.msgno - priv->last_msg_num - 1), priv->last_msg_num, ctrl.msgno);
+        gst_srt_base_src_request_key_unit (base);
+    }
+    priv->last_msg_num = ctrl.msgno;
   }
-  priv->last_msg_num = ctrl.msgno;
 
   GST_BUFFER_PTS (outbuf) =
     gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
@@ -249,6 +286,9 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
 
   gst_buffer_resize (outbuf, 0, recv_len);
 
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE)
+    gst_srt_base_src_record_latency (base, &ctrl);
+
   GST_LOG_OBJECT (src,
     "filled buffer from _get of size %" G_GSIZE_FORMAT ", ts %"
     GST_TIME_FORMAT ", dur %" GST_TIME_FORMAT
@@ -269,7 +309,10 @@ gst_srt_client_src_start (GstBaseSrc * src)
   GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
   GstSRTBaseSrc *base = GST_SRT_BASE_SRC (src);
   GstUri *uri = gst_uri_ref (base->uri);
-  GSocketAddress *socket_address = NULL;
+  gint latency = base->latency;
+  GSocketAddress *sockaddr = NULL;
+  SRTSOCKET sock;
+  gboolean cancelled;
 
   GST_INFO_OBJECT (self, "Will start SRT client src");
 
@@ -289,14 +332,68 @@ gst_srt_client_src_start (GstBaseSrc * src)
   srt_setloghandler (NAME, SRTLogHandler);
 #endif
 
-  priv->sock = gst_srt_client_connect_full (GST_ELEMENT (src), FALSE,
+  if (base->auto_latency) {
+    /* Keyed like the sessions sampled by address, see sample_link */
+    gchar *peer = gst_srt_latency_host_name (gst_uri_get_host (uri));
+
+    latency = gst_srt_base_src_get_latency_for_peer (base, peer);
+
+    /* The receiver latency is fixed once connected, so an unknown peer is
+     * measured on a first connection. Rebinding the port right away is not
+     * reliable in rendez-vous mode */
+    if (latency < 0 && base->auto_latency_probe > 0 && !priv->rendezvous) {
+      sock = gst_srt_client_connect_full (GST_ELEMENT (src), FALSE,
+        gst_uri_get_host (uri), gst_uri_get_port (uri), FALSE,
+        priv->bind_address, priv->bind_port, base->latency,
+        &sockaddr, &priv->poll_id, base->passphrase, base->key_length,
+        base->km_refresh_rate, base->km_preannounce, priv->streamid,
+        base->packet_filter, base->transtype, base->bitrate, base->profile,
+        base->srt_options);
+      if (sock == SRT_INVALID_SOCK) {
+        g_free (peer);
+        g_clear_pointer (&uri, gst_uri_unref);
+        return FALSE;
+      }
+
+      cancelled = !gst_srt_base_src_probe_latency (base, sock, peer,
+        &latency);
+
+      srt_epoll_release (priv->poll_id);
+      priv->poll_id = SRT_ERROR;
+      srt_close (sock);
+      g_clear_object (&sockaddr);
+
+      if (cancelled) {
+        g_free (peer);
+        g_clear_pointer (&uri, gst_uri_unref);
+        return FALSE;
+      }
+    }
+    g_free (peer);
+
+    if (latency < 0)
+      latency = base->latency;
+  }
+
+  sock = gst_srt_client_connect_full (GST_ELEMENT (src), FALSE,
     gst_uri_get_host (uri), gst_uri_get_port (uri), priv->rendezvous,
-    priv->bind_address, priv->bind_port, base->latency,
-    &socket_address, &priv->poll_id, base->passphrase, base->key_length);
+    priv->bind_address, priv->bind_port, latency,
+    &sockaddr, &priv->poll_id, base->passphrase, base->key_length,
+    base->km_refresh_rate, base->km_preannounce, priv->streamid,
+    base->packet_filter, base->transtype, base->bitrate, base->profile,
+    base->srt_options);
   GST_INFO_OBJECT (self, "SRT client src connected");
 
+  /* foreach_socket may run from another thread */
+  GST_OBJECT_LOCK (self);
+  priv->sock = sock;
+  priv->sockaddr = sockaddr;
+  GST_OBJECT_UNLOCK (self);
+
+  if (priv->sock != SRT_INVALID_SOCK)
+    gst_srt_base_src_set_effective_latency (base, priv->sock);
+
   priv->last_msg_num = 0;
-  g_clear_object (&socket_address);
   g_clear_pointer (&uri, gst_uri_unref);
 
   return (priv->sock != SRT_INVALID_SOCK);
@@ -324,6 +421,8 @@ gst_srt_client_src_unlock (GstBaseSrc * src)
 {
   GstSRTClientSrc *self = GST_SRT_CLIENT_SRC (src);
   GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
+  SRTSOCKET sock;
+
   GST_INFO_OBJECT (self, "unlocking client SRT connection");
   if (priv->poll_id != SRT_ERROR) {
     if (priv->sock != SRT_INVALID_SOCK)
@@ -333,10 +432,29 @@ gst_srt_client_src_unlock (GstBaseSrc * src)
   priv->poll_id = SRT_ERROR;
 
   GST_INFO_OBJECT (self, "closing SRT connection");
-  if (priv->sock != SRT_INVALID_SOCK)
-    srt_close (priv->sock);
+  GST_OBJECT_LOCK (self);
+  sock = priv->sock;
   priv->sock = SRT_INVALID_SOCK;
-  return TRUE;
+  g_clear_object (&priv->sockaddr);
+  GST_OBJECT_UNLOCK (self);
+
+  if (sock != SRT_INVALID_SOCK)
+    srt_close (sock);
+
+  return GST_BASE_SRC_CLASS (parent_class)->unlock (src);
+}
+
+static void
+gst_srt_client_src_foreach_socket (GstSRTBaseSrc * src,
+  GstSRTSocketFunc func, gpointer user_data)
+{
+  GstSRTClientSrc *self = GST_SRT_CLIENT_SRC (src);
+  GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
+
+  GST_OBJECT_LOCK (src);
+  if (priv->sock != SRT_INVALID_SOCK)
+    func (GST_ELEMENT_CAST (src), priv->sock, priv->sockaddr, user_data);
+  GST_OBJECT_UNLOCK (src);
 }
 
 static void
@@ -346,6 +464,7 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
   GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_client_src_set_property;
   gobject_class->get_property = gst_srt_client_src_get_property;
@@ -378,6 +497,18 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
       "Work in Rendez-Vous mode instead of client/caller mode", FALSE,
       G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
 
+  /**
+    * GstSRTClientSrc:streamid:
+    *
+    * Stream ID sent to the listener when connecting (SRTO_STREAMID), up
+    * to 512 characters. Listeners pick the stream, role or passphrase from
+    * it, e.g. "#!::r=live,m=request".
+    */
+  properties[PROP_STREAMID] =
+    g_param_spec_string ("streamid", "Stream ID",
+      "Stream ID sent to the listener when connecting", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
 #if GST_VERSION_MINOR >= 14
   properties[PROP_STATS] = g_param_spec_boxed ("stats", "Statistics",
     "SRT Statistics", GST_TYPE_STRUCTURE,
@@ -396,6 +527,9 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_srt_client_src_stop);
   gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_srt_client_src_unlock);
   gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_client_src_fill);
+
+  gstsrtbasesrc_class->foreach_socket =
+    GST_DEBUG_FUNCPTR (gst_srt_client_src_foreach_socket);
 }
 
 static void
@@ -0,0 +1,140 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Log-linear histograms for the latency statistics: constant memory and
+ * O(1) recording, so they can be updated for every packet. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrthistogram.h"
+
+#include <string.h>
+
+static guint
+bucket_index (guint64 value)
+{
+  guint msb;
+
+  if (value > G_MAXUINT32)
+    value = G_MAXUINT32;
+
+  if (value < SRT_HISTOGRAM_SUB_BUCKETS)
+    return (guint)value;
+
+  msb = g_bit_storage (value) - 1;
+
+  return SRT_HISTOGRAM_SUB_BUCKETS * (msb - SRT_HISTOGRAM_SUB_BITS + 1) +
+    (guint)((value >> (msb - SRT_HISTOGRAM_SUB_BITS)) -
+    SRT_HISTOGRAM_SUB_BUCKETS);
+}
+
+/* Largest value that falls in the bucket @index */
+static guint64
+bucket_upper_bound (guint index)
+{
+  guint shift;
+  guint64 mantissa;
+
+  if (index < SRT_HISTOGRAM_SUB_BUCKETS)
+    return index;
+
+  shift = index / SRT_HISTOGRAM_SUB_BUCKETS - 1;
+  mantissa = SRT_HISTOGRAM_SUB_BUCKETS + index % SRT_HISTOGRAM_SUB_BUCKETS;
+
+  return ((mantissa + 1) << shift) - 1;
+}
+
+void
+gst_srt_histogram_reset (GstSRTHistogram * hist)
+{
+  memset (hist, 0, sizeof (GstSRTHistogram));
+}
+
+void
+gst_srt_histogram_record (GstSRTHistogram * hist, guint64 value)
+{
+  hist->counts[bucket_index (value)]++;
+  hist->samples++;
+  if (value > hist->max)
+    hist->max = value;
+}
+
+/**
+ * gst_srt_histogram_percentile:
+ * @hist: a #GstSRTHistogram
+ * @percentile: the percentile to compute, between 0 and 100
+ *
+ * Returns: the upper bound of the bucket holding @percentile, never more
+ * than the largest recorded value, or 0 if nothing was recorded.
+ */
+guint64
+gst_srt_histogram_percentile (const GstSRTHistogram * hist,
+  gdouble percentile)
+{
+  guint64 rank, seen = 0;
+  guint i;
+
+  if (hist->samples == 0)
+    return 0;
+
+  rank = (guint64)(percentile / 100.0 * hist->samples + 0.5);
+  rank = CLAMP (rank, 1, hist->samples);
+
+  for (i = 0; i < SRT_HISTOGRAM_BUCKETS; i++) {
+    seen += hist->counts[i];
+    if (seen >= rank)
+      return MIN (bucket_upper_bound (i), hist->max);
+  }
+
+  return hist->max;
+}
+
+/**
+ * gst_srt_histogram_add_to_structure:
+ * @hist: a #GstSRTHistogram of microsecond values
+ * @s: the structure to fill
+ * @prefix: the field name prefix
+ *
+ * Sets the "@prefix-p50-us", "@prefix-p99-us", "@prefix-p999-us",
+ * "@prefix-max-us" and "@prefix-samples" fields of @s.
+ */
+void
+gst_srt_histogram_add_to_structure (const GstSRTHistogram * hist,
+  GstStructure * s, const gchar * prefix)
+{
+  gchar *p50 = g_strconcat (prefix, "-p50-us", NULL);
+  gchar *p99 = g_strconcat (prefix, "-p99-us", NULL);
+  gchar *p999 = g_strconcat (prefix, "-p999-us", NULL);
+  gchar *max = g_strconcat (prefix, "-max-us", NULL);
+  gchar *samples = g_strconcat (prefix, "-samples", NULL);
+
+  gst_structure_set (s,
+    p50, G_TYPE_UINT64, gst_srt_histogram_percentile (hist, 50.0),
+    p99, G_TYPE_UINT64, gst_srt_histogram_percentile (hist, 99.0),
+    p999, G_TYPE_UINT64, gst_srt_histogram_percentile (hist, 99.9),
+    max, G_TYPE_UINT64, hist->max,
+    samples, G_TYPE_UINT64, hist->samples, NULL);
+
+  g_free (samples);
+  g_free (max);
+  g_free (p999);
+  g_free (p99);
+  g_free (p50);
+}
@@ -0,0 +1,53 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_HISTOGRAM_H__
+#define __GST_SRT_HISTOGRAM_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Each power of two is split in 2^SRT_HISTOGRAM_SUB_BITS linear buckets,
+ * which bounds the relative error of a percentile to about 6% */
+#define SRT_HISTOGRAM_SUB_BITS 4
+#define SRT_HISTOGRAM_SUB_BUCKETS (1 << SRT_HISTOGRAM_SUB_BITS)
+/* Values are clamped to 32 bits, over an hour in microseconds */
+#define SRT_HISTOGRAM_BUCKETS \
+  (SRT_HISTOGRAM_SUB_BUCKETS * (33 - SRT_HISTOGRAM_SUB_BITS))
+
+typedef struct
+{
+  guint64 counts[SRT_HISTOGRAM_BUCKETS];
+  guint64 samples;
+  guint64 max;
+} GstSRTHistogram;
+
+void gst_srt_histogram_reset (GstSRTHistogram * hist);
+
+void gst_srt_histogram_record (GstSRTHistogram * hist, guint64 value);
+
+guint64 gst_srt_histogram_percentile (const GstSRTHistogram * hist,
+  gdouble percentile);
+
+void gst_srt_histogram_add_to_structure (const GstSRTHistogram * hist,
+  GstStructure * s, const gchar * prefix);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_HISTOGRAM_H__ */
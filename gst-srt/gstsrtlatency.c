@@ -0,0 +1,233 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Picks the receiver latency from the RTT and loss of a link. Following
+ * the SRT deployment guidelines the latency is a multiple of the RTT that
+ * grows with the loss rate, which leaves room for enough retransmissions,
+ * plus four standard deviations of the RTT as a jitter margin.
+ *
+ * The measured links are cached per peer address for the next sessions,
+ * in memory and in the key file named by GST_SRT_LATENCY_CACHE if set. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtlatency.h"
+
+#include <gio/gio.h>
+#include <math.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_srt_latency);
+#define GST_CAT_DEFAULT gst_debug_srt_latency
+
+typedef struct
+{
+  gdouble max_loss;
+  gdouble rtt_factor;
+} SRTLatencyStep;
+
+static const SRTLatencyStep latency_steps[] = {
+  {0.01, 3.0},
+  {0.03, 4.0},
+  {0.07, 6.0},
+  {0.10, 8.0},
+  {G_MAXDOUBLE, 10.0},
+};
+
+static GMutex cache_lock;
+static GKeyFile *cache;
+static gchar *cache_location;
+
+void
+gst_srt_link_probe_init (GstSRTLinkProbe * probe)
+{
+  memset (probe, 0, sizeof (*probe));
+}
+
+void
+gst_srt_link_probe_sample (GstSRTLinkProbe * probe, SRTSOCKET sock)
+{
+  SRT_TRACEBSTATS stats;
+  gdouble delta;
+
+  if (sock == SRT_INVALID_SOCK || srt_bstats (sock, &stats, 0) < 0)
+    return;
+
+  /* The RTT is only measured once data, and so ACKs, flow */
+  if (stats.pktRecvTotal == 0 || stats.msRTT <= 0)
+    return;
+
+  probe->n_samples++;
+  delta = stats.msRTT - probe->rtt_mean;
+  probe->rtt_mean += delta / probe->n_samples;
+  probe->rtt_m2 += delta * (stats.msRTT - probe->rtt_mean);
+  probe->packets_recv = stats.pktRecvTotal;
+  probe->packets_lost = stats.pktRcvLossTotal;
+}
+
+gboolean
+gst_srt_link_probe_get (const GstSRTLinkProbe * probe, gdouble * rtt,
+  gdouble * rtt_dev, gdouble * loss)
+{
+  gint64 total = probe->packets_recv + probe->packets_lost;
+
+  if (probe->n_samples == 0)
+    return FALSE;
+
+  *rtt = probe->rtt_mean;
+  *rtt_dev = probe->n_samples > 1 ?
+    sqrt (probe->rtt_m2 / (probe->n_samples - 1)) : 0.0;
+  *loss = total > 0 ? (gdouble)probe->packets_lost / total : 0.0;
+
+  return TRUE;
+}
+
+gint
+gst_srt_latency_compute (gdouble rtt, gdouble rtt_dev, gdouble loss)
+{
+  gdouble latency;
+  guint i;
+
+  for (i = 0; loss > latency_steps[i].max_loss; i++);
+
+  latency = latency_steps[i].rtt_factor * rtt + 4.0 * rtt_dev;
+
+  return CLAMP ((gint)ceil (latency), SRT_AUTO_LATENCY_MIN,
+    SRT_AUTO_LATENCY_MAX);
+}
+
+/* Called with the cache lock */
+static void
+cache_ensure (void)
+{
+  GError *error = NULL;
+
+  if (cache != NULL)
+    return;
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_srt_latency, "srtlatency", 0,
+    "SRT automatic latency");
+
+  cache = g_key_file_new ();
+  cache_location = g_strdup (g_getenv (SRT_LATENCY_CACHE_ENV));
+  if (cache_location == NULL || cache_location[0] == '\0')
+    return;
+
+  if (!g_key_file_load_from_file (cache, cache_location, G_KEY_FILE_NONE,
+      &error)) {
+    if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      GST_WARNING ("Can't read the latency cache %s: %s", cache_location,
+        error->message);
+    g_clear_error (&error);
+  }
+}
+
+gboolean
+gst_srt_latency_cache_lookup (const gchar * peer, gdouble * rtt,
+  gdouble * rtt_dev, gdouble * loss)
+{
+  gboolean found = FALSE;
+
+  g_mutex_lock (&cache_lock);
+  cache_ensure ();
+  if (g_key_file_has_group (cache, peer)) {
+    *rtt = g_key_file_get_double (cache, peer, "rtt", NULL);
+    *rtt_dev = g_key_file_get_double (cache, peer, "rtt-deviation", NULL);
+    *loss = g_key_file_get_double (cache, peer, "loss", NULL);
+    found = *rtt > 0;
+  }
+  g_mutex_unlock (&cache_lock);
+
+  return found;
+}
+
+void
+gst_srt_latency_cache_store (const gchar * peer,
+  const GstSRTLinkProbe * probe)
+{
+  gdouble rtt, rtt_dev, loss;
+  GError *error = NULL;
+
+  if (!gst_srt_link_probe_get (probe, &rtt, &rtt_dev, &loss))
+    return;
+
+  g_mutex_lock (&cache_lock);
+  cache_ensure ();
+  g_key_file_set_double (cache, peer, "rtt", rtt);
+  g_key_file_set_double (cache, peer, "rtt-deviation", rtt_dev);
+  g_key_file_set_double (cache, peer, "loss", loss);
+  g_key_file_set_int64 (cache, peer, "updated", g_get_real_time () / 1000000);
+
+  GST_DEBUG ("%s: RTT %.1f ms (deviation %.1f ms), loss %.2f%%", peer, rtt,
+    rtt_dev, loss * 100);
+
+  if (cache_location != NULL && cache_location[0] != '\0'
+      && !g_key_file_save_to_file (cache, cache_location, &error)) {
+    GST_WARNING ("Can't write the latency cache %s: %s", cache_location,
+      error->message);
+    g_clear_error (&error);
+  }
+  g_mutex_unlock (&cache_lock);
+}
+
+/* The cache key of a peer: its address without the port, which changes
+ * with every connection of a caller */
+gchar *
+gst_srt_latency_peer_name (GSocketAddress * sockaddr)
+{
+  if (!G_IS_INET_SOCKET_ADDRESS (sockaddr))
+    return NULL;
+
+  return g_inet_address_to_string (g_inet_socket_address_get_address (
+      G_INET_SOCKET_ADDRESS (sockaddr)));
+}
+
+/* The cache key of a peer given by host name, the same as the one of its
+ * resolved address. Blocks on the resolver for names */
+gchar *
+gst_srt_latency_host_name (const gchar * host)
+{
+  GInetAddress *addr;
+  GList *addrs;
+  gchar *name;
+
+  if (host == NULL)
+    return NULL;
+
+  addr = g_inet_address_new_from_string (host);
+  if (addr == NULL) {
+    GResolver *resolver = g_resolver_get_default ();
+
+    addrs = g_resolver_lookup_by_name (resolver, host, NULL, NULL);
+    if (addrs != NULL) {
+      addr = g_object_ref (addrs->data);
+      g_resolver_free_addresses (addrs);
+    }
+    g_object_unref (resolver);
+  }
+
+  if (addr == NULL)
+    return g_strdup (host);
+
+  name = g_inet_address_to_string (addr);
+  g_object_unref (addr);
+
+  return name;
+}
@@ -0,0 +1,69 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_LATENCY_H__
+#define __GST_SRT_LATENCY_H__
+
+#include <gst/gst.h>
+#include <srt.h>
+
+/* Keep the links measured by the auto-latency mode in this key file, so
+ * that they outlive the process */
+#define SRT_LATENCY_CACHE_ENV "GST_SRT_LATENCY_CACHE"
+#define SRT_DEFAULT_AUTO_LATENCY FALSE
+/* Measuring time before connecting for good to an unknown peer, in ms */
+#define SRT_DEFAULT_AUTO_LATENCY_PROBE 1000
+/* Bounds of the chosen latency, in ms */
+#define SRT_AUTO_LATENCY_MIN 20
+#define SRT_AUTO_LATENCY_MAX 8000
+
+G_BEGIN_DECLS
+
+/* RTT and loss of a link, sampled from the SRT statistics */
+typedef struct
+{
+  guint n_samples;
+  /* running mean and sum of squared deviations of the RTT, in ms */
+  gdouble rtt_mean;
+  gdouble rtt_m2;
+  gint64 packets_recv;
+  gint64 packets_lost;
+} GstSRTLinkProbe;
+
+void gst_srt_link_probe_init (GstSRTLinkProbe * probe);
+
+void gst_srt_link_probe_sample (GstSRTLinkProbe * probe, SRTSOCKET sock);
+
+gboolean gst_srt_link_probe_get (const GstSRTLinkProbe * probe,
+  gdouble * rtt, gdouble * rtt_dev, gdouble * loss);
+
+gint gst_srt_latency_compute (gdouble rtt, gdouble rtt_dev, gdouble loss);
+
+gboolean gst_srt_latency_cache_lookup (const gchar * peer, gdouble * rtt,
+  gdouble * rtt_dev, gdouble * loss);
+
+void gst_srt_latency_cache_store (const gchar * peer,
+  const GstSRTLinkProbe * probe);
+
+gchar * gst_srt_latency_peer_name (GSocketAddress * sockaddr);
+
+gchar * gst_srt_latency_host_name (const gchar * host);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_LATENCY_H__ */
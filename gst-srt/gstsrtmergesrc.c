@@ -0,0 +1,717 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-srtmergesrc
+ * @title: srtmergesrc
+ *
+ * srtmergesrc connects to two SRT servers sending the same MPEG-TS and
+ * outputs a single stream in which every TS packet appears once, in the
+ * spirit of SMPTE 2022-7 seamless protection switching. A packet is output
+ * from whichever path delivers it first and the copy from the other path
+ * is dropped, so a loss burst on one path is filled from the other and
+ * never reaches the decoder.
+ *
+ * TS packets are aligned per PID on their continuity counter and payload.
+ * The adaptation field is left out, so the senders may be fed by separate
+ * muxers that stamp their own PCR and stuffing, as long as they packetize
+ * the elementary streams alike. Both senders should use the same
+ * #GstSRTBaseSrc:latency so that TSBPD delivers the copies at about the
+ * same time. #GstSRTMergeSrc:merge-window must cover the remaining skew
+ * between the paths. Messages that are not 188 byte aligned TS are merged
+ * as a whole.
+ *
+ * <refsect2>
+ * <title>Examples</title>
+ * |[
+ * gst-launch-1.0 -v srtmergesrc uri="srt://10.0.0.1:7001" secondary-uri="srt://10.1.0.1:7001" ! tsdemux ! fakesink
+ * ]| This pipeline receives the same stream over two networks.
+ * </refsect2>
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtmergesrc.h"
+#include <srt.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "gstsrt.h"
+#include "gstsrttracer.h"
+
+#define TS_PACKET_SIZE 188
+#define TS_SYNC_BYTE 0x47
+
+#define SRT_DEFAULT_MERGE_WINDOW 500
+/* Packets remembered at most, about 1 s at 100 Mbit/s */
+#define SRT_MERGE_MAX_PACKETS 65536
+/* Longest wait before checking for unlock */
+#define SRT_MERGE_POLL_INTERVAL 100
+
+#define N_PATHS 2
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+  GST_PAD_SRC,
+  GST_PAD_ALWAYS,
+  GST_STATIC_CAPS_ANY);
+
+#define GST_CAT_DEFAULT gst_debug_srt_merge_src
+GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
+
+typedef struct
+{
+  SRTSOCKET sock;
+  GSocketAddress *sockaddr;
+  /* packets it delivered first */
+  guint64 unique;
+  /* packets the other path had already delivered */
+  guint64 duplicates;
+} SRTMergePath;
+
+/* A packet key output within the merge window. Each path delivers every
+ * occurrence once, so an occurrence is new if the path has seen the key at
+ * least as often as it was output */
+typedef struct
+{
+  guint64 hash;
+  guint emitted;
+  guint seen[N_PATHS];
+  /* its occurrences still in the window */
+  guint refs;
+} SRTMergeEntry;
+
+typedef struct
+{
+  SRTMergeEntry *entry;
+  gint64 time;
+} SRTMergeRecord;
+
+struct _GstSRTMergeSrcPrivate
+{
+  gchar *secondary_uri;
+  gchar *streamid;
+  gint merge_window;
+
+  SRTMergePath paths[N_PATHS];
+  gint poll_id;
+  gboolean cancelled;
+
+  /* hash -> SRTMergeEntry */
+  GHashTable *entries;
+  /* output order of the entries, oldest first */
+  SRTMergeRecord *records;
+  guint records_head;
+  guint records_len;
+};
+
+#define GST_SRT_MERGE_SRC_GET_PRIVATE(obj)  \
+       (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_SRT_MERGE_SRC, GstSRTMergeSrcPrivate))
+
+enum
+{
+  PROP_SECONDARY_URI = 1,
+  PROP_MERGE_WINDOW,
+  PROP_STREAMID,
+#if GST_VERSION_MINOR >= 14
+  PROP_STATS,
+#endif
+
+  /*< private > */
+  PROP_LAST
+};
+
+static GParamSpec *properties[PROP_LAST];
+
+#define gst_srt_merge_src_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstSRTMergeSrc, gst_srt_merge_src,
+  GST_TYPE_SRT_BASE_SRC, G_ADD_PRIVATE (GstSRTMergeSrc)
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "srtmergesrc", 0,
+    "SRT Merge Source"));
+
+#if GST_VERSION_MINOR >= 14
+static GstStructure *
+gst_srt_merge_src_get_stats (GstSRTMergeSrc * self)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  GstStructure *s = gst_structure_new_empty ("application/x-srt-merge-stats");
+  guint i;
+
+  for (i = 0; i < N_PATHS; i++) {
+    SRTMergePath *path = &priv->paths[i];
+    GstStructure *path_stats;
+    gchar *name = g_strdup_printf ("path%u", i);
+
+    /* close_path clears the paths under the lock */
+    GST_OBJECT_LOCK (self);
+    path_stats = gst_srt_base_src_get_stats (path->sock);
+    gst_structure_set (path_stats,
+      "connected", G_TYPE_BOOLEAN, path->sock != SRT_INVALID_SOCK,
+      "unique-packets", G_TYPE_UINT64, path->unique,
+      "duplicate-packets", G_TYPE_UINT64, path->duplicates, NULL);
+    GST_OBJECT_UNLOCK (self);
+
+    gst_structure_set (s, name, GST_TYPE_STRUCTURE, path_stats, NULL);
+    gst_structure_free (path_stats);
+    g_free (name);
+  }
+
+  gst_srt_base_src_add_latency_stats (GST_SRT_BASE_SRC (self), s);
+  gst_srt_base_src_add_ts_stats (GST_SRT_BASE_SRC (self), s);
+
+  return s;
+}
+#endif
+
+static void
+gst_srt_merge_src_get_property (GObject * object,
+  guint prop_id, GValue * value, GParamSpec * pspec)
+{
+  GstSRTMergeSrc *self = GST_SRT_MERGE_SRC (object);
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+
+  switch (prop_id) {
+  case PROP_SECONDARY_URI:
+    g_value_set_string (value, priv->secondary_uri);
+    break;
+  case PROP_MERGE_WINDOW:
+    g_value_set_int (value, priv->merge_window);
+    break;
+  case PROP_STREAMID:
+    g_value_set_string (value, priv->streamid);
+    break;
+#if GST_VERSION_MINOR >= 14
+  case PROP_STATS:
+    g_value_take_boxed (value, gst_srt_merge_src_get_stats (self));
+    break;
+#endif
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    break;
+  }
+}
+
+static void
+gst_srt_merge_src_set_property (GObject * object,
+  guint prop_id, const GValue * value, GParamSpec * pspec)
+{
+  GstSRTMergeSrc *self = GST_SRT_MERGE_SRC (object);
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+
+  switch (prop_id) {
+  case PROP_SECONDARY_URI:
+    g_free (priv->secondary_uri);
+    priv->secondary_uri = g_value_dup_string (value);
+    break;
+  case PROP_MERGE_WINDOW:
+    priv->merge_window = g_value_get_int (value);
+    break;
+  case PROP_STREAMID:
+    g_free (priv->streamid);
+    priv->streamid = g_value_dup_string (value);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    break;
+  }
+}
+
+static void
+gst_srt_merge_src_clear_entries (GstSRTMergeSrc * self)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+
+  g_hash_table_remove_all (priv->entries);
+  priv->records_head = 0;
+  priv->records_len = 0;
+}
+
+static void
+gst_srt_merge_src_finalize (GObject * object)
+{
+  GstSRTMergeSrc *self = GST_SRT_MERGE_SRC (object);
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+
+  g_hash_table_unref (priv->entries);
+  g_free (priv->records);
+  g_free (priv->secondary_uri);
+  g_free (priv->streamid);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+#define FNV_OFFSET_BASIS G_GUINT64_CONSTANT (0xcbf29ce484222325)
+
+/* FNV-1a, continuing from @hash */
+static inline guint64
+hash_bytes (guint64 hash, const guint8 * data, gsize size)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= G_GUINT64_CONSTANT (0x100000001b3);
+  }
+
+  return hash;
+}
+
+/* The key of a TS packet: its PID and continuity counter, then its
+ * payload. The adaptation field carries the PCR and stuffing of each
+ * muxer, so it is left out */
+static inline guint64
+key_ts_packet (const guint8 * data)
+{
+  guint8 id[3] = { data[1] & 0x1f, data[2], data[3] & 0x0f };
+  gsize start = 4;
+
+  if (data[3] & 0x20)
+    start += 1 + data[4];
+  if (!(data[3] & 0x10) || start > TS_PACKET_SIZE)
+    start = TS_PACKET_SIZE;
+
+  return hash_bytes (hash_bytes (FNV_OFFSET_BASIS, id, sizeof (id)),
+    data + start, TS_PACKET_SIZE - start);
+}
+
+/* Forgets the oldest output packet, the entry with it once none of its
+ * occurrences is left in the window */
+static void
+drop_oldest_record (GstSRTMergeSrcPrivate * priv)
+{
+  SRTMergeRecord *record = &priv->records[priv->records_head];
+  SRTMergeEntry *entry = record->entry;
+
+  priv->records_head = (priv->records_head + 1) % SRT_MERGE_MAX_PACKETS;
+  priv->records_len--;
+
+  if (--entry->refs == 0)
+    g_hash_table_remove (priv->entries, &entry->hash);
+}
+
+/* Drops the packets of @data the other path already delivered, in place.
+ * Returns the size of what is left */
+static gsize
+merge_message (GstSRTMergeSrc * self, guint path_index, guint8 * data,
+  gsize size)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  gint64 now = g_get_monotonic_time ();
+  gint64 window = (gint64)priv->merge_window * 1000;
+  gsize unit, offset, out = 0;
+  guint unique = 0, duplicates = 0;
+
+  while (priv->records_len > 0
+      && now - priv->records[priv->records_head].time > window)
+    drop_oldest_record (priv);
+
+  if (size % TS_PACKET_SIZE == 0 && data[0] == TS_SYNC_BYTE)
+    unit = TS_PACKET_SIZE;
+  else
+    unit = size;
+
+  for (offset = 0; offset < size; offset += unit) {
+    guint64 hash = unit == TS_PACKET_SIZE ? key_ts_packet (data + offset)
+      : hash_bytes (FNV_OFFSET_BASIS, data + offset, unit);
+    SRTMergeEntry *entry = g_hash_table_lookup (priv->entries, &hash);
+    SRTMergeRecord *record;
+
+    if (entry == NULL) {
+      entry = g_new0 (SRTMergeEntry, 1);
+      entry->hash = hash;
+      g_hash_table_add (priv->entries, entry);
+    }
+
+    if (++entry->seen[path_index] <= entry->emitted) {
+      duplicates++;
+      continue;
+    }
+
+    if (priv->records_len == SRT_MERGE_MAX_PACKETS)
+      drop_oldest_record (priv);
+
+    record = &priv->records[(priv->records_head + priv->records_len)
+      % SRT_MERGE_MAX_PACKETS];
+    record->entry = entry;
+    record->time = now;
+    priv->records_len++;
+    entry->emitted++;
+    entry->refs++;
+
+    if (out != offset)
+      memmove (data + out, data + offset, unit);
+    out += unit;
+    unique++;
+  }
+
+  GST_OBJECT_LOCK (self);
+  priv->paths[path_index].unique += unique;
+  priv->paths[path_index].duplicates += duplicates;
+  GST_OBJECT_UNLOCK (self);
+
+  return out;
+}
+
+static void
+close_path (GstSRTMergeSrc * self, guint path_index)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  SRTMergePath *path = &priv->paths[path_index];
+
+  if (path->sock == SRT_INVALID_SOCK)
+    return;
+
+  if (priv->poll_id != SRT_ERROR)
+    srt_epoll_remove_usock (priv->poll_id, path->sock);
+
+  GST_OBJECT_LOCK (self);
+  srt_close (path->sock);
+  path->sock = SRT_INVALID_SOCK;
+  g_clear_object (&path->sockaddr);
+  GST_OBJECT_UNLOCK (self);
+}
+
+static GstFlowReturn
+gst_srt_merge_src_fill (GstPushSrc * src, GstBuffer * outbuf)
+{
+  GstSRTMergeSrc *self = GST_SRT_MERGE_SRC (src);
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (src);
+  GstMapInfo info;
+
+  while (TRUE) {
+    SRTSOCKET ready[N_PATHS];
+    int n_ready = N_PATHS;
+    int i;
+
+    if (priv->cancelled)
+      return GST_FLOW_FLUSHING;
+
+    if (srt_epoll_wait (priv->poll_id, ready, &n_ready, 0, 0,
+        SRT_MERGE_POLL_INTERVAL, 0, 0, 0, 0) == SRT_ERROR) {
+      if (srt_getlasterror (NULL) != SRT_ETIMEOUT) {
+        GST_ELEMENT_ERROR (src, RESOURCE, READ,
+          (NULL), ("srt_epoll_wait error: %s", srt_getlasterror_str ()));
+        srt_clearlasterror ();
+        return GST_FLOW_ERROR;
+      }
+      srt_clearlasterror ();
+      continue;
+    }
+
+    for (i = 0; i < MIN (n_ready, N_PATHS); i++) {
+      SRT_MSGCTRL ctrl = srt_msgctrl_default;
+      GstClockTime start;
+      guint path_index;
+      gint recv_len;
+      gsize len;
+
+      for (path_index = 0; path_index < N_PATHS; path_index++)
+        if (priv->paths[path_index].sock == ready[i])
+          break;
+      if (path_index == N_PATHS)
+        continue;
+
+      if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
+        GST_ELEMENT_ERROR (src, RESOURCE, READ,
+          ("Could not map the output stream"), (NULL));
+        return GST_FLOW_ERROR;
+      }
+
+      start = gst_srt_tracer_now ();
+      recv_len = srt_recvmsg2 (ready[i], (char *)info.data, (int)info.size,
+        &ctrl);
+      gst_srt_tracer_log_recv (GST_ELEMENT_CAST (self), start, recv_len);
+
+      if (recv_len <= 0) {
+        gst_buffer_unmap (outbuf, &info);
+        GST_ELEMENT_WARNING (self, RESOURCE, READ,
+          ("Lost SRT path %u", path_index),
+          ("srt_recvmsg error: %s", srt_getlasterror_str ()));
+        srt_clearlasterror ();
+        close_path (self, path_index);
+
+        if (priv->paths[0].sock == SRT_INVALID_SOCK
+            && priv->paths[1].sock == SRT_INVALID_SOCK) {
+          GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Lost both SRT paths"), (NULL));
+          return GST_FLOW_ERROR;
+        }
+        continue;
+      }
+
+      len = merge_message (self, path_index, info.data, recv_len);
+      gst_buffer_unmap (outbuf, &info);
+
+      if (len == 0)
+        continue;
+
+      GST_BUFFER_PTS (outbuf) =
+        gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
+        GST_ELEMENT_CAST (src)->base_time;
+
+      gst_buffer_resize (outbuf, 0, len);
+      gst_srt_base_src_record_latency (base, &ctrl);
+
+      GST_LOG_OBJECT (src, "filled buffer of size %" G_GSIZE_FORMAT
+        " from path %u", len, path_index);
+
+      return GST_FLOW_OK;
+    }
+  }
+}
+
+static SRTSOCKET
+connect_path (GstSRTMergeSrc * self, GstUri * uri, GSocketAddress ** sockaddr,
+  gint * poll_id)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (self);
+  gchar *peer = gst_srt_latency_host_name (gst_uri_get_host (uri));
+  /* Without probing, a path uses "latency" until it is known */
+  gint latency = gst_srt_base_src_get_latency_for_peer (base, peer);
+
+  g_free (peer);
+  if (latency < 0)
+    latency = base->latency;
+
+  return gst_srt_client_connect_full (GST_ELEMENT (self), FALSE,
+    gst_uri_get_host (uri), gst_uri_get_port (uri), FALSE, NULL, 0,
+    latency, sockaddr, poll_id, base->passphrase, base->key_length,
+    base->km_refresh_rate, base->km_preannounce, priv->streamid,
+    base->packet_filter, base->transtype, base->bitrate, base->profile,
+    base->srt_options);
+}
+
+static gboolean
+gst_srt_merge_src_start (GstBaseSrc * src)
+{
+  GstSRTMergeSrc *self = GST_SRT_MERGE_SRC (src);
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (src);
+  GstUri *secondary = NULL;
+  gint secondary_poll_id = SRT_ERROR;
+  GSocketAddress *sockaddr = NULL;
+  SRTSOCKET sock;
+
+  if (base->transtype != GST_SRT_TRANSTYPE_LIVE) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS,
+      ("Merging needs the live transmission type"), (NULL));
+    return FALSE;
+  }
+
+  if (priv->secondary_uri != NULL)
+    secondary = gst_uri_from_string (priv->secondary_uri);
+  if (secondary == NULL
+      || g_strcmp0 (gst_uri_get_scheme (secondary), SRT_URI_SCHEME) != 0) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS,
+      ("Invalid secondary SRT URI"), ("%s", GST_STR_NULL (priv->secondary_uri)));
+    goto failed;
+  }
+
+  sock = connect_path (self, base->uri, &sockaddr, &priv->poll_id);
+  if (sock == SRT_INVALID_SOCK)
+    goto failed;
+
+  /* foreach_socket may run from another thread */
+  GST_OBJECT_LOCK (self);
+  priv->paths[0].sock = sock;
+  priv->paths[0].sockaddr = sockaddr;
+  GST_OBJECT_UNLOCK (self);
+
+  /* Both paths are waited on with the poll of the first one */
+  sockaddr = NULL;
+  sock = connect_path (self, secondary, &sockaddr, &secondary_poll_id);
+  if (sock == SRT_INVALID_SOCK)
+    goto failed;
+  srt_epoll_remove_usock (secondary_poll_id, sock);
+  srt_epoll_release (secondary_poll_id);
+  srt_epoll_add_usock (priv->poll_id, sock,
+    &(int) { SRT_EPOLL_IN | SRT_EPOLL_ERR });
+
+  GST_OBJECT_LOCK (self);
+  priv->paths[1].sock = sock;
+  priv->paths[1].sockaddr = sockaddr;
+  GST_OBJECT_UNLOCK (self);
+  gst_srt_base_src_set_effective_latency (base, priv->paths[0].sock);
+
+  gst_srt_merge_src_clear_entries (self);
+  priv->paths[0].unique = priv->paths[0].duplicates = 0;
+  priv->paths[1].unique = priv->paths[1].duplicates = 0;
+
+  GST_INFO_OBJECT (self, "SRT merge src connected to both paths");
+  gst_uri_unref (secondary);
+
+  return TRUE;
+
+failed:
+  close_path (self, 0);
+  if (priv->poll_id != SRT_ERROR) {
+    srt_epoll_release (priv->poll_id);
+    priv->poll_id = SRT_ERROR;
+  }
+  g_clear_pointer (&secondary, gst_uri_unref);
+
+  return FALSE;
+}
+
+static gboolean
+gst_srt_merge_src_stop (GstBaseSrc * src)
+{
+  GstSRTMergeSrc *self = GST_SRT_MERGE_SRC (src);
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+
+  GST_DEBUG_OBJECT (self, "closing SRT connections");
+
+  close_path (self, 0);
+  close_path (self, 1);
+
+  if (priv->poll_id != SRT_ERROR) {
+    srt_epoll_release (priv->poll_id);
+    priv->poll_id = SRT_ERROR;
+  }
+
+  gst_srt_merge_src_clear_entries (self);
+
+  return TRUE;
+}
+
+static gboolean
+gst_srt_merge_src_unlock (GstBaseSrc * src)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (src);
+
+  priv->cancelled = TRUE;
+
+  return GST_BASE_SRC_CLASS (parent_class)->unlock (src);
+}
+
+static gboolean
+gst_srt_merge_src_unlock_stop (GstBaseSrc * src)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (src);
+
+  priv->cancelled = FALSE;
+
+  return GST_BASE_SRC_CLASS (parent_class)->unlock_stop (src);
+}
+
+static void
+gst_srt_merge_src_foreach_socket (GstSRTBaseSrc * src,
+  GstSRTSocketFunc func, gpointer user_data)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (src);
+  guint i;
+
+  /* close_path clears the paths under the lock */
+  GST_OBJECT_LOCK (src);
+  for (i = 0; i < N_PATHS; i++)
+    if (priv->paths[i].sock != SRT_INVALID_SOCK)
+      func (GST_ELEMENT_CAST (src), priv->paths[i].sock,
+        priv->paths[i].sockaddr, user_data);
+  GST_OBJECT_UNLOCK (src);
+}
+
+static void
+gst_srt_merge_src_class_init (GstSRTMergeSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
+  GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
+
+  gobject_class->set_property = gst_srt_merge_src_set_property;
+  gobject_class->get_property = gst_srt_merge_src_get_property;
+  gobject_class->finalize = gst_srt_merge_src_finalize;
+
+  /**
+    * GstSRTMergeSrc:secondary-uri:
+    *
+    * The SRT server of the second path, #GstSRTBaseSrc:uri being the first.
+    * Both paths share all the other settings.
+    */
+  properties[PROP_SECONDARY_URI] =
+    g_param_spec_string ("secondary-uri", "Secondary URI",
+      "URI of the second path in the form of srt://address:port", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTMergeSrc:merge-window:
+    *
+    * How long, in milliseconds, an output packet is remembered to drop its
+    * copy from the other path. It must exceed the delay between the paths.
+    */
+  properties[PROP_MERGE_WINDOW] =
+    g_param_spec_int ("merge-window", "Merge Window",
+      "Time in ms packets are remembered to drop their duplicates", 1,
+      G_MAXINT32, SRT_DEFAULT_MERGE_WINDOW,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTMergeSrc:streamid:
+    *
+    * Stream ID sent to the servers of both paths when connecting
+    * (SRTO_STREAMID), up to 512 characters.
+    */
+  properties[PROP_STREAMID] =
+    g_param_spec_string ("streamid", "Stream ID",
+      "Stream ID sent to the servers when connecting", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+#if GST_VERSION_MINOR >= 14
+  properties[PROP_STATS] = g_param_spec_boxed ("stats", "Statistics",
+    "SRT Statistics", GST_TYPE_STRUCTURE,
+    G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+#endif
+
+  g_object_class_install_properties (gobject_class, PROP_LAST, properties);
+
+  gst_element_class_add_static_pad_template (gstelement_class, &src_template);
+  gst_element_class_set_metadata (gstelement_class,
+    "SRT merge source", "Source/Network",
+    "Receive the same stream over two SRT paths and merge them",
+    "Justin Kim <justin.kim@collabora.com>");
+
+  gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_srt_merge_src_start);
+  gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_srt_merge_src_stop);
+  gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_srt_merge_src_unlock);
+  gstbasesrc_class->unlock_stop =
+    GST_DEBUG_FUNCPTR (gst_srt_merge_src_unlock_stop);
+  gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_merge_src_fill);
+
+  gstsrtbasesrc_class->foreach_socket =
+    GST_DEBUG_FUNCPTR (gst_srt_merge_src_foreach_socket);
+}
+
+static void
+gst_srt_merge_src_init (GstSRTMergeSrc * self)
+{
+  GstSRTMergeSrcPrivate *priv = GST_SRT_MERGE_SRC_GET_PRIVATE (self);
+  guint i;
+
+  for (i = 0; i < N_PATHS; i++)
+    priv->paths[i].sock = SRT_INVALID_SOCK;
+  priv->poll_id = SRT_ERROR;
+  priv->merge_window = SRT_DEFAULT_MERGE_WINDOW;
+  priv->entries = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+    NULL, g_free);
+  priv->records = g_new (SRTMergeRecord, SRT_MERGE_MAX_PACKETS);
+}
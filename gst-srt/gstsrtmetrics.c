@@ -0,0 +1,563 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+ /**
+ * SECTION:srtmetrics
+ * @title: SRT metrics exporter
+ *
+ * Exports the statistics of every running SRT element in the OpenMetrics
+ * text format, so they can be scraped by Prometheus without any
+ * application code. The exporter is disabled unless one of these
+ * environment variables is set when the first element starts:
+ *
+ * GST_SRT_METRICS_ADDRESS: serve the metrics over HTTP on "[host]:port",
+ * the host defaults to 127.0.0.1.
+ *
+ * GST_SRT_METRICS_FILE: atomically rewrite the metrics to this file every
+ * GST_SRT_METRICS_INTERVAL milliseconds (10000 by default), e.g. for the
+ * node_exporter textfile collector.
+ *
+ * Every sample is labelled with the element name and, when known, the
+ * peer address so that each srtserversink client gets its own series.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtmetrics.h"
+#include "gstsrtbasesink.h"
+#include "gstsrtbasesrc.h"
+#include "gstsrt.h"
+
+#include <gio/gio.h>
+#include <stdlib.h>
+
+#define GST_CAT_DEFAULT gst_debug_srt_metrics
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define SRT_METRICS_PREFIX "gst_srt_"
+#define SRT_METRICS_CONTENT_TYPE \
+  "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+typedef struct
+{
+  const gchar *field;
+  gboolean counter;
+  const gchar *help;
+} SRTMetricInfo;
+
+/* Fields of the stats structures that only ever grow, everything else
+ * numeric is exported as a gauge */
+static const SRTMetricInfo metric_info[] = {
+  {"packets-sent", TRUE, "Sent data packets, including retransmissions"},
+  {"packets-sent-lost", TRUE, "Packets reported lost by the receiver"},
+  {"packets-sent-dropped", TRUE, "Packets dropped as too late to send"},
+  {"packets-recv", TRUE, "Received data packets"},
+  {"packets-recv-lost", TRUE, "Packets detected as lost by the receiver"},
+  {"packets-recv-dropped", TRUE, "Packets dropped as too late to play"},
+  {"packets-retransmitted", TRUE, "Retransmitted packets"},
+  {"packet-ack-received", TRUE, "Received ACK packets"},
+  {"packet-nack-received", TRUE, "Received NAK packets"},
+  {"bytes-sent", TRUE, "Sent data bytes, including retransmissions"},
+  {"bytes-sent-dropped", TRUE, "Bytes dropped as too late to send"},
+  {"bytes-received", TRUE, "Received data bytes"},
+  {"bytes-recv-dropped", TRUE, "Bytes dropped as too late to play"},
+  {"bytes-retransmitted", TRUE, "Retransmitted bytes"},
+  {"packets-filter-extra", TRUE, "Control packets of the packet filter (FEC)"},
+  {"packets-filter-supply", TRUE, "Packets rebuilt by the packet filter"},
+  {"packets-filter-loss", TRUE, "Packets the packet filter failed to rebuild"},
+  {"send-duration-us", TRUE, "Time spent sending, idle time exclusive"},
+  {"send-rate-mbps", FALSE, "Sending rate in Mb/s"},
+  {"recv-rate-mbps", FALSE, "Receiving rate in Mb/s"},
+  {"bandwidth-mbps", FALSE, "Estimated link bandwidth in Mb/s"},
+  {"rtt-ms", FALSE, "Round trip time in milliseconds"},
+  {"flow-window-packets", FALSE, "Flow control window in packets"},
+  {"send-buffer-bytes", FALSE, "SRT send buffer size"},
+  {"recv-buffer-bytes", FALSE, "SRT receive buffer size"},
+  {"udp-send-buffer-bytes", FALSE, "UDP send buffer size"},
+  {"udp-recv-buffer-bytes", FALSE, "UDP receive buffer size"},
+  {"ts-packets", TRUE, "Received MPEG-TS packets"},
+  {"ts-pids", FALSE, "PIDs seen in the received MPEG-TS"},
+  {"ts-sync-errors", TRUE, "Losses of the MPEG-TS packet alignment"},
+  {"ts-cc-errors", TRUE, "MPEG-TS continuity counter errors"},
+  {"ts-lost-packets", TRUE, "MPEG-TS packets missing from the counters"},
+  {"ts-duplicate-packets", TRUE, "Duplicated MPEG-TS packets"},
+  {"ts-transport-errors", TRUE, "MPEG-TS packets with the error indicator"},
+  {NULL, FALSE, NULL}
+};
+
+typedef struct
+{
+  gchar *labels;
+  GstStructure *stats;
+} SRTMetricSample;
+
+static GMutex elements_lock;
+static GList *elements;
+static gboolean exporter_enabled;
+
+static void
+srt_metric_sample_free (SRTMetricSample * sample)
+{
+  g_free (sample->labels);
+  gst_structure_free (sample->stats);
+  g_free (sample);
+}
+
+static gchar *
+escape_label (const gchar * value)
+{
+  GString *str = g_string_sized_new (strlen (value));
+
+  for (; *value; value++) {
+    if (*value == '\\' || *value == '"')
+      g_string_append_c (str, '\\');
+    if (*value == '\n')
+      g_string_append (str, "\\n");
+    else
+      g_string_append_c (str, *value);
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+add_sample (GPtrArray * samples, GstElement * elem, const gchar * direction,
+  GstStructure * stats)
+{
+  SRTMetricSample *sample = g_new0 (SRTMetricSample, 1);
+  gchar *name = gst_element_get_name (elem);
+  gchar *elem_label = escape_label (name);
+  const gchar *peer = gst_structure_get_string (stats, "sockaddr-str");
+
+  if (peer != NULL) {
+    gchar *peer_label = escape_label (peer);
+    sample->labels = g_strdup_printf ("element=\"%s\",direction=\"%s\","
+      "peer=\"%s\"", elem_label, direction, peer_label);
+    g_free (peer_label);
+  }
+  else {
+    sample->labels = g_strdup_printf ("element=\"%s\",direction=\"%s\"",
+      elem_label, direction);
+  }
+  sample->stats = stats;
+  g_ptr_array_add (samples, sample);
+
+  g_free (elem_label);
+  g_free (name);
+}
+
+/* GstSRTSocketFunc, called with the object lock of the element held so
+ * only the socket statistics are read here */
+static void
+collect_sender (GstElement * elem, SRTSOCKET sock,
+  GSocketAddress * sockaddr, gpointer user_data)
+{
+  g_ptr_array_add (user_data, gst_srt_base_sink_get_stats (sockaddr, sock));
+}
+
+static void
+collect_receiver (GstElement * elem, SRTSOCKET sock,
+  GSocketAddress * sockaddr, gpointer user_data)
+{
+  GstStructure *stats = gst_srt_base_src_get_stats (sock);
+  GValue v = G_VALUE_INIT;
+
+  if (sockaddr != NULL) {
+    g_value_init (&v, G_TYPE_STRING);
+    g_value_take_string (&v,
+      g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (sockaddr)));
+    gst_structure_take_value (stats, "sockaddr-str", &v);
+  }
+
+  g_ptr_array_add (user_data, stats);
+}
+
+static void
+collect_element (GstElement * elem, GPtrArray * samples)
+{
+  GPtrArray *stats = g_ptr_array_new ();
+  const gchar *direction = NULL;
+  guint i;
+
+  if (GST_IS_SRT_BASE_SINK (elem)) {
+    GstSRTBaseSinkClass *klass = GST_SRT_BASE_SINK_GET_CLASS (elem);
+
+    direction = "send";
+    if (klass->foreach_socket)
+      klass->foreach_socket (GST_SRT_BASE_SINK (elem), collect_sender, stats);
+  }
+  else if (GST_IS_SRT_BASE_SRC (elem)) {
+    GstSRTBaseSrcClass *klass = GST_SRT_BASE_SRC_GET_CLASS (elem);
+
+    direction = "recv";
+    if (klass->foreach_socket)
+      klass->foreach_socket (GST_SRT_BASE_SRC (elem), collect_receiver,
+        stats);
+
+    for (i = 0; i < stats->len; i++) {
+      gst_srt_base_src_add_latency_stats (GST_SRT_BASE_SRC (elem),
+        g_ptr_array_index (stats, i));
+      gst_srt_base_src_add_ts_stats (GST_SRT_BASE_SRC (elem),
+        g_ptr_array_index (stats, i));
+    }
+  }
+
+  for (i = 0; i < stats->len; i++)
+    add_sample (samples, elem, direction, g_ptr_array_index (stats, i));
+  g_ptr_array_free (stats, TRUE);
+}
+
+static const SRTMetricInfo *
+lookup_metric_info (const gchar * field)
+{
+  const SRTMetricInfo *info;
+
+  for (info = metric_info; info->field; info++) {
+    if (g_str_equal (info->field, field))
+      return info;
+  }
+
+  return NULL;
+}
+
+static gboolean
+value_to_string (const GValue * value, gchar * buf, gsize len)
+{
+  switch (G_VALUE_TYPE (value)) {
+  case G_TYPE_INT:
+    g_snprintf (buf, len, "%d", g_value_get_int (value));
+    return TRUE;
+  case G_TYPE_UINT:
+    g_snprintf (buf, len, "%u", g_value_get_uint (value));
+    return TRUE;
+  case G_TYPE_INT64:
+    g_snprintf (buf, len, "%" G_GINT64_FORMAT, g_value_get_int64 (value));
+    return TRUE;
+  case G_TYPE_UINT64:
+    g_snprintf (buf, len, "%" G_GUINT64_FORMAT, g_value_get_uint64 (value));
+    return TRUE;
+  case G_TYPE_DOUBLE:
+    g_ascii_dtostr (buf, len, g_value_get_double (value));
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+static gboolean
+collect_field_name (GQuark field_id, const GValue * value, gpointer user_data)
+{
+  GPtrArray *fields = user_data;
+  const gchar *field = g_quark_to_string (field_id);
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+  guint i;
+
+  if (!value_to_string (value, buf, sizeof (buf)))
+    return TRUE;
+
+  for (i = 0; i < fields->len; i++) {
+    if (g_str_equal (g_ptr_array_index (fields, i), field))
+      return TRUE;
+  }
+  g_ptr_array_add (fields, (gpointer)field);
+
+  return TRUE;
+}
+
+static void
+render_family (GString * out, const gchar * field, GPtrArray * samples)
+{
+  const SRTMetricInfo *info = lookup_metric_info (field);
+  gboolean counter = info ? info->counter : FALSE;
+  gchar *name = g_strdelimit (g_strconcat (SRT_METRICS_PREFIX, field, NULL),
+    "-", '_');
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+  guint i;
+
+  g_string_append_printf (out, "# TYPE %s %s\n", name,
+    counter ? "counter" : "gauge");
+  if (info)
+    g_string_append_printf (out, "# HELP %s %s.\n", name, info->help);
+
+  for (i = 0; i < samples->len; i++) {
+    SRTMetricSample *sample = g_ptr_array_index (samples, i);
+    const GValue *value = gst_structure_get_value (sample->stats, field);
+
+    if (value == NULL || !value_to_string (value, buf, sizeof (buf)))
+      continue;
+
+    g_string_append_printf (out, "%s%s{%s} %s\n", name,
+      counter ? "_total" : "", sample->labels, buf);
+  }
+
+  g_free (name);
+}
+
+/**
+ * gst_srt_metrics_render:
+ *
+ * Returns: (transfer full): the statistics of all the registered elements
+ * in the OpenMetrics text format.
+ */
+gchar *
+gst_srt_metrics_render (void)
+{
+  GString *out = g_string_new (NULL);
+  GPtrArray *samples =
+    g_ptr_array_new_with_free_func ((GDestroyNotify)srt_metric_sample_free);
+  GPtrArray *fields = g_ptr_array_new ();
+  GList *snapshot, *item;
+  guint i;
+
+  g_mutex_lock (&elements_lock);
+  snapshot = g_list_copy_deep (elements, (GCopyFunc)gst_object_ref, NULL);
+  g_mutex_unlock (&elements_lock);
+
+  g_string_append_printf (out, "# TYPE " SRT_METRICS_PREFIX "connections "
+    "gauge\n# HELP " SRT_METRICS_PREFIX "connections Connected SRT sockets.\n");
+
+  for (item = snapshot; item; item = item->next) {
+    GstElement *elem = item->data;
+    guint before = samples->len;
+    gchar *name = gst_element_get_name (elem);
+    gchar *label = escape_label (name);
+
+    collect_element (elem, samples);
+    g_string_append_printf (out, SRT_METRICS_PREFIX "connections"
+      "{element=\"%s\"} %u\n", label, samples->len - before);
+
+    g_free (label);
+    g_free (name);
+  }
+  g_list_free_full (snapshot, gst_object_unref);
+
+  for (i = 0; i < samples->len; i++) {
+    SRTMetricSample *sample = g_ptr_array_index (samples, i);
+    gst_structure_foreach (sample->stats, collect_field_name, fields);
+  }
+
+  for (i = 0; i < fields->len; i++)
+    render_family (out, g_ptr_array_index (fields, i), samples);
+
+  g_string_append (out, "# EOF\n");
+
+  g_ptr_array_unref (fields);
+  g_ptr_array_unref (samples);
+
+  return g_string_free (out, FALSE);
+}
+
+static gpointer
+http_thread_func (gpointer data)
+{
+  GSocket *listener = data;
+
+  while (TRUE) {
+    GError *error = NULL;
+    GSocket *client;
+    gchar request[4096];
+    gchar *body, *response;
+    gsize len, sent = 0;
+
+    client = g_socket_accept (listener, NULL, &error);
+    if (client == NULL) {
+      GST_WARNING ("Failed to accept metrics client: %s", error->message);
+      g_clear_error (&error);
+      continue;
+    }
+
+    /* Whatever the request is, the answer is the metrics. Only read it so
+     * that the client doesn't see a reset connection */
+    g_socket_set_timeout (client, 5);
+    g_socket_receive (client, request, sizeof (request), NULL, NULL);
+
+    body = gst_srt_metrics_render ();
+    response = g_strdup_printf ("HTTP/1.0 200 OK\r\n"
+      "Content-Type: " SRT_METRICS_CONTENT_TYPE "\r\n"
+      "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+      "Connection: close\r\n\r\n%s", strlen (body), body);
+
+    len = strlen (response);
+    while (sent < len) {
+      gssize ret = g_socket_send (client, response + sent, len - sent, NULL,
+        &error);
+
+      if (ret < 0) {
+        GST_DEBUG ("Failed to send metrics: %s", error->message);
+        g_clear_error (&error);
+        break;
+      }
+      sent += ret;
+    }
+
+    g_socket_close (client, NULL);
+    g_object_unref (client);
+    g_free (response);
+    g_free (body);
+  }
+
+  return NULL;
+}
+
+static gboolean
+start_http_exporter (const gchar * address)
+{
+  GError *error = NULL;
+  GSocketAddress *sockaddr = NULL;
+  GSocket *listener = NULL;
+  GInetAddress *inet;
+  const gchar *colon = strrchr (address, ':');
+  gchar *host, *end = NULL;
+  guint64 port = 0;
+
+  if (colon != NULL)
+    port = g_ascii_strtoull (colon + 1, &end, 10);
+
+  if (colon == NULL || end == colon + 1 || *end != '\0' || port == 0
+    || port > G_MAXUINT16) {
+    GST_ERROR ("Invalid " SRT_METRICS_ADDRESS_ENV " '%s'", address);
+    return FALSE;
+  }
+
+  host = colon == address ? g_strdup (SRT_DEFAULT_METRICS_HOST) :
+    g_strndup (address, colon - address);
+  inet = g_inet_address_new_from_string (host);
+  if (inet == NULL) {
+    GST_ERROR ("Invalid metrics host '%s'", host);
+    g_free (host);
+    return FALSE;
+  }
+  sockaddr = g_inet_socket_address_new (inet, (guint16)port);
+  g_object_unref (inet);
+
+  listener = g_socket_new (g_socket_address_get_family (sockaddr),
+    G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, &error);
+  if (listener == NULL)
+    goto failed;
+
+  if (!g_socket_bind (listener, sockaddr, TRUE, &error) ||
+    !g_socket_listen (listener, &error))
+    goto failed;
+
+  g_thread_unref (g_thread_new ("srtmetrics", http_thread_func, listener));
+  GST_INFO ("Serving SRT metrics on http://%s:%u/metrics", host,
+    (guint)port);
+
+  g_object_unref (sockaddr);
+  g_free (host);
+  return TRUE;
+
+failed:
+  GST_ERROR ("Failed to serve metrics on %s: %s", address, error->message);
+  g_clear_error (&error);
+  g_clear_object (&listener);
+  g_clear_object (&sockaddr);
+  g_free (host);
+  return FALSE;
+}
+
+static gpointer
+file_thread_func (gpointer data)
+{
+  const gchar *location = data;
+  const gchar *interval_str = g_getenv (SRT_METRICS_INTERVAL_ENV);
+  gulong interval = SRT_DEFAULT_METRICS_INTERVAL;
+
+  if (interval_str != NULL && atoi (interval_str) > 0)
+    interval = atoi (interval_str);
+
+  while (TRUE) {
+    GError *error = NULL;
+    gchar *body = gst_srt_metrics_render ();
+
+    /* g_file_set_contents() writes a temporary file and renames it, so a
+     * scraper never reads a half written file */
+    if (!g_file_set_contents (location, body, -1, &error)) {
+      GST_WARNING ("Failed to write metrics to %s: %s", location,
+        error->message);
+      g_clear_error (&error);
+    }
+    g_free (body);
+
+    g_usleep (interval * 1000);
+  }
+
+  return NULL;
+}
+
+static gpointer
+start_exporter (gpointer data)
+{
+  const gchar *address = g_getenv (SRT_METRICS_ADDRESS_ENV);
+  const gchar *location = g_getenv (SRT_METRICS_FILE_ENV);
+
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "srtmetrics", 0,
+    "SRT Metrics Exporter");
+
+  if (address != NULL && address[0] != '\0' && start_http_exporter (address))
+    exporter_enabled = TRUE;
+
+  if (location != NULL && location[0] != '\0') {
+    g_thread_unref (g_thread_new ("srtmetricsfile", file_thread_func,
+      g_strdup (location)));
+    GST_INFO ("Writing SRT metrics to %s", location);
+    exporter_enabled = TRUE;
+  }
+
+  return NULL;
+}
+
+/**
+ * gst_srt_metrics_register:
+ * @elem: a #GstSRTBaseSink or #GstSRTBaseSrc
+ *
+ * Adds @elem to the exported elements, starting the exporter on the first
+ * call if it is configured. Does nothing if the exporter is disabled.
+ */
+void
+gst_srt_metrics_register (GstElement * elem)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, start_exporter, NULL);
+
+  if (!exporter_enabled)
+    return;
+
+  g_mutex_lock (&elements_lock);
+  if (g_list_find (elements, elem) == NULL)
+    elements = g_list_prepend (elements, gst_object_ref (elem));
+  g_mutex_unlock (&elements_lock);
+}
+
+void
+gst_srt_metrics_unregister (GstElement * elem)
+{
+  GList *item;
+
+  g_mutex_lock (&elements_lock);
+  item = g_list_find (elements, elem);
+  if (item != NULL)
+    elements = g_list_delete_link (elements, item);
+  g_mutex_unlock (&elements_lock);
+
+  if (item != NULL)
+    gst_object_unref (elem);
+}
@@ -0,0 +1,43 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_METRICS_H__
+#define __GST_SRT_METRICS_H__
+
+#include <gst/gst.h>
+
+/* Serve the OpenMetrics text over HTTP on this "[host]:port" */
+#define SRT_METRICS_ADDRESS_ENV "GST_SRT_METRICS_ADDRESS"
+/* Periodically rewrite the OpenMetrics text to this file */
+#define SRT_METRICS_FILE_ENV "GST_SRT_METRICS_FILE"
+/* Rewrite interval of the metrics file, in milliseconds */
+#define SRT_METRICS_INTERVAL_ENV "GST_SRT_METRICS_INTERVAL"
+#define SRT_DEFAULT_METRICS_INTERVAL 10000
+#define SRT_DEFAULT_METRICS_HOST "127.0.0.1"
+
+G_BEGIN_DECLS
+
+void gst_srt_metrics_register (GstElement * elem);
+
+void gst_srt_metrics_unregister (GstElement * elem);
+
+gchar * gst_srt_metrics_render (void);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_METRICS_H__ */
@@ -0,0 +1,389 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+ /**
+ * SECTION:srtreactor
+ * @title: SRT runtime and reactor
+ *
+ * The libsrt runtime is shared by all the elements of the process: the
+ * first element starts it and the last one cleans it up, instead of every
+ * element restarting it.
+ *
+ * The reactor is a small pool of threads, sized from the number of cores,
+ * that wait on the sockets no streaming thread waits on, such as the
+ * listener of srtserversink, and call back the element owning a socket
+ * when it becomes ready. Each socket is handed to the least busy thread,
+ * so the number of polling threads no longer grows with the number of
+ * elements. The sources keep waiting on their sockets from their
+ * streaming thread, which they run anyway, so handing the wait to the
+ * reactor would only add a thread switch per message.
+ *
+ * The reactor threads can be pinned and prioritized with the
+ * GST_SRT_REACTOR_CPUS (CPU list such as "0-3,8"), GST_SRT_REACTOR_NUMA_NODE,
+ * GST_SRT_REACTOR_NICE and GST_SRT_REACTOR_RT_PRIORITY environment
+ * variables, read when the first element starts the runtime.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtreactor.h"
+#include "gstsrtthread.h"
+
+#include <stdlib.h>
+
+#define GST_CAT_DEFAULT gst_debug_srt_reactor
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+typedef struct
+{
+  GstSRTReactorFunc func;
+  gpointer user_data;
+} ReactorWatch;
+
+typedef struct
+{
+  GThread *thread;
+  guint index;
+  int eid;
+  gint quit;
+
+  /* Held while dispatching, so removing a socket waits for its callback */
+  GRecMutex lock;
+  /* SRTSOCKET -> ReactorWatch, protected by lock */
+  GHashTable *watches;
+  /* size of watches, atomic so that picking a loop doesn't need the lock */
+  gint n_watches;
+} ReactorLoop;
+
+/* Protects everything below */
+static GMutex runtime_lock;
+static guint runtime_refcount;
+static ReactorLoop *loops;
+static guint n_loops;
+/* SRTSOCKET -> ReactorLoop watching it */
+static GHashTable *sockets;
+/* Read from the environment when the threads are started */
+static GstSRTThreadConfig thread_config;
+
+static void
+reactor_dispatch (ReactorLoop * loop, SRTSOCKET * fds, int n_fds, int events)
+{
+  int i;
+
+  for (i = 0; i < n_fds; i++) {
+    ReactorWatch *watch = g_hash_table_lookup (loop->watches,
+      GINT_TO_POINTER (fds[i]));
+
+    /* Removed since the wait returned */
+    if (watch != NULL)
+      watch->func (fds[i], events, watch->user_data);
+  }
+}
+
+static gpointer
+reactor_thread_func (gpointer data)
+{
+  ReactorLoop *loop = data;
+  SRTSOCKET *rfds, *wfds;
+  guint size = 0;
+
+  rfds = wfds = NULL;
+
+  if (!gst_srt_thread_config_is_default (&thread_config)) {
+    GError *error = NULL;
+
+    if (!gst_srt_thread_apply (&thread_config, &error)) {
+      GST_WARNING ("failed to configure reactor thread %u: %s", loop->index,
+        error->message);
+      g_clear_error (&error);
+    }
+  }
+
+  while (!g_atomic_int_get (&loop->quit)) {
+    int rnum, wnum;
+    guint n_watches;
+
+    g_rec_mutex_lock (&loop->lock);
+    n_watches = g_hash_table_size (loop->watches);
+    g_rec_mutex_unlock (&loop->lock);
+
+    /* srt_epoll_wait() fails right away without any socket */
+    if (n_watches == 0) {
+      g_usleep (SRT_REACTOR_TIMEOUT * 1000);
+      continue;
+    }
+
+    if (n_watches > size) {
+      size = n_watches;
+      rfds = g_renew (SRTSOCKET, rfds, size);
+      wfds = g_renew (SRTSOCKET, wfds, size);
+    }
+
+    rnum = wnum = (int)size;
+    if (srt_epoll_wait (loop->eid, rfds, &rnum, wfds, &wnum,
+        SRT_REACTOR_TIMEOUT, 0, 0, 0, 0) == SRT_ERROR) {
+      if (srt_getlasterror (NULL) != SRT_ETIMEOUT)
+        GST_WARNING ("srt_epoll_wait failed: %s", srt_getlasterror_str ());
+      srt_clearlasterror ();
+      continue;
+    }
+
+    g_rec_mutex_lock (&loop->lock);
+    reactor_dispatch (loop, rfds, MIN (rnum, (int)size), SRT_EPOLL_IN);
+    reactor_dispatch (loop, wfds, MIN (wnum, (int)size), SRT_EPOLL_OUT);
+    g_rec_mutex_unlock (&loop->lock);
+  }
+
+  g_free (rfds);
+  g_free (wfds);
+
+  return NULL;
+}
+
+static gint
+env_get_int (const gchar * name, gint default_value)
+{
+  const gchar *value = g_getenv (name);
+
+  return value ? atoi (value) : default_value;
+}
+
+/* Called with runtime_lock */
+static gboolean
+reactor_start (void)
+{
+  guint i;
+
+  gst_srt_thread_config_clear (&thread_config);
+  gst_srt_thread_config_init (&thread_config);
+  thread_config.cpus = g_strdup (g_getenv (SRT_REACTOR_CPUS_ENV));
+  thread_config.numa_node = env_get_int (SRT_REACTOR_NUMA_NODE_ENV,
+    SRT_DEFAULT_NUMA_NODE);
+  thread_config.nice = env_get_int (SRT_REACTOR_NICE_ENV,
+    SRT_DEFAULT_THREAD_NICE);
+  thread_config.rt_priority = env_get_int (SRT_REACTOR_RT_PRIORITY_ENV,
+    SRT_DEFAULT_THREAD_RT_PRIORITY);
+
+  n_loops = CLAMP (g_get_num_processors () / 2, 1, SRT_REACTOR_MAX_THREADS);
+  loops = g_new0 (ReactorLoop, n_loops);
+  sockets = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < n_loops; i++) {
+    g_rec_mutex_init (&loops[i].lock);
+    loops[i].watches = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    loops[i].index = i;
+    loops[i].eid = SRT_ERROR;
+  }
+
+  for (i = 0; i < n_loops; i++) {
+    ReactorLoop *loop = &loops[i];
+    GError *error = NULL;
+    gchar *name;
+
+    loop->eid = srt_epoll_create ();
+    if (loop->eid == SRT_ERROR) {
+      GST_ERROR ("failed to create poll id (reason: %s)",
+        srt_getlasterror_str ());
+      return FALSE;
+    }
+
+    name = g_strdup_printf ("srtreactor%u", i);
+    loop->thread = g_thread_try_new (name, reactor_thread_func, loop, &error);
+    g_free (name);
+    if (loop->thread == NULL) {
+      GST_ERROR ("failed to create thread (reason: %s)", error->message);
+      g_clear_error (&error);
+      return FALSE;
+    }
+  }
+
+  GST_INFO ("Started %u reactor threads", n_loops);
+
+  return TRUE;
+}
+
+/* Called with runtime_lock */
+static void
+reactor_stop (void)
+{
+  guint i;
+
+  for (i = 0; i < n_loops; i++)
+    g_atomic_int_set (&loops[i].quit, 1);
+
+  for (i = 0; i < n_loops; i++) {
+    ReactorLoop *loop = &loops[i];
+
+    if (loop->thread)
+      g_thread_join (loop->thread);
+    if (loop->eid != SRT_ERROR)
+      srt_epoll_release (loop->eid);
+    g_hash_table_unref (loop->watches);
+    g_rec_mutex_clear (&loop->lock);
+  }
+
+  g_clear_pointer (&loops, g_free);
+  g_clear_pointer (&sockets, g_hash_table_unref);
+  n_loops = 0;
+}
+
+/**
+ * gst_srt_runtime_ref:
+ *
+ * Starts the libsrt runtime if this is the first reference. Every element
+ * holds one for its whole lifetime.
+ */
+void
+gst_srt_runtime_ref (void)
+{
+  static gsize debug_init = 0;
+
+  if (g_once_init_enter (&debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "srtreactor", 0,
+      "SRT runtime and reactor");
+    g_once_init_leave (&debug_init, 1);
+  }
+
+  g_mutex_lock (&runtime_lock);
+  if (runtime_refcount++ == 0) {
+    GST_INFO ("SRT startup");
+    srt_startup ();
+  }
+  g_mutex_unlock (&runtime_lock);
+}
+
+/**
+ * gst_srt_runtime_unref:
+ *
+ * Stops the reactor and cleans up the libsrt runtime when the last
+ * reference is dropped.
+ */
+void
+gst_srt_runtime_unref (void)
+{
+  g_mutex_lock (&runtime_lock);
+  g_assert (runtime_refcount > 0);
+  if (--runtime_refcount == 0) {
+    if (loops != NULL)
+      reactor_stop ();
+    GST_INFO ("SRT cleanup");
+    srt_cleanup ();
+  }
+  g_mutex_unlock (&runtime_lock);
+}
+
+/**
+ * gst_srt_reactor_add:
+ * @sock: the socket to watch
+ * @events: SRT_EPOLL_IN and/or SRT_EPOLL_OUT, plus SRT_EPOLL_ERR
+ * @func: called from a reactor thread when @sock is ready
+ * @user_data: passed to @func
+ *
+ * Watches @sock until gst_srt_reactor_remove() is called for it. The
+ * caller must hold a runtime reference.
+ *
+ * Returns: %FALSE if the socket could not be added
+ */
+gboolean
+gst_srt_reactor_add (SRTSOCKET sock, int events, GstSRTReactorFunc func,
+  gpointer user_data)
+{
+  ReactorLoop *loop = NULL;
+  ReactorWatch *watch;
+  guint i, least = G_MAXUINT;
+
+  g_mutex_lock (&runtime_lock);
+  if (runtime_refcount == 0) {
+    g_mutex_unlock (&runtime_lock);
+    g_critical ("gst_srt_reactor_add() without a runtime reference");
+    return FALSE;
+  }
+
+  if (loops == NULL && !reactor_start ()) {
+    reactor_stop ();
+    g_mutex_unlock (&runtime_lock);
+    return FALSE;
+  }
+
+  /* The loop with the fewest sockets, the counts are only a hint */
+  for (i = 0; i < n_loops; i++) {
+    guint n_watches = (guint)g_atomic_int_get (&loops[i].n_watches);
+
+    if (n_watches < least) {
+      least = n_watches;
+      loop = &loops[i];
+    }
+  }
+  g_hash_table_insert (sockets, GINT_TO_POINTER (sock), loop);
+  g_mutex_unlock (&runtime_lock);
+
+  watch = g_new0 (ReactorWatch, 1);
+  watch->func = func;
+  watch->user_data = user_data;
+
+  g_rec_mutex_lock (&loop->lock);
+  g_hash_table_insert (loop->watches, GINT_TO_POINTER (sock), watch);
+  if (srt_epoll_add_usock (loop->eid, sock, &events) == SRT_ERROR) {
+    GST_WARNING ("failed to watch socket %d (reason: %s)", sock,
+      srt_getlasterror_str ());
+    g_hash_table_remove (loop->watches, GINT_TO_POINTER (sock));
+    g_rec_mutex_unlock (&loop->lock);
+
+    g_mutex_lock (&runtime_lock);
+    g_hash_table_remove (sockets, GINT_TO_POINTER (sock));
+    g_mutex_unlock (&runtime_lock);
+    return FALSE;
+  }
+  g_atomic_int_inc (&loop->n_watches);
+  g_rec_mutex_unlock (&loop->lock);
+
+  return TRUE;
+}
+
+/**
+ * gst_srt_reactor_remove:
+ * @sock: a socket passed to gst_srt_reactor_add()
+ *
+ * Stops watching @sock. Once this returns, the callback of @sock is not
+ * running and won't be called again. Can be called from that callback.
+ */
+void
+gst_srt_reactor_remove (SRTSOCKET sock)
+{
+  ReactorLoop *loop = NULL;
+
+  /* Don't take the loop lock with runtime_lock held, a callback may be
+   * waiting for runtime_lock with the loop lock held */
+  g_mutex_lock (&runtime_lock);
+  if (sockets != NULL) {
+    loop = g_hash_table_lookup (sockets, GINT_TO_POINTER (sock));
+    g_hash_table_remove (sockets, GINT_TO_POINTER (sock));
+  }
+  g_mutex_unlock (&runtime_lock);
+
+  if (loop == NULL)
+    return;
+
+  g_rec_mutex_lock (&loop->lock);
+  srt_epoll_remove_usock (loop->eid, sock);
+  if (g_hash_table_remove (loop->watches, GINT_TO_POINTER (sock)))
+    g_atomic_int_add (&loop->n_watches, -1);
+  g_rec_mutex_unlock (&loop->lock);
+}
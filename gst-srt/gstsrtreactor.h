@@ -0,0 +1,51 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_REACTOR_H__
+#define __GST_SRT_REACTOR_H__
+
+#include <gst/gst.h>
+
+#include <srt.h>
+
+/* Upper bound of the reactor threads, the pool is sized from the number of
+ * cores below that */
+#define SRT_REACTOR_MAX_THREADS 4
+/* How long a reactor thread waits before checking whether to quit, in
+ * milliseconds */
+#define SRT_REACTOR_TIMEOUT 100
+
+G_BEGIN_DECLS
+
+/* Called from a reactor thread when @sock is ready for @events
+ * (SRT_EPOLL_IN or SRT_EPOLL_OUT, errors are reported as both) */
+typedef void (*GstSRTReactorFunc) (SRTSOCKET sock, int events,
+  gpointer user_data);
+
+void gst_srt_runtime_ref (void);
+
+void gst_srt_runtime_unref (void);
+
+gboolean gst_srt_reactor_add (SRTSOCKET sock, int events,
+  GstSRTReactorFunc func, gpointer user_data);
+
+void gst_srt_reactor_remove (SRTSOCKET sock);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_REACTOR_H__ */
@@ -0,0 +1,548 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Recording tap of the sinks: the rendered buffers are queued by reference
+ * to a writer thread, which writes their memory to segmented files without
+ * copying it, or through an aligned staging block with O_DIRECT to bypass
+ * the page cache. A segment is rotated at the first keyframe after it
+ * reaches its maximum size or duration, and starts with the stream headers
+ * so that it can be played on its own. */
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtrecorder.h"
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#define GST_CAT_DEFAULT gst_debug_srt_recorder
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+/* Staging block of the O_DIRECT writes, a multiple of any block size */
+#define DIRECT_IO_ALIGN 4096
+#define DIRECT_IO_BLOCK (1024 * 1024)
+/* Memories written by one writev() call */
+#define MAX_IOV 64
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstClockTime running_time;
+} RecordItem;
+
+struct _GstSRTRecorder
+{
+  GstElement *elem;
+  gchar *location;
+  guint64 max_size;
+  GstClockTime max_time;
+  gboolean direct_io;
+
+  GThread *thread;
+  GstSRTThreadConfig thread_config;
+  GAsyncQueue *queue;
+  gint queued_bytes;
+  gint quit;
+  guint64 dropped;
+
+  GMutex lock;
+  /* protected by lock */
+  GstBufferList *headers;
+
+  /* only used by the writer thread */
+  int fd;
+  guint index;
+  guint64 segment_size;
+  GstClockTime segment_start;
+  gboolean failed;
+  guint8 *block;
+  gsize block_fill;
+};
+
+static RecordItem quit_item;
+
+static gboolean
+write_all (GstSRTRecorder * rec, const guint8 * data, gsize size)
+{
+  while (size > 0) {
+    gssize ret = write (rec->fd, data, size);
+
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    data += ret;
+    size -= ret;
+  }
+
+  return TRUE;
+}
+
+/* Writes the memories of @buffer through the page cache, in as few calls
+ * as possible */
+static gboolean
+write_buffer_vectored (GstSRTRecorder * rec, GstBuffer * buffer)
+{
+  guint n = gst_buffer_n_memory (buffer);
+  GstMapInfo maps[MAX_IOV];
+  gboolean ret = TRUE;
+  guint i = 0;
+
+  while (ret && i < n) {
+    guint count = MIN (n - i, MAX_IOV);
+    guint j, mapped = 0;
+#ifdef G_OS_UNIX
+    struct iovec iov[MAX_IOV];
+    gsize total = 0;
+#endif
+
+    for (j = 0; j < count; j++) {
+      GstMemory *mem = gst_buffer_peek_memory (buffer, i + j);
+
+      if (!gst_memory_map (mem, &maps[j], GST_MAP_READ)) {
+        ret = FALSE;
+        break;
+      }
+      mapped++;
+#ifdef G_OS_UNIX
+      iov[j].iov_base = maps[j].data;
+      iov[j].iov_len = maps[j].size;
+      total += maps[j].size;
+#endif
+    }
+
+#ifdef G_OS_UNIX
+    if (ret) {
+      gssize written = writev (rec->fd, iov, (int)count);
+
+      /* Finish a short write one memory at a time */
+      for (j = 0; written >= 0 && j < count; j++) {
+        if ((gsize)written >= maps[j].size) {
+          written -= maps[j].size;
+          continue;
+        }
+        ret = write_all (rec, maps[j].data + written,
+          maps[j].size - written);
+        written = 0;
+        if (!ret)
+          break;
+      }
+      if (written < 0)
+        ret = FALSE;
+    }
+#else
+    for (j = 0; ret && j < count; j++)
+      ret = write_all (rec, maps[j].data, maps[j].size);
+#endif
+
+    for (j = 0; j < mapped; j++)
+      gst_memory_unmap (maps[j].memory, &maps[j]);
+    i += count;
+  }
+
+  return ret;
+}
+
+/* Copies @data to the staging block and writes it out whenever it's full */
+static gboolean
+write_staged (GstSRTRecorder * rec, const guint8 * data, gsize size)
+{
+  while (size > 0) {
+    gsize n = MIN (size, DIRECT_IO_BLOCK - rec->block_fill);
+
+    memcpy (rec->block + rec->block_fill, data, n);
+    rec->block_fill += n;
+    data += n;
+    size -= n;
+
+    if (rec->block_fill == DIRECT_IO_BLOCK) {
+      if (!write_all (rec, rec->block, DIRECT_IO_BLOCK))
+        return FALSE;
+      rec->block_fill = 0;
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
+write_buffer (GstSRTRecorder * rec, GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gboolean ret;
+
+  if (!rec->direct_io)
+    return write_buffer_vectored (rec, buffer);
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+  ret = write_staged (rec, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+
+  return ret;
+}
+
+/* Whether @location has exactly one integer conversion, for the segment
+ * index, and no other one. It is used as a printf() format */
+static gboolean
+location_is_valid (const gchar * location)
+{
+  guint n_conversions = 0;
+  const gchar *p;
+
+  for (p = location; *p != '\0'; p++) {
+    if (*p != '%')
+      continue;
+
+    p++;
+    if (*p == '%')
+      continue;
+
+    while (*p != '\0' && strchr ("-+ #0", *p) != NULL)
+      p++;
+    while (g_ascii_isdigit (*p))
+      p++;
+    if (*p == '.') {
+      p++;
+      while (g_ascii_isdigit (*p))
+        p++;
+    }
+
+    if (*p == '\0' || strchr ("diuoxX", *p) == NULL)
+      return FALSE;
+    n_conversions++;
+  }
+
+  return n_conversions == 1;
+}
+
+static gboolean
+close_segment (GstSRTRecorder * rec)
+{
+  gboolean ret = TRUE;
+
+  if (rec->fd < 0)
+    return TRUE;
+
+#if defined(__linux__) && defined(O_DIRECT)
+  /* The last block is partial, write it through the page cache */
+  if (rec->direct_io && rec->block_fill > 0) {
+    fcntl (rec->fd, F_SETFL, fcntl (rec->fd, F_GETFL) & ~O_DIRECT);
+    ret = write_all (rec, rec->block, rec->block_fill);
+  }
+#endif
+  rec->block_fill = 0;
+
+  if (close (rec->fd) != 0)
+    ret = FALSE;
+  rec->fd = -1;
+
+  return ret;
+}
+
+static gboolean
+open_segment (GstSRTRecorder * rec, GstClockTime running_time)
+{
+  gchar *filename = g_strdup_printf (rec->location, rec->index);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  GstBufferList *headers = NULL;
+  gboolean ret = TRUE;
+
+#ifdef O_BINARY
+  flags |= O_BINARY;
+#endif
+#if defined(__linux__) && defined(O_DIRECT)
+  if (rec->direct_io)
+    flags |= O_DIRECT;
+#endif
+
+  rec->fd = g_open (filename, flags, 0644);
+  if (rec->fd < 0) {
+    GST_ELEMENT_WARNING (rec->elem, RESOURCE, OPEN_WRITE,
+      ("Could not open recording \"%s\"", filename),
+      ("%s", g_strerror (errno)));
+    g_free (filename);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (rec->elem, "Recording to %s", filename);
+  g_free (filename);
+
+  rec->index++;
+  rec->segment_size = 0;
+  rec->segment_start = running_time;
+
+  g_mutex_lock (&rec->lock);
+  if (rec->headers)
+    headers = gst_buffer_list_ref (rec->headers);
+  g_mutex_unlock (&rec->lock);
+
+  if (headers) {
+    guint i;
+
+    for (i = 0; ret && i < gst_buffer_list_length (headers); i++) {
+      GstBuffer *buffer = gst_buffer_list_get (headers, i);
+
+      ret = write_buffer (rec, buffer);
+      rec->segment_size += gst_buffer_get_size (buffer);
+    }
+    gst_buffer_list_unref (headers);
+  }
+
+  return ret;
+}
+
+/* Whether the current segment is full and @buffer can start a new one */
+static gboolean
+need_rotate (GstSRTRecorder * rec, GstBuffer * buffer,
+  GstClockTime running_time)
+{
+  gboolean full = FALSE;
+
+  if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+    return FALSE;
+
+  if (rec->max_size > 0 && rec->segment_size >= rec->max_size)
+    full = TRUE;
+
+  if (rec->max_time > 0 && running_time != GST_CLOCK_TIME_NONE
+      && rec->segment_start != GST_CLOCK_TIME_NONE
+      && running_time >= rec->segment_start + rec->max_time)
+    full = TRUE;
+
+  return full;
+}
+
+static void
+write_item (GstSRTRecorder * rec, RecordItem * item)
+{
+  gsize size = gst_buffer_get_size (item->buffer);
+
+  if (rec->fd >= 0 && need_rotate (rec, item->buffer, item->running_time)) {
+    if (!close_segment (rec))
+      goto failed;
+  }
+
+  /* open_segment() posts its own warning */
+  if (rec->fd < 0 && !open_segment (rec, item->running_time)) {
+    rec->failed = TRUE;
+    close_segment (rec);
+    return;
+  }
+
+  if (!write_buffer (rec, item->buffer))
+    goto failed;
+
+  rec->segment_size += size;
+  if (rec->segment_start == GST_CLOCK_TIME_NONE)
+    rec->segment_start = item->running_time;
+
+  return;
+
+failed:
+  /* Keep delivering, only the recording stops */
+  GST_ELEMENT_WARNING (rec->elem, RESOURCE, WRITE,
+    ("Recording failed, stopping it"),
+    ("%s", errno ? g_strerror (errno) : "could not map the buffer"));
+  rec->failed = TRUE;
+  close_segment (rec);
+}
+
+static gpointer
+writer_thread_func (gpointer data)
+{
+  GstSRTRecorder *rec = data;
+  GError *error = NULL;
+
+  /* The thread is ours until the recording stops */
+  if (!gst_srt_thread_apply (&rec->thread_config, &error)) {
+    GST_ELEMENT_WARNING (rec->elem, RESOURCE, SETTINGS,
+      ("Failed to configure the recording thread"), ("%s", error->message));
+    g_clear_error (&error);
+  }
+
+  while (TRUE) {
+    RecordItem *item = g_async_queue_pop (rec->queue);
+
+    if (item == &quit_item)
+      break;
+
+    g_atomic_int_add (&rec->queued_bytes,
+      -(gint)gst_buffer_get_size (item->buffer));
+    if (!rec->failed) {
+      errno = 0;
+      write_item (rec, item);
+    }
+    gst_buffer_unref (item->buffer);
+    g_slice_free (RecordItem, item);
+  }
+
+  if (!close_segment (rec))
+    GST_ELEMENT_WARNING (rec->elem, RESOURCE, WRITE,
+      ("Could not finish the recording"), ("%s", g_strerror (errno)));
+
+  return NULL;
+}
+
+/**
+ * gst_srt_recorder_new:
+ * @elem: element the errors are posted for
+ * @location: segment file names, with a printf() style directive for the
+ *   segment index such as "rec-%05d.ts", and no other one
+ * @max_size: rotate the segments after this many bytes, 0 for no limit
+ * @max_time: rotate the segments after this running time, 0 for no limit
+ * @direct_io: write with O_DIRECT
+ * @thread_config: placement and priority of the writer thread
+ * @error: return location for a #GError
+ *
+ * Returns: (transfer full) (nullable): a new recorder, %NULL if its thread
+ * could not be started.
+ */
+GstSRTRecorder *
+gst_srt_recorder_new (GstElement * elem, const gchar * location,
+  guint64 max_size, GstClockTime max_time, gboolean direct_io,
+  const GstSRTThreadConfig * thread_config, GError ** error)
+{
+  GstSRTRecorder *rec;
+  static gsize debug_init = 0;
+
+  if (g_once_init_enter (&debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "srtrecorder", 0,
+      "SRT recording tap");
+    g_once_init_leave (&debug_init, 1);
+  }
+
+  if (!location_is_valid (location)) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+      "\"%s\" needs exactly one integer directive for the segment index, "
+      "such as %%05d", location);
+    return NULL;
+  }
+
+  rec = g_new0 (GstSRTRecorder, 1);
+  rec->elem = elem;
+  rec->location = g_strdup (location);
+  rec->max_size = max_size;
+  rec->max_time = max_time;
+  rec->fd = -1;
+  rec->segment_start = GST_CLOCK_TIME_NONE;
+  gst_srt_thread_config_copy (&rec->thread_config, thread_config);
+  rec->queue = g_async_queue_new ();
+  g_mutex_init (&rec->lock);
+
+#if defined(__linux__) && defined(O_DIRECT)
+  rec->direct_io = direct_io;
+  if (direct_io && posix_memalign ((void **)&rec->block, DIRECT_IO_ALIGN,
+      DIRECT_IO_BLOCK) != 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+      "could not allocate the O_DIRECT staging block");
+    gst_srt_recorder_free (rec);
+    return NULL;
+  }
+#else
+  if (direct_io)
+    GST_WARNING_OBJECT (elem, "O_DIRECT is not supported, writing through "
+      "the page cache");
+#endif
+
+  rec->thread = g_thread_try_new ("srtrecorder", writer_thread_func, rec,
+    error);
+  if (rec->thread == NULL) {
+    gst_srt_recorder_free (rec);
+    return NULL;
+  }
+
+  return rec;
+}
+
+/* Flushes the queued buffers and closes the recording */
+void
+gst_srt_recorder_free (GstSRTRecorder * rec)
+{
+  if (rec->thread) {
+    g_async_queue_push (rec->queue, &quit_item);
+    g_thread_join (rec->thread);
+  }
+
+  GST_DEBUG_OBJECT (rec->elem, "Recorded %u segments, dropped %"
+    G_GUINT64_FORMAT " buffers", rec->index, rec->dropped);
+
+  g_async_queue_unref (rec->queue);
+  g_mutex_clear (&rec->lock);
+  g_clear_pointer (&rec->headers, gst_buffer_list_unref);
+  /* From posix_memalign() */
+  free (rec->block);
+  g_free (rec->location);
+  gst_srt_thread_config_clear (&rec->thread_config);
+  g_free (rec);
+}
+
+/* Sets the stream headers each segment starts with */
+void
+gst_srt_recorder_set_headers (GstSRTRecorder * rec, GstBufferList * headers)
+{
+  g_mutex_lock (&rec->lock);
+  g_clear_pointer (&rec->headers, gst_buffer_list_unref);
+  if (headers)
+    rec->headers = gst_buffer_list_ref (headers);
+  g_mutex_unlock (&rec->lock);
+}
+
+/* Queues a reference to @buffer for the writer thread */
+void
+gst_srt_recorder_push (GstSRTRecorder * rec, GstBuffer * buffer,
+  GstClockTime running_time)
+{
+  gsize size = gst_buffer_get_size (buffer);
+  RecordItem *item;
+
+  if (g_atomic_int_get (&rec->queued_bytes) + size >
+      SRT_RECORD_MAX_QUEUED_BYTES) {
+    if (rec->dropped++ == 0)
+      GST_ELEMENT_WARNING (rec->elem, RESOURCE, WRITE,
+        ("The disk can't keep up with the recording, dropping buffers"),
+        (NULL));
+    return;
+  }
+
+  item = g_slice_new (RecordItem);
+  item->buffer = gst_buffer_ref (buffer);
+  item->running_time = running_time;
+  g_atomic_int_add (&rec->queued_bytes, (gint)size);
+  g_async_queue_push (rec->queue, item);
+}
@@ -0,0 +1,53 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_RECORDER_H__
+#define __GST_SRT_RECORDER_H__
+
+#include <gst/gst.h>
+
+#include "gstsrtthread.h"
+
+/* 0 disables the rotation by size or time */
+#define SRT_DEFAULT_RECORD_MAX_SIZE 0
+#define SRT_DEFAULT_RECORD_MAX_TIME 0
+#define SRT_DEFAULT_RECORD_DIRECT_IO FALSE
+/* Buffers queued for the disk beyond this are dropped from the recording
+ * rather than delaying the delivery */
+#define SRT_RECORD_MAX_QUEUED_BYTES (64 * 1024 * 1024)
+
+G_BEGIN_DECLS
+
+typedef struct _GstSRTRecorder GstSRTRecorder;
+
+GstSRTRecorder * gst_srt_recorder_new (GstElement * elem,
+  const gchar * location, guint64 max_size, GstClockTime max_time,
+  gboolean direct_io, const GstSRTThreadConfig * thread_config,
+  GError ** error);
+
+void gst_srt_recorder_free (GstSRTRecorder * rec);
+
+void gst_srt_recorder_set_headers (GstSRTRecorder * rec,
+  GstBufferList * headers);
+
+void gst_srt_recorder_push (GstSRTRecorder * rec, GstBuffer * buffer,
+  GstClockTime running_time);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_RECORDER_H__ */
@@ -33,6 +33,22 @@
    * |[
    * gst-launch-1.0 -v audiotestsrc ! srtserversink
    * ]| This pipeline shows how to serve SRT packets through the default port.
+   * |[
+   * gst-launch-1.0 -v videotestsrc ! x264enc ! mpegtsmux ! srtserversink timeshift-size=268435456
+   * ]| This pipeline keeps the last 256 MiB of the stream, so a client
+   * connecting with the stream ID "#!::timeshift=30" watches it 30 seconds
+   * behind live.
+   * |[
+   * gst-launch-1.0 -v videotestsrc ! tee name=t \
+   *     t. ! queue ! x264enc bitrate=4000 ! mpegtsmux ! srt.sink \
+   *     t. ! queue ! x264enc bitrate=1000 ! mpegtsmux ! srt.sink_1 \
+   *     srtserversink name=srt
+   * ]| This pipeline serves two renditions. The "sink" pad is the top tier,
+   * each "sink_%u" request pad a lower one, down to "sink_15". The request
+   * pads are synchronised to the clock in PLAYING like the "sink" pad, but
+   * do not take part in preroll. Clients start on the tier their
+   * stream ID asks for, e.g. "#!::tier=1", and are moved down or up at
+   * keyframes according to their send backlog and loss.
    * </refsect2>
    *
    */
@@ -43,41 +59,107 @@
 
 #include "gstsrtserversink.h"
 #include "gstsrt.h"
+#include "gstsrttracer.h"
+#include "gstsrtreactor.h"
+#include "gstsrttimeshift.h"
 #include <srt.h>
 #include <gio/gio.h>
+#include <string.h>
 
 #define SRT_DEFAULT_POLL_TIMEOUT - 1
 // How many times a send fails in a row before we disconnect a client
 #define MAX_SEND_FAILS 10
 
+/* Tier of the always "sink" pad, the top rendition. The "sink_%u" request
+ * pads are tier %u, the higher the lower the bitrate */
+#define SRT_TIER_TOP 0
+#define SRT_TIER_BOTTOM 15
+#define SRT_NO_TIER -1
+#define SRT_STREAMID_TIER_KEY "tier"
+#define SRT_DEFAULT_TIER_SWITCHING TRUE
+/* How often the backlog and loss of a client are checked, in microseconds */
+#define SRT_TIER_CHECK_INTERVAL G_USEC_PER_SEC
+/* Move a client down when its unacknowledged data fills this share of the
+ * send buffer, or this share of its packets was lost since the last check */
+#define SRT_TIER_DOWN_BACKLOG 0.5
+#define SRT_TIER_DOWN_LOSS 0.05
+/* Move it up after this many checks in a row below these */
+#define SRT_TIER_UP_BACKLOG 0.1
+#define SRT_TIER_UP_LOSS 0.01
+#define SRT_TIER_UP_CHECKS 5
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
   GST_PAD_SINK,
   GST_PAD_ALWAYS,
   GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate rendition_template =
+GST_STATIC_PAD_TEMPLATE ("sink_%u",
+  GST_PAD_SINK,
+  GST_PAD_REQUEST,
+  GST_STATIC_CAPS_ANY);
+
 #define GST_CAT_DEFAULT gst_debug_srt_server_sink
 GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 
 struct _GstSRTServerSinkPrivate
 {
-  gboolean cancelled;
-
   SRTSOCKET sock;
-  gint poll_id;
   gint poll_timeout;
 
-  GThread *thread;
-
   GList *clients;
   GAsyncQueue *pending_clients;
+
+  /* send buffer size of the clients, in bytes */
+  gint send_buffer_size;
+  /* running time of the buffer being delivered, in the segment of its pad,
+   * protected by the object lock */
+  GstClockTime send_running_time;
+
+  guint64 timeshift_size;
+  gchar *timeshift_location;
+  /* protected by the object lock */
+  GstSRTTimeshift *timeshift;
+
+  gboolean tier_switching;
+  /* tier -> SRTRendition of the request pads, NULL for the top tier and
+   * released pads, protected by the object lock */
+  GPtrArray *renditions;
+  /* state of the renditions' clock waits, protected by the object lock */
+  GCond rendition_cond;
+  gboolean renditions_playing;
+  gboolean renditions_stopped;
+
+  /* stream ID -> passphrase */
+  GstStructure *streamid_passphrases;
 };
 
+typedef struct
+{
+  GstPad *pad;
+  guint tier;
+  /* protected by the object lock */
+  GstBufferList *headers;
+  gboolean flushing;
+  gboolean eos;
+  GstClockID clock_id;
+  GstSRTKeyUnitRequest key_unit;
+  /* the streaming thread of the pad only */
+  GstSegment segment;
+  guint8 *strip_buf;
+  gsize strip_buf_size;
+} SRTRendition;
+
 #define GST_SRT_SERVER_SINK_GET_PRIVATE(obj)  \
        (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_SRT_SERVER_SINK, GstSRTServerSinkPrivate))
 
 enum
 {
   PROP_POLL_TIMEOUT = 1,
+  PROP_TIMESHIFT_SIZE,
+  PROP_TIMESHIFT_LOCATION,
+  PROP_TIER_SWITCHING,
+  PROP_STREAMID_PASSPHRASES,
 #if GST_VERSION_MINOR >= 14
   PROP_STATS,
 #endif
@@ -108,6 +190,22 @@ typedef struct
   int sock;
   GSocketAddress *sockaddr;
   int num_send_fails;
+  GstSRTHistogram send_latency;
+
+  /* how far behind live the client asked to be, 0 for live */
+  GstClockTime timeshift;
+  /* sent from the timeshift ring, starting at the buffer @cursor */
+  gboolean timeshifted;
+  guint64 cursor;
+
+  /* rendition the client gets, SRT_NO_TIER until it joins one */
+  gint tier;
+  /* rendition it moves to at the next keyframe of it */
+  gint pending_tier;
+  gint64 tier_check_time;
+  guint good_checks;
+  gint64 last_pkt_sent;
+  gint64 last_pkt_lost;
 } SRTClient;
 
 static SRTClient *
@@ -116,6 +214,9 @@ srt_client_new (void)
   SRTClient *client = g_new0 (SRTClient, 1);
   client->sock = SRT_INVALID_SOCK;
   client->num_send_fails = 0;
+  client->tier = SRT_NO_TIER;
+  client->pending_tier = SRT_TIER_TOP;
+  client->tier_check_time = g_get_monotonic_time ();
   GST_DEBUG ("New SRT client");
   return client;
 }
@@ -133,6 +234,17 @@ srt_client_free (SRTClient * client)
   g_free (client);
 }
 
+static void
+srt_rendition_free (SRTRendition * rendition)
+{
+  if (rendition == NULL)
+    return;
+
+  g_clear_pointer (&rendition->headers, gst_buffer_list_unref);
+  g_free (rendition->strip_buf);
+  g_free (rendition);
+}
+
 static void
 srt_emit_client_removed (SRTClient * client, gpointer user_data)
 {
@@ -154,6 +266,18 @@ gst_srt_server_sink_get_property (GObject * object,
   case PROP_POLL_TIMEOUT:
     g_value_set_int (value, priv->poll_timeout);
     break;
+  case PROP_TIMESHIFT_SIZE:
+    g_value_set_uint64 (value, priv->timeshift_size);
+    break;
+  case PROP_TIMESHIFT_LOCATION:
+    g_value_set_string (value, priv->timeshift_location);
+    break;
+  case PROP_TIER_SWITCHING:
+    g_value_set_boolean (value, priv->tier_switching);
+    break;
+  case PROP_STREAMID_PASSPHRASES:
+    gst_value_set_structure (value, priv->streamid_passphrases);
+    break;
 #if GST_VERSION_MINOR >= 14
   case PROP_STATS:
   {
@@ -163,10 +287,17 @@ gst_srt_server_sink_get_property (GObject * object,
     for (item = priv->clients; item; item = item->next) {
       SRTClient *client = item->data;
       GValue tmp = G_VALUE_INIT;
-
+      GstStructure *s = gst_srt_base_sink_get_stats (client->sockaddr,
+        client->sock);
+
+      gst_srt_histogram_add_to_structure (&client->send_latency, s,
+        "send-latency");
+      if (client->timeshifted)
+        gst_structure_set (s, "timeshift", G_TYPE_UINT64, client->timeshift,
+          NULL);
+      gst_structure_set (s, "tier", G_TYPE_INT, client->tier, NULL);
       g_value_init (&tmp, GST_TYPE_STRUCTURE);
-      g_value_take_boxed (&tmp, gst_srt_base_sink_get_stats (client->sockaddr,
-        client->sock));
+      g_value_take_boxed (&tmp, s);
       gst_value_array_append_and_take_value (value, &tmp);
     }
     GST_OBJECT_UNLOCK (self);
@@ -190,68 +321,173 @@ gst_srt_server_sink_set_property (GObject * object,
   case PROP_POLL_TIMEOUT:
     priv->poll_timeout = g_value_get_int (value);
     break;
+  case PROP_TIMESHIFT_SIZE:
+    priv->timeshift_size = g_value_get_uint64 (value);
+    break;
+  case PROP_TIMESHIFT_LOCATION:
+    g_free (priv->timeshift_location);
+    priv->timeshift_location = g_value_dup_string (value);
+    break;
+  case PROP_TIER_SWITCHING:
+    GST_OBJECT_LOCK (self);
+    priv->tier_switching = g_value_get_boolean (value);
+    GST_OBJECT_UNLOCK (self);
+    break;
+  case PROP_STREAMID_PASSPHRASES:
+  {
+    const GstStructure *s = gst_value_get_structure (value);
+
+    g_clear_pointer (&priv->streamid_passphrases, gst_structure_free);
+    if (s)
+      priv->streamid_passphrases = gst_structure_copy (s);
+    break;
+  }
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
   }
 }
 
-static gpointer
-thread_func (gpointer data)
+static void
+gst_srt_server_sink_finalize (GObject * object)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (object);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  g_clear_pointer (&priv->timeshift_location, g_free);
+  g_clear_pointer (&priv->streamid_passphrases, gst_structure_free);
+  g_ptr_array_unref (priv->renditions);
+  g_cond_clear (&priv->rendition_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* Reads how far behind live the client wants to be and the tier it starts
+ * on from its stream ID */
+static void
+parse_client_streamid (SRTClient * client)
+{
+  gchar *streamid = gst_srt_get_streamid (client->sock);
+  GstStructure *s = gst_srt_parse_streamid (streamid);
+  const gchar *value;
+
+  if (s && (value = gst_structure_get_string (s,
+        SRT_STREAMID_TIMESHIFT_KEY))) {
+    gdouble seconds = g_ascii_strtod (value, NULL);
+
+    if (seconds > 0)
+      client->timeshift = (GstClockTime)(seconds * GST_SECOND);
+  }
+
+  if (s && (value = gst_structure_get_string (s, SRT_STREAMID_TIER_KEY)))
+    client->pending_tier = (gint)CLAMP (g_ascii_strtoll (value, NULL, 10),
+      SRT_TIER_TOP, SRT_TIER_BOTTOM);
+
+  if (s)
+    gst_structure_free (s);
+  g_free (streamid);
+}
+
+/* Called with the object lock */
+static gboolean
+has_tier (GstSRTServerSinkPrivate * priv, gint tier)
+{
+  if (tier == SRT_TIER_TOP)
+    return TRUE;
+
+  return tier > SRT_TIER_TOP && (guint)tier < priv->renditions->len
+    && g_ptr_array_index (priv->renditions, tier) != NULL;
+}
+
+/* Whether clients can join @tier, which has a pad not at EOS. Called with
+ * the object lock */
+static gboolean
+tier_is_open (GstSRTServerSinkPrivate * priv, gint tier)
+{
+  SRTRendition *rendition;
+
+  if (!has_tier (priv, tier))
+    return FALSE;
+  if (tier == SRT_TIER_TOP)
+    return TRUE;
+
+  rendition = g_ptr_array_index (priv->renditions, tier);
+  return !rendition->eos;
+}
+
+/* Next open tier from @tier, in the direction of @step. Called with the
+ * object lock */
+static gint
+next_tier (GstSRTServerSinkPrivate * priv, gint tier, gint step)
+{
+  for (tier += step; tier >= SRT_TIER_TOP
+      && (guint)tier < priv->renditions->len; tier += step) {
+    if (tier_is_open (priv, tier))
+      return tier;
+  }
+
+  return SRT_NO_TIER;
+}
+
+/* Called from the shared reactor when a client is waiting to be accepted */
+static void
+accept_func (SRTSOCKET sock, int events, gpointer data)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (data);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  SRTClient *client;
+  struct sockaddr_storage sa;
+  int sa_len = sizeof (sa);
 
-  while(!priv->cancelled){
-    SRTClient *client;
-    int numReadySockets = 1;
-    SRTSOCKET readySocket;
-    struct sockaddr sa;
-    int sa_len;
-
-    // Wait until we can write
-    if (srt_epoll_wait (priv->poll_id,
-                0, 0, &readySocket, &numReadySockets,
-                priv->poll_timeout,
-                0, 0, 0, 0) == -1) {
-      int srt_errno = srt_getlasterror (NULL);
-
-      if (srt_errno != SRT_ETIMEOUT) {
-        GST_ELEMENT_ERROR (self, RESOURCE, FAILED,
-          ("SRT error: %s", srt_getlasterror_str ()), (NULL));
-        continue;
-      }
+  client = srt_client_new ();
+  client->sock = srt_accept (sock, (struct sockaddr *)&sa, &sa_len);
+  gst_srt_tracer_log_accept (GST_ELEMENT_CAST (self),
+    client->sock != SRT_INVALID_SOCK, priv->pending_clients);
 
-      /* Mimicking cancellable */
-      if (srt_errno == SRT_ETIMEOUT && priv->cancelled) {
-        GST_DEBUG_OBJECT (self, "Cancelled waiting for client");
-        continue;
-      }
-    }
+  if (client->sock == SRT_INVALID_SOCK) {
+    GST_WARNING_OBJECT (self, "detected invalid SRT client socket (reason: %s)",
+      srt_getlasterror_str ());
+    srt_clearlasterror ();
+    srt_client_free (client);
+    return;
+  }
 
-    client = srt_client_new ();
-    client->sock = srt_accept (priv->sock, &sa, &sa_len);
+  client->sockaddr = g_socket_address_new_from_native (&sa, sa_len);
+  parse_client_streamid (client);
 
-    if (client->sock == SRT_INVALID_SOCK) {
-      GST_WARNING_OBJECT (self, "detected invalid SRT client socket (reason: %s)",
-        srt_getlasterror_str ());
-      srt_clearlasterror ();
-      srt_client_free (client);
-      continue;
-    }
+  /* Pick up the latest "auto-inputbw" estimate */
+  gst_srt_base_sink_apply_bandwidth (GST_SRT_BASE_SINK (self), client->sock);
 
-    client->sockaddr = g_socket_address_new_from_native (&sa, sa_len);
+  GST_INFO_OBJECT(self, "Added client");
+  g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0, client->sock,
+    client->sockaddr);
 
-    GST_INFO_OBJECT(self, "Added client");
-    g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0, client->sock,
-      client->sockaddr);
+  g_async_queue_push(priv->pending_clients, client);
+  GST_DEBUG_OBJECT (self, "client added");
+}
 
-    g_async_queue_push(priv->pending_clients, client);
-    GST_DEBUG_OBJECT (self, "client added");
+#ifdef HAVE_SRT_LISTEN_CALLBACK
+/* Gives the socket being accepted the passphrase of its stream ID, the
+ * listener's one applies otherwise. Called from an SRT thread */
+static int
+gst_srt_server_sink_listen_cb (void *opaque, SRTSOCKET sock, int hs_version,
+  const struct sockaddr *peer_sa, const char *streamid)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (opaque);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  const gchar *passphrase =
+    gst_srt_lookup_passphrase (priv->streamid_passphrases, streamid);
+
+  if (passphrase != NULL && srt_setsockopt (sock, 0, SRTO_PASSPHRASE,
+      passphrase, (int)strlen (passphrase)) == SRT_ERROR) {
+    GST_WARNING_OBJECT (self, "Rejecting \"%s\", invalid passphrase: %s",
+      streamid, srt_getlasterror_str ());
+    return -1;
   }
-  GST_INFO_OBJECT(self, "New client polling thread safe exit");
-  return NULL;
+
+  return 0;
 }
+#endif
 
 static gboolean
 gst_srt_server_sink_start (GstBaseSink * sink)
@@ -306,22 +542,29 @@ gst_srt_server_sink_start (GstBaseSink * sink)
 
   int on = 1;
   int off = 0;
-  int64_t zero = 0;
-  /* Make SRT non blocking */
-  srt_setsockopt (priv->sock, 0, SRTO_SNDSYN, &off, sizeof (int));
+  gst_srt_set_transtype (priv->sock, base->transtype);
+
+  /* Make SRT non blocking. In file mode the sends block instead, so a
+   * slow client throttles the transfer rather than losing data */
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE)
+    srt_setsockopt (priv->sock, 0, SRTO_SNDSYN, &off, sizeof (int));
 
-  /* Use the larger recommended send buffer */
-  int send_buff_bytes = SRT_SEND_BUFFER_SIZE;
-  srt_setsockopt(priv->sock, 0, SRTO_UDP_SNDBUF, &send_buff_bytes, sizeof (int));
+  /* Size the buffers for the expected bitrate, or use the larger
+   * recommended send buffer. Accepted sockets inherit these */
+  priv->send_buffer_size = gst_srt_set_buffer_sizes (GST_ELEMENT (self),
+    priv->sock, TRUE, lat, gst_srt_base_sink_get_expected_bitrate (base));
 
-  /* Make sure TSBPD mode is enable (SRT mode) */
-  srt_setsockopt (priv->sock, 0, SRTO_TSBPDMODE, &on, sizeof (int));
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE) {
+    /* Make sure TSBPD mode is enable (SRT mode) */
+    srt_setsockopt (priv->sock, 0, SRTO_TSBPDMODE, &on, sizeof (int));
 
-  /* srt recommends disabling linger */
-  srt_setsockopt (priv->sock, 0, SRTO_LINGER, &off, sizeof (int));
+    /* srt recommends disabling linger */
+    srt_setsockopt (priv->sock, 0, SRTO_LINGER, &off, sizeof (int));
+  }
 
-  /* srt recommends having a max BW of 0, so relative */
-  srt_setsockflag (priv->sock, SRTO_MAXBW, &zero, sizeof (int64_t));
+  /* srt recommends having a max BW of 0, so relative, which is our
+   * default. Accepted sockets inherit these */
+  gst_srt_base_sink_apply_bandwidth (base, priv->sock);
 
   /* This is a sink, we're always a sender */
   srt_setsockopt (priv->sock, 0, SRTO_SENDER, &on, sizeof (int));
@@ -330,15 +573,26 @@ gst_srt_server_sink_start (GstBaseSink * sink)
   srt_setsockopt (priv->sock, 0, SRTO_PEERLATENCY, &lat, sizeof (int));
   /*srt_setsockopt (priv->sock, 0, SRTO_TSBPDDELAY, &lat, sizeof (int));*/
 
-  priv->poll_id = srt_epoll_create ();
-  if (priv->poll_id == -1) {
-    GST_WARNING_OBJECT (self,
-      "failed to create poll id for SRT socket (reason: %s)",
-      srt_getlasterror_str ());
+  /* Accepted sockets inherit the packet filter of the listener */
+  if (!gst_srt_set_packet_filter (GST_ELEMENT (self), priv->sock,
+      base->packet_filter))
+    goto failed;
+
+  gst_srt_set_encryption (GST_ELEMENT (self), priv->sock, base->passphrase,
+    base->key_length, base->km_refresh_rate, base->km_preannounce);
+
+#ifdef HAVE_SRT_LISTEN_CALLBACK
+  if (priv->streamid_passphrases != NULL)
+    srt_listen_callback (priv->sock, gst_srt_server_sink_listen_cb, self);
+#else
+  if (priv->streamid_passphrases != NULL)
+    GST_ELEMENT_WARNING (self, RESOURCE, SETTINGS,
+      ("Per stream ID passphrases need SRT 1.4.2"), (NULL));
+#endif
+
+  if (!gst_srt_apply_options (GST_ELEMENT (self), priv->sock, base->profile,
+      base->srt_options))
     goto failed;
-  }
-  int events = SRT_EPOLL_IN | SRT_EPOLL_OUT | SRT_EPOLL_ERR;
-  srt_epoll_add_usock (priv->poll_id, priv->sock, &events);
 
   if (srt_bind (priv->sock, &sa, (int)sa_len) == SRT_ERROR) {
     GST_WARNING_OBJECT (self, "failed to bind SRT server socket (reason: %s)",
@@ -352,10 +606,26 @@ gst_srt_server_sink_start (GstBaseSink * sink)
     goto failed;
   }
 
-  priv->thread = g_thread_try_new ("srtserversink", thread_func, self, &error);
-  if (error != NULL) {
-    GST_WARNING_OBJECT (self, "failed to create thread (reason: %s)",
-      error->message);
+  if (priv->timeshift_size > 0) {
+    GstSRTTimeshift *timeshift =
+      gst_srt_timeshift_new ((gsize)priv->timeshift_size,
+      priv->timeshift_location, &error);
+
+    if (timeshift == NULL) {
+      GST_ELEMENT_ERROR (self, RESOURCE, OPEN_WRITE,
+        ("Failed to create the timeshift ring"), ("%s", error->message));
+      goto failed;
+    }
+
+    GST_OBJECT_LOCK (self);
+    priv->timeshift = timeshift;
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  /* The shared reactor accepts the clients, rather than a thread of our own */
+  if (!gst_srt_reactor_add (priv->sock, SRT_EPOLL_IN | SRT_EPOLL_ERR,
+      accept_func, self)) {
+    GST_WARNING_OBJECT (self, "failed to watch SRT server socket");
     goto failed;
   }
 
@@ -365,21 +635,14 @@ gst_srt_server_sink_start (GstBaseSink * sink)
   return ret;
 
 failed:
-  priv->cancelled = TRUE;
-  if (priv->poll_id != SRT_ERROR) {
-    srt_epoll_release (priv->poll_id);
-    priv->poll_id = SRT_ERROR;
-  }
-
   if (priv->sock != SRT_INVALID_SOCK) {
     srt_close (priv->sock);
     priv->sock = SRT_INVALID_SOCK;
   }
 
-  if (priv->thread) {
-    g_thread_join (priv->thread);
-    g_clear_pointer (&priv->thread, g_thread_unref);
-  }
+  GST_OBJECT_LOCK (self);
+  g_clear_pointer (&priv->timeshift, gst_srt_timeshift_free);
+  GST_OBJECT_UNLOCK (self);
 
   g_clear_error (&error);
   g_clear_pointer (&uri, gst_uri_unref);
@@ -392,23 +655,29 @@ static gboolean inline
 send_buffer_internal (GstSRTBaseSink * sink,
   const GstMapInfo * mapinfo, gpointer user_data)
 {
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (sink);
   SRTClient *client = user_data;
+  GstClockTime start = gst_srt_tracer_now ();
 
-  if (srt_sendmsg2 (client->sock, (char *)mapinfo->data, (int)mapinfo->size,
-    0) == SRT_ERROR) {
+  if (!gst_srt_send (client->sock, sink->transtype, (char *)mapinfo->data,
+    mapinfo->size)) {
     GST_WARNING_OBJECT (sink, "Removing client Code:%d Reason: %s",
       srt_getlasterror (NULL), srt_getlasterror_str ());
     return FALSE;
   }
+  gst_srt_tracer_log_send (GST_ELEMENT_CAST (sink), start, mapinfo->size);
+
+  /* Called with the object lock held */
+  gst_srt_base_sink_record_send_latency (sink, &client->send_latency,
+    priv->send_running_time);
 
   return TRUE;
 }
 
 static gboolean inline
-can_client_recv (SRTSOCKET socket) {
+can_client_recv (SRTSOCKET socket, int send_buffer_size) {
     int num_bytes_unacknowledged;
     int num_bytes_len = sizeof (num_bytes_unacknowledged);
-    const int send_buffer_size = SRT_SEND_BUFFER_SIZE;
     const int default_msg_size = 1316; // 1316 is for mpegts
     // Get how many bytes are not yet acknowledged
     srt_getsockflag (socket, SRTO_SNDDATA, &num_bytes_unacknowledged, &num_bytes_len);
@@ -416,51 +685,327 @@ can_client_recv (SRTSOCKET socket) {
     return num_bytes_unacknowledged + default_msg_size < send_buffer_size;
 }
 
-static gboolean inline
-gst_srt_server_sink_send_buffer (GstSRTBaseSink * sink,
-  const GstMapInfo * mapinfo)
+/* Sends a timeshifted client the buffers of the ring that are due, each
+ * one @timeshift after it was rendered. Once it reaches the head of the
+ * ring, it gets the live buffers instead. Called with the object lock */
+static gboolean
+send_timeshifted (GstSRTBaseSink * sink, GstSRTTimeshift * timeshift,
+  SRTClient * client, int send_buffer_size)
+{
+  GstClockTime now = sink->render_running_time;
+
+  while (client->cursor < gst_srt_timeshift_get_head (timeshift)) {
+    GstClockTime running_time;
+    GstClockTime start;
+    const guint8 *data;
+    gsize size;
+
+    data = gst_srt_timeshift_peek (timeshift, client->cursor, &size,
+      &running_time);
+    if (data == NULL) {
+      /* Overwritten, skip to the oldest keyframe */
+      GST_WARNING_OBJECT (sink, "Client %d fell out of the timeshift ring",
+        client->sock);
+      client->cursor = gst_srt_timeshift_seek (timeshift, 0);
+      continue;
+    }
+
+    if (now != GST_CLOCK_TIME_NONE && running_time != GST_CLOCK_TIME_NONE
+        && running_time + client->timeshift > now)
+      return TRUE;
+
+    if (sink->transtype == GST_SRT_TRANSTYPE_LIVE
+        && !can_client_recv (client->sock, send_buffer_size))
+      return TRUE;
+
+    start = gst_srt_tracer_now ();
+    if (!gst_srt_send (client->sock, sink->transtype, (const gchar *)data,
+        size)) {
+      GST_WARNING_OBJECT (sink, "Removing client Code:%d Reason: %s",
+        srt_getlasterror (NULL), srt_getlasterror_str ());
+      return FALSE;
+    }
+    gst_srt_tracer_log_send (GST_ELEMENT_CAST (sink), start, size);
+    client->cursor++;
+  }
+
+  GST_INFO_OBJECT (sink, "Timeshifted client %d caught up with live",
+    client->sock);
+  client->timeshifted = FALSE;
+
+  return TRUE;
+}
+
+/* Called with the object lock */
+static void
+remove_client (GstSRTServerSink * self, SRTClient * client)
 {
-  GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
-  GST_OBJECT_LOCK (sink);
+
+  priv->clients = g_list_remove (priv->clients, client);
+  g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
+    client->sockaddr);
+  srt_client_free (client);
+}
+
+/* Asks the encoder of the rendition @tier for a keyframe, for a client
+ * joining it. Called with the object lock */
+static void
+request_tier_key_unit (GstSRTServerSink * self, gint tier)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  SRTRendition *rendition;
+
+  if (tier == SRT_TIER_TOP) {
+    gst_srt_base_sink_request_key_unit (GST_SRT_BASE_SINK (self));
+    return;
+  }
+
+  rendition = g_ptr_array_index (priv->renditions, tier);
+  gst_srt_key_unit_request_mark (&rendition->key_unit);
+}
+
+/* Moves the clients of the rendition @tier, released or at EOS, up to the
+ * next open tier at its next keyframe. Called with the object lock */
+static void
+move_tier_clients (GstSRTServerSink * self, gint tier)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GList *item;
+
+  for (item = priv->clients; item; item = item->next) {
+    SRTClient *client = item->data;
+
+    if (client->tier == tier || client->pending_tier == tier) {
+      client->pending_tier = next_tier (priv, tier, -1);
+      if (client->tier == tier)
+        client->tier = SRT_NO_TIER;
+      else if (client->tier != SRT_NO_TIER)
+        client->pending_tier = SRT_NO_TIER;
+      if (client->pending_tier != SRT_NO_TIER)
+        request_tier_key_unit (self, client->pending_tier);
+    }
+  }
+}
+
+/* Called with the object lock */
+static gboolean
+send_rendition_headers (GstSRTServerSink * self, gint tier,
+  SRTClient * client)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GstSRTBaseSink *sink = GST_SRT_BASE_SINK (self);
+  SRTRendition *rendition;
+
+  if (tier == SRT_TIER_TOP)
+    return gst_srt_base_sink_send_headers (sink, send_buffer_internal, client);
+
+  rendition = g_ptr_array_index (priv->renditions, tier);
+  return gst_srt_base_sink_send_header_list (sink, rendition->headers,
+    send_buffer_internal, client);
+}
+
+/* Moves a client down a tier when its backlog or loss grows, and back up
+ * once they stayed low for a while. The switch happens at the next
+ * keyframe of the new tier. Called with the object lock */
+static void
+check_client_tier (GstSRTServerSink * self, SRTClient * client)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  gint64 now = g_get_monotonic_time ();
+  SRT_TRACEBSTATS stats;
+  gdouble backlog, loss = 0;
+  gint64 sent, lost;
+  gint tier = SRT_NO_TIER;
+  int sndbuf;
+  int optlen = sizeof (sndbuf);
+
+  if (client->pending_tier != SRT_NO_TIER
+      || now - client->tier_check_time < SRT_TIER_CHECK_INTERVAL)
+    return;
+  client->tier_check_time = now;
+
+  /* Leave the interval counters to the "stats-interval" timer */
+  if (srt_bstats (client->sock, &stats, 0) == SRT_ERROR
+      || srt_getsockflag (client->sock, SRTO_SNDBUF, &sndbuf, &optlen)
+      == SRT_ERROR || sndbuf <= 0)
+    return;
+
+  backlog = (gdouble)stats.byteSndBuf / sndbuf;
+  sent = stats.pktSentTotal - client->last_pkt_sent;
+  lost = stats.pktSndLossTotal - client->last_pkt_lost;
+  client->last_pkt_sent = stats.pktSentTotal;
+  client->last_pkt_lost = stats.pktSndLossTotal;
+  if (sent > 0)
+    loss = (gdouble)lost / sent;
+
+  if (backlog > SRT_TIER_DOWN_BACKLOG || loss > SRT_TIER_DOWN_LOSS) {
+    client->good_checks = 0;
+    tier = next_tier (priv, client->tier, 1);
+  }
+  else if (backlog < SRT_TIER_UP_BACKLOG && loss < SRT_TIER_UP_LOSS) {
+    if (++client->good_checks >= SRT_TIER_UP_CHECKS) {
+      client->good_checks = 0;
+      tier = next_tier (priv, client->tier, -1);
+    }
+  }
+  else
+    client->good_checks = 0;
+
+  if (tier != SRT_NO_TIER) {
+    GST_INFO_OBJECT (self, "Moving client %d from tier %d to %d (backlog "
+      "%.0f%%, loss %.1f%%)", client->sock, client->tier, tier,
+      backlog * 100, loss * 100);
+    client->pending_tier = tier;
+    request_tier_key_unit (self, tier);
+  }
+}
+
+/* Sends a buffer of the rendition @tier to its clients, and switches the
+ * clients waiting for it at its keyframes. @running_time is the one of the
+ * buffer in the segment of its pad. Called with the object lock */
+static guint
+deliver_buffer (GstSRTServerSink * self, gint tier,
+  const GstMapInfo * mapinfo, GstClockTime running_time, gboolean keyframe)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GstSRTBaseSink *sink = GST_SRT_BASE_SINK (self);
   GList *clients = priv->clients;
+  guint n_sent = 0;
+
+  priv->send_running_time = running_time;
 
   while (clients != NULL) {
      SRTClient *client = clients->data;
      clients = clients->next;
 
-     if (!can_client_recv (client->sock)) {
+     if (client->timeshifted) {
+       if (tier != SRT_TIER_TOP)
+         continue;
+       if (send_timeshifted (sink, priv->timeshift, client,
+           priv->send_buffer_size))
+         n_sent++;
+       else
+         remove_client (self, client);
+       continue;
+     }
+
+     if (client->pending_tier == tier && keyframe) {
+       if (!send_rendition_headers (self, tier, client)) {
+         remove_client (self, client);
+         continue;
+       }
+       GST_INFO_OBJECT (self, "Client %d switched from tier %d to %d",
+         client->sock, client->tier, tier);
+       client->tier = tier;
+       client->pending_tier = SRT_NO_TIER;
+     }
+
+     if (client->tier != tier)
+       continue;
+
+     /* File transfers block on slow clients instead */
+     if (sink->transtype == GST_SRT_TRANSTYPE_LIVE
+       && !can_client_recv (client->sock, priv->send_buffer_size)) {
        client->num_send_fails++;
        if (client->num_send_fails >= MAX_SEND_FAILS) {
           GST_WARNING_OBJECT (sink, "Removing client as a result of too many send fails");
-          priv->clients = g_list_remove (priv->clients, client);
-          g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
-          client->sockaddr);
-          srt_client_free (client);
+          remove_client (self, client);
           continue;
        }
      }
 
-    if (!send_buffer_internal (sink, mapinfo, client)){
-      priv->clients = g_list_remove (priv->clients, client);
-      g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
-        client->sockaddr);
-      srt_client_free (client);
+    if (!send_buffer_internal (sink, mapinfo, client)) {
+      remove_client (self, client);
+      continue;
     }
+    n_sent++;
+
+    if (priv->tier_switching && priv->renditions->len > 1
+        && sink->transtype == GST_SRT_TRANSTYPE_LIVE)
+      check_client_tier (self, client);
   }
 
+  return n_sent;
+}
+
+static gboolean inline
+gst_srt_server_sink_send_buffer (GstSRTBaseSink * sink,
+  const GstMapInfo * mapinfo)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GstClockTime lock_start = gst_srt_tracer_now ();
+  GstClockTime lock_acquired;
+  guint n_sent = 0;
+  GST_OBJECT_LOCK (sink);
+  lock_acquired = gst_srt_tracer_now ();
+
+  if (priv->timeshift && !gst_srt_timeshift_push (priv->timeshift,
+      sink->render_running_time, sink->render_keyframe, mapinfo->data,
+      mapinfo->size))
+    GST_WARNING_OBJECT (sink, "Buffer of %" G_GSIZE_FORMAT " bytes does not "
+      "fit in the timeshift ring", mapinfo->size);
+
+  n_sent = deliver_buffer (self, SRT_TIER_TOP, mapinfo,
+    sink->render_running_time, sink->render_keyframe);
+
   // Process new clients
+  if (lock_acquired != GST_CLOCK_TIME_NONE)
+    gst_srt_tracer_log_pending (GST_ELEMENT_CAST (sink),
+      priv->pending_clients);
   SRTClient *client = (SRTClient*)g_async_queue_try_pop(priv->pending_clients);
 
   while(client != NULL){
+    /* Timeshift only covers the top tier */
+    if (client->timeshift > 0 && priv->timeshift)
+      client->pending_tier = SRT_TIER_TOP;
+    else if (!tier_is_open (priv, client->pending_tier)) {
+      GST_INFO_OBJECT (self, "Client %d asked for missing tier %d",
+        client->sock, client->pending_tier);
+      client->pending_tier = SRT_TIER_TOP;
+    }
+
+    /* Without waiting for the encoder's next keyframe. Timeshifted clients
+     * start from one in the ring */
+    if (client->timeshift == 0 || priv->timeshift == NULL)
+      request_tier_key_unit (self, client->pending_tier);
+
+    /* Lower tiers are joined at their next keyframe */
+    if (client->pending_tier != SRT_TIER_TOP) {
+      priv->clients = g_list_prepend (priv->clients, client);
+      client = (SRTClient*)g_async_queue_try_pop(priv->pending_clients);
+      continue;
+    }
+    client->tier = SRT_TIER_TOP;
+    client->pending_tier = SRT_NO_TIER;
+
     if (!gst_srt_base_sink_send_headers (sink, send_buffer_internal, client))
       goto err;
     GST_INFO_OBJECT(self, "Sent client headers");
 
-    if (!send_buffer_internal (sink, mapinfo, client))
+    if (client->timeshift > 0 && priv->timeshift) {
+      GstClockTime now = sink->render_running_time;
+
+      /* Start from the keyframe before the requested point, or the oldest
+       * one if the ring doesn't go back that far */
+      client->timeshifted = TRUE;
+      client->cursor = gst_srt_timeshift_seek (priv->timeshift,
+        now != GST_CLOCK_TIME_NONE && now > client->timeshift ?
+        now - client->timeshift : 0);
+      GST_INFO_OBJECT (self, "Client %d starts %" GST_TIME_FORMAT
+        " behind live, the ring holds %" GST_TIME_FORMAT, client->sock,
+        GST_TIME_ARGS (client->timeshift),
+        GST_TIME_ARGS (gst_srt_timeshift_get_duration (priv->timeshift)));
+      if (!send_timeshifted (sink, priv->timeshift, client,
+          priv->send_buffer_size))
+        goto err;
+    }
+    else if (!send_buffer_internal (sink, mapinfo, client))
       goto err;
     /* GList recommends prepending to lists for performance */
     priv->clients = g_list_prepend(priv->clients, client);
+    n_sent++;
     client = (SRTClient*)g_async_queue_try_pop(priv->pending_clients);
     continue;
 
@@ -471,66 +1016,367 @@ gst_srt_server_sink_send_buffer (GstSRTBaseSink * sink,
       client = (SRTClient*)g_async_queue_try_pop(priv->pending_clients);
   }
   GST_OBJECT_UNLOCK (sink);
+  gst_srt_tracer_log_lock (GST_ELEMENT_CAST (sink), lock_start, lock_acquired,
+    n_sent);
 
   return TRUE;
 }
 
+/* Interrupts the clock wait of the renditions and wakes those waiting for
+ * PLAYING. Called with the object lock */
+static void
+wake_renditions (GstSRTServerSink * self)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  guint i;
+
+  for (i = SRT_TIER_TOP + 1; i < priv->renditions->len; i++) {
+    SRTRendition *rendition = g_ptr_array_index (priv->renditions, i);
+
+    if (rendition && rendition->clock_id)
+      gst_clock_id_unschedule (rendition->clock_id);
+  }
+  g_cond_broadcast (&priv->rendition_cond);
+}
+
+/* Makes the streaming thread of @rendition return FLUSHING. Called with the
+ * object lock */
+static void
+flush_rendition (GstSRTServerSink * self, SRTRendition * rendition)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  rendition->flushing = TRUE;
+  if (rendition->clock_id)
+    gst_clock_id_unschedule (rendition->clock_id);
+  g_cond_broadcast (&priv->rendition_cond);
+}
+
+/* Waits for the clock to reach @running_time, as GstBaseSink does for the
+ * "sink" pad, so the lower tiers are paced like the top one. Without
+ * preroll, the request pads block until PLAYING. Returns FALSE when the pad
+ * flushes or the element stops */
 static gboolean
-gst_srt_server_sink_stop (GstBaseSink * sink)
+wait_rendition (GstSRTServerSink * self, SRTRendition * rendition,
+  GstClockTime running_time)
 {
-  GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GstBaseSink *basesink = GST_BASE_SINK (self);
+  /* These take the object lock themselves */
+  gboolean sync = gst_base_sink_get_sync (basesink);
+  GstClockTimeDiff ts_offset = gst_base_sink_get_ts_offset (basesink);
+  GstClockTime latency = gst_base_sink_get_latency (basesink);
+  gboolean ret = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  while (!rendition->flushing && !priv->renditions_stopped) {
+    GstClock *clock = GST_ELEMENT_CLOCK (self);
+    GstClockTime time;
+    GstClockReturn status;
+
+    if (!priv->renditions_playing) {
+      g_cond_wait (&priv->rendition_cond, GST_OBJECT_GET_LOCK (self));
+      continue;
+    }
 
-  priv->cancelled = TRUE;
+    if (!sync || clock == NULL || running_time == GST_CLOCK_TIME_NONE) {
+      ret = TRUE;
+      break;
+    }
 
-  GST_DEBUG_OBJECT (self, "closing SRT connection");
-  srt_epoll_remove_usock (priv->poll_id, priv->sock);
-  srt_epoll_release (priv->poll_id);
-  srt_close (priv->sock);
+    time = GST_ELEMENT_CAST (self)->base_time + running_time + latency;
+    if (ts_offset < 0)
+      time = time > (GstClockTime) -ts_offset ? time + ts_offset : 0;
+    else
+      time += ts_offset;
+
+    rendition->clock_id = gst_clock_new_single_shot_id (clock, time);
+    GST_OBJECT_UNLOCK (self);
+    status = gst_clock_id_wait (rendition->clock_id, NULL);
+    GST_OBJECT_LOCK (self);
+    gst_clock_id_unref (rendition->clock_id);
+    rendition->clock_id = NULL;
 
-  if (priv->thread) {
-    g_thread_join (priv->thread);
-    g_clear_pointer (&priv->thread, g_thread_unref);
+    /* Otherwise paused, flushing or stopping, checked above */
+    if (status != GST_CLOCK_UNSCHEDULED) {
+      ret = TRUE;
+      break;
+    }
   }
+  GST_OBJECT_UNLOCK (self);
 
-  GST_OBJECT_LOCK (sink);
-  GST_DEBUG_OBJECT (self, "closing client sockets");
-  g_list_foreach (priv->clients, (GFunc)srt_emit_client_removed, self);
-  g_list_free_full (priv->clients, (GDestroyNotify)srt_client_free);
-  /* async queue doesn't have a foreach, so we have to manually iterate
-   * through it to remove all pending clients */
-  SRTClient *client = g_async_queue_try_pop(priv->pending_clients);
-  while (client != NULL){
-    srt_emit_client_removed(client, self);
-    srt_client_free(client);
-    client = g_async_queue_try_pop(priv->pending_clients);
+  return ret;
+}
+
+static GstFlowReturn
+gst_srt_server_sink_rendition_chain (GstPad * pad, GstObject * parent,
+  GstBuffer * buffer)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (parent);
+  SRTRendition *rendition = gst_pad_get_element_private (pad);
+  GstSRTBaseSink *sink = GST_SRT_BASE_SINK (self);
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  GstMapInfo info, send_info;
+
+  gst_srt_key_unit_request_push (&rendition->key_unit, pad,
+    g_atomic_int_get (&sink->keyframe_request_interval) * GST_MSECOND);
+
+  GST_OBJECT_LOCK (self);
+  if (rendition->eos) {
+    GST_OBJECT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_EOS;
   }
-  g_async_queue_unref(priv->pending_clients);
-  GST_OBJECT_UNLOCK (sink);
+  if (rendition->headers
+      && GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER)) {
+    GST_OBJECT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+  GST_OBJECT_UNLOCK (self);
 
-  return GST_BASE_SINK_CLASS (parent_class)->stop (sink);
+  /* The renditions have segments of their own */
+  if (GST_BUFFER_DTS_OR_PTS (buffer) != GST_CLOCK_TIME_NONE)
+    running_time = gst_segment_to_running_time (&rendition->segment,
+      GST_FORMAT_TIME, GST_BUFFER_DTS_OR_PTS (buffer));
+
+  if (!wait_rendition (self, rendition, running_time)) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  if (!gst_buffer_map (buffer, &info, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ,
+      ("Could not map the input stream"), (NULL));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  send_info = info;
+  gst_srt_base_sink_strip_null_packets (sink, &send_info,
+    &rendition->strip_buf, &rendition->strip_buf_size);
+
+  GST_OBJECT_LOCK (self);
+  deliver_buffer (self, rendition->tier, &send_info, running_time,
+    !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT));
+  GST_OBJECT_UNLOCK (self);
+
+  gst_buffer_unmap (buffer, &info);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
 }
 
 static gboolean
-gst_srt_server_sink_unlock (GstBaseSink * sink)
+gst_srt_server_sink_rendition_event (GstPad * pad, GstObject * parent,
+  GstEvent * event)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (parent);
+  SRTRendition *rendition = gst_pad_get_element_private (pad);
+
+  /* Nothing downstream, only the stream headers, the segment, for the
+   * running time of the buffers, and the flushes and EOS matter */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT)
+    gst_event_copy_segment (event, &rendition->segment);
+  else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_START) {
+    GST_OBJECT_LOCK (self);
+    flush_rendition (self, rendition);
+    GST_OBJECT_UNLOCK (self);
+  }
+  else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    GST_OBJECT_LOCK (self);
+    rendition->flushing = FALSE;
+    rendition->eos = FALSE;
+    GST_OBJECT_UNLOCK (self);
+    gst_segment_init (&rendition->segment, GST_FORMAT_TIME);
+  }
+  else if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    GST_DEBUG_OBJECT (self, "Rendition tier %u ended", rendition->tier);
+    GST_OBJECT_LOCK (self);
+    rendition->eos = TRUE;
+    move_tier_clients (self, (gint)rendition->tier);
+    GST_OBJECT_UNLOCK (self);
+  }
+  else if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+    GstBufferList *headers;
+    GstCaps *caps;
+
+    gst_event_parse_caps (event, &caps);
+    if (!gst_srt_base_sink_parse_streamheader (GST_SRT_BASE_SINK (self), caps,
+        &headers)) {
+      gst_event_unref (event);
+      return FALSE;
+    }
+
+    GST_OBJECT_LOCK (self);
+    g_clear_pointer (&rendition->headers, gst_buffer_list_unref);
+    rendition->headers = headers;
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstPad *
+gst_srt_server_sink_request_new_pad (GstElement * element,
+  GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (element);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  SRTRendition *rendition;
+  gchar *pad_name;
+  guint64 tier;
+
+  GST_OBJECT_LOCK (self);
+  if (name != NULL && g_str_has_prefix (name, "sink_")) {
+    tier = g_ascii_strtoull (name + 5, NULL, 10);
+    if (tier == SRT_TIER_TOP || tier > SRT_TIER_BOTTOM
+        || has_tier (priv, (gint)tier)) {
+      GST_OBJECT_UNLOCK (self);
+      GST_WARNING_OBJECT (self, "Invalid or existing pad name %s", name);
+      return NULL;
+    }
+  }
+  else {
+    for (tier = 1; tier <= SRT_TIER_BOTTOM && has_tier (priv, (gint)tier);
+        tier++);
+    if (tier > SRT_TIER_BOTTOM) {
+      GST_OBJECT_UNLOCK (self);
+      GST_WARNING_OBJECT (self, "All %d rendition pads are in use",
+        SRT_TIER_BOTTOM);
+      return NULL;
+    }
+  }
+
+  if (tier >= priv->renditions->len)
+    g_ptr_array_set_size (priv->renditions, tier + 1);
+
+  rendition = g_new0 (SRTRendition, 1);
+  rendition->tier = (guint)tier;
+  gst_srt_key_unit_request_init (&rendition->key_unit);
+  gst_segment_init (&rendition->segment, GST_FORMAT_TIME);
+  pad_name = g_strdup_printf ("sink_%u", rendition->tier);
+  rendition->pad = gst_pad_new_from_template (templ, pad_name);
+  g_free (pad_name);
+  g_ptr_array_index (priv->renditions, tier) = rendition;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_element_private (rendition->pad, rendition);
+  gst_pad_set_chain_function (rendition->pad,
+    GST_DEBUG_FUNCPTR (gst_srt_server_sink_rendition_chain));
+  gst_pad_set_event_function (rendition->pad,
+    GST_DEBUG_FUNCPTR (gst_srt_server_sink_rendition_event));
+  gst_element_add_pad (element, rendition->pad);
+
+  GST_DEBUG_OBJECT (self, "Added rendition tier %u", rendition->tier);
+
+  return rendition->pad;
+}
+
+static void
+gst_srt_server_sink_release_pad (GstElement * element, GstPad * pad)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (element);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  SRTRendition *rendition = gst_pad_get_element_private (pad);
+  gint tier = (gint)rendition->tier;
+
+  GST_OBJECT_LOCK (self);
+  flush_rendition (self, rendition);
+  g_ptr_array_index (priv->renditions, tier) = NULL;
+  move_tier_clients (self, tier);
+  GST_OBJECT_UNLOCK (self);
+
+  /* Waits for a running chain function */
+  gst_element_remove_pad (element, pad);
+  srt_rendition_free (rendition);
+}
+
+static GstStateChangeReturn
+gst_srt_server_sink_change_state (GstElement * element,
+  GstStateChange transition)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (element);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  guint i;
+
+  /* The rendition pads have no GstBaseSink to follow the state for them */
+  GST_OBJECT_LOCK (self);
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      priv->renditions_stopped = FALSE;
+      for (i = SRT_TIER_TOP + 1; i < priv->renditions->len; i++) {
+        SRTRendition *rendition = g_ptr_array_index (priv->renditions, i);
+
+        if (rendition)
+          rendition->eos = FALSE;
+      }
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      priv->renditions_playing = TRUE;
+      break;
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      priv->renditions_playing = FALSE;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      priv->renditions_stopped = TRUE;
+      break;
+    default:
+      break;
+  }
+  wake_renditions (self);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+}
+
+static void
+gst_srt_server_sink_foreach_socket (GstSRTBaseSink * sink,
+  GstSRTSocketFunc func, gpointer user_data)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GList *item;
 
-  priv->cancelled = TRUE;
+  GST_OBJECT_LOCK (sink);
+  for (item = priv->clients; item; item = item->next) {
+    SRTClient *client = item->data;
 
-  return TRUE;
+    func (GST_ELEMENT_CAST (sink), client->sock, client->sockaddr, user_data);
+  }
+  GST_OBJECT_UNLOCK (sink);
 }
 
 static gboolean
-gst_srt_server_sink_unlock_stop (GstBaseSink * sink)
+gst_srt_server_sink_stop (GstBaseSink * sink)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
 
-  priv->cancelled = FALSE;
+  GST_DEBUG_OBJECT (self, "closing SRT connection");
+  /* Waits for a running accept_func */
+  gst_srt_reactor_remove (priv->sock);
+  srt_close (priv->sock);
 
-  return TRUE;
+  GST_OBJECT_LOCK (sink);
+  GST_DEBUG_OBJECT (self, "closing client sockets");
+  g_list_foreach (priv->clients, (GFunc)srt_emit_client_removed, self);
+  g_list_free_full (priv->clients, (GDestroyNotify)srt_client_free);
+  /* async queue doesn't have a foreach, so we have to manually iterate
+   * through it to remove all pending clients */
+  SRTClient *client = g_async_queue_try_pop(priv->pending_clients);
+  while (client != NULL){
+    srt_emit_client_removed(client, self);
+    srt_client_free(client);
+    client = g_async_queue_try_pop(priv->pending_clients);
+  }
+  g_async_queue_unref(priv->pending_clients);
+  g_clear_pointer (&priv->timeshift, gst_srt_timeshift_free);
+  GST_OBJECT_UNLOCK (sink);
+
+  return GST_BASE_SINK_CLASS (parent_class)->stop (sink);
 }
 
 static void
@@ -543,13 +1389,75 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
 
   gobject_class->set_property = gst_srt_server_sink_set_property;
   gobject_class->get_property = gst_srt_server_sink_get_property;
+  gobject_class->finalize = gst_srt_server_sink_finalize;
 
+  /**
+    * GstSRTServerSink:poll-timeout:
+    *
+    * Unused, clients are accepted by the shared SRT reactor. Kept so
+    * existing pipelines still parse.
+    */
   properties[PROP_POLL_TIMEOUT] =
     g_param_spec_int ("poll-timeout", "Poll Timeout",
-      "Return poll wait after timeout miliseconds (-1 = infinite)", -1,
+      "Unused, kept for compatibility (-1 = infinite)", -1,
       G_MAXINT32, SRT_DEFAULT_POLL_TIMEOUT,
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+    * GstSRTServerSink:timeshift-size:
+    *
+    * Size in bytes of a ring keeping the most recent buffers, indexed by
+    * running time and keyframe. A client whose stream ID asks for
+    * "timeshift=N" starts from the keyframe N seconds behind live, or the
+    * oldest one in the ring, and stays that far behind. 0 disables it.
+    */
+  properties[PROP_TIMESHIFT_SIZE] =
+    g_param_spec_uint64 ("timeshift-size", "Timeshift Size",
+      "Size of the timeshift ring in bytes (0 = disabled)", 0, G_MAXUINT64,
+      SRT_DEFAULT_TIMESHIFT_SIZE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSink:timeshift-location:
+    *
+    * File the timeshift ring is mapped from, so a large ring is backed by
+    * the page cache rather than anonymous memory. The file is truncated on
+    * start. Kept in memory if unset.
+    */
+  properties[PROP_TIMESHIFT_LOCATION] =
+    g_param_spec_string ("timeshift-location", "Timeshift Location",
+      "File to map the timeshift ring from (NULL = memory)", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSink:tier-switching:
+    *
+    * With renditions on "sink_%u" request pads, move each client down a
+    * tier when its send backlog or loss grows, and back up once they have
+    * stayed low for a few seconds. Switches happen at keyframes.
+    */
+  properties[PROP_TIER_SWITCHING] =
+    g_param_spec_boolean ("tier-switching", "Tier Switching",
+      "Move clients between the renditions according to their link",
+      SRT_DEFAULT_TIER_SWITCHING,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSink:streamid-passphrases:
+    *
+    * Passphrases of the clients by stream ID, so that one listener serves
+    * viewers with different keys, e.g.
+    * "passphrases, tenant-a=(string)0123456789, tenant-b=(string)abcdefghij".
+    * A "#!::r=tenant-a,..." stream ID is matched by its resource name,
+    * others as a whole. Clients with an unknown stream ID get
+    * #GstSRTBaseSink:passphrase. Needs SRT 1.4.2.
+    */
+  properties[PROP_STREAMID_PASSPHRASES] =
+    g_param_spec_boxed ("streamid-passphrases", "Stream ID Passphrases",
+      "Structure whose fields map stream IDs to passphrases",
+      GST_TYPE_STRUCTURE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
 #if GST_VERSION_MINOR >= 14
   properties[PROP_STATS] = gst_param_spec_array ("stats", "Statistics",
     "Array of GstStructures containing SRT statistics",
@@ -592,19 +1500,27 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
       2, G_TYPE_INT, G_TYPE_SOCKET_ADDRESS);
 
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
+  gst_element_class_add_static_pad_template (gstelement_class,
+    &rendition_template);
   gst_element_class_set_metadata (gstelement_class,
     "SRT server sink", "Sink/Network",
     "Send data over the network via SRT",
     "Justin Kim <justin.kim@collabora.com>");
 
+  gstelement_class->request_new_pad =
+    GST_DEBUG_FUNCPTR (gst_srt_server_sink_request_new_pad);
+  gstelement_class->release_pad =
+    GST_DEBUG_FUNCPTR (gst_srt_server_sink_release_pad);
+  gstelement_class->change_state =
+    GST_DEBUG_FUNCPTR (gst_srt_server_sink_change_state);
+
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_srt_server_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_srt_server_sink_stop);
-  gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_srt_server_sink_unlock);
-  gstbasesink_class->unlock_stop =
-    GST_DEBUG_FUNCPTR (gst_srt_server_sink_unlock_stop);
 
   gstsrtbasesink_class->send_buffer =
     GST_DEBUG_FUNCPTR (gst_srt_server_sink_send_buffer);
+  gstsrtbasesink_class->foreach_socket =
+    GST_DEBUG_FUNCPTR (gst_srt_server_sink_foreach_socket);
 }
 
 static void
@@ -613,4 +1529,17 @@ gst_srt_server_sink_init (GstSRTServerSink * self)
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   priv->poll_timeout = SRT_DEFAULT_POLL_TIMEOUT;
   priv->pending_clients = g_async_queue_new();
+  priv->send_buffer_size = SRT_SEND_BUFFER_SIZE;
+  priv->send_running_time = GST_CLOCK_TIME_NONE;
+  priv->timeshift_size = SRT_DEFAULT_TIMESHIFT_SIZE;
+  priv->tier_switching = SRT_DEFAULT_TIER_SWITCHING;
+  /* Index 0 stands for the always pad */
+  priv->renditions =
+    g_ptr_array_new_with_free_func ((GDestroyNotify)srt_rendition_free);
+  g_ptr_array_set_size (priv->renditions, 1);
+  g_cond_init (&priv->rendition_cond);
+  priv->renditions_stopped = TRUE;
+
+  /* A relative max BW, see gst_srt_server_sink_start */
+  GST_SRT_BASE_SINK (self)->maxbw = 0;
 }
@@ -43,10 +43,15 @@
 
 #include "gstsrtserversrc.h"
 #include "gstsrt.h"
+#include "gstsrttracer.h"
 #include <gio/gio.h>
 
 #define SRT_DEFAULT_WAIT_TIMEOUT -1
 #define SRT_DEFAULT_POLL_TIMEOUT -1
+#define SRT_DEFAULT_FAILOVER_TIMEOUT 500
+#define SRT_DEFAULT_FAILBACK_DELAY 2000
+/* Largest live mode message */
+#define SRT_LIVE_MESSAGE_SIZE 1500
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
   GST_PAD_SRC,
@@ -56,6 +61,27 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
 #define GST_CAT_DEFAULT gst_debug_srt_server_src
 GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 
+enum
+{
+  PUBLISHER_PRIMARY,
+  PUBLISHER_BACKUP,
+  N_PUBLISHERS
+};
+
+static const gchar *publisher_names[N_PUBLISHERS] = { "primary", "backup" };
+
+/* One of the redundant publishers of the failover mode */
+typedef struct
+{
+  SRTSOCKET sock;
+  GSocketAddress *sockaddr;
+  gint last_msg_num;
+  /* monotonic time of the last message, 0 before the first one */
+  gint64 last_recv;
+  /* start of its current run without gaps, 0 if none */
+  gint64 healthy_since;
+} SRTPublisher;
+
 struct _GstSRTServerSrcPrivate
 {
   SRTSOCKET sock;
@@ -69,6 +95,17 @@ struct _GstSRTServerSrcPrivate
 
   gboolean has_client;
   gboolean cancelled;
+
+  gchar *primary_streamid;
+  gchar *backup_streamid;
+  gint failover_timeout;
+  gint failback_delay;
+  SRTPublisher publishers[N_PUBLISHERS];
+  guint active;
+  gboolean discont;
+
+  /* stream ID -> passphrase */
+  GstStructure *streamid_passphrases;
 };
 
 #define GST_SRT_SERVER_SRC_GET_PRIVATE(obj)  \
@@ -78,6 +115,11 @@ enum
 {
   PROP_POLL_TIMEOUT = 1,
   PROP_WAIT_TIMEOUT,
+  PROP_PRIMARY_STREAMID,
+  PROP_BACKUP_STREAMID,
+  PROP_FAILOVER_TIMEOUT,
+  PROP_FAILBACK_DELAY,
+  PROP_STREAMID_PASSPHRASES,
 #if GST_VERSION_MINOR >= 14
   PROP_STATS,
 #endif
@@ -118,10 +160,31 @@ gst_srt_server_src_get_property (GObject * object,
   case PROP_WAIT_TIMEOUT:
     g_value_set_int (value, priv->wait_timeout);
     break;
+  case PROP_PRIMARY_STREAMID:
+    g_value_set_string (value, priv->primary_streamid);
+    break;
+  case PROP_BACKUP_STREAMID:
+    g_value_set_string (value, priv->backup_streamid);
+    break;
+  case PROP_FAILOVER_TIMEOUT:
+    g_value_set_int (value, priv->failover_timeout);
+    break;
+  case PROP_FAILBACK_DELAY:
+    g_value_set_int (value, priv->failback_delay);
+    break;
+  case PROP_STREAMID_PASSPHRASES:
+    gst_value_set_structure (value, priv->streamid_passphrases);
+    break;
 #if GST_VERSION_MINOR >= 14
   case PROP_STATS:
-    g_value_take_boxed (value, gst_srt_base_src_get_stats (priv->sock));
+  {
+    GstStructure *s = gst_srt_base_src_get_stats (priv->client_sock);
+
+    gst_srt_base_src_add_latency_stats (GST_SRT_BASE_SRC (self), s);
+    gst_srt_base_src_add_ts_stats (GST_SRT_BASE_SRC (self), s);
+    g_value_take_boxed (value, s);
     break;
+  }
 #endif
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -143,6 +206,29 @@ gst_srt_server_src_set_property (GObject * object,
   case PROP_WAIT_TIMEOUT:
     priv->wait_timeout = g_value_get_int (value);
     break;
+  case PROP_PRIMARY_STREAMID:
+    g_free (priv->primary_streamid);
+    priv->primary_streamid = g_value_dup_string (value);
+    break;
+  case PROP_BACKUP_STREAMID:
+    g_free (priv->backup_streamid);
+    priv->backup_streamid = g_value_dup_string (value);
+    break;
+  case PROP_FAILOVER_TIMEOUT:
+    priv->failover_timeout = g_value_get_int (value);
+    break;
+  case PROP_FAILBACK_DELAY:
+    priv->failback_delay = g_value_get_int (value);
+    break;
+  case PROP_STREAMID_PASSPHRASES:
+  {
+    const GstStructure *s = gst_value_get_structure (value);
+
+    g_clear_pointer (&priv->streamid_passphrases, gst_structure_free);
+    if (s)
+      priv->streamid_passphrases = gst_structure_copy (s);
+    break;
+  }
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -165,14 +251,339 @@ gst_srt_server_src_finalize (GObject * object)
     priv->sock = SRT_ERROR;
   }
 
+  g_clear_pointer (&priv->primary_streamid, g_free);
+  g_clear_pointer (&priv->backup_streamid, g_free);
+  g_clear_pointer (&priv->streamid_passphrases, gst_structure_free);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static gboolean
+failover_enabled (GstSRTServerSrcPrivate * priv)
+{
+  return priv->backup_streamid != NULL && priv->backup_streamid[0] != '\0';
+}
+
+/* The backup is recognized by its stream ID, the primary by its own or by
+ * any other one if "primary-streamid" is unset. -1 for anybody else */
+static gint
+publisher_slot (GstSRTServerSrcPrivate * priv, const gchar * streamid)
+{
+  if (g_strcmp0 (streamid, priv->backup_streamid) == 0)
+    return PUBLISHER_BACKUP;
+
+  if (priv->primary_streamid == NULL || priv->primary_streamid[0] == '\0'
+      || g_strcmp0 (streamid, priv->primary_streamid) == 0)
+    return PUBLISHER_PRIMARY;
+
+  return -1;
+}
+
+static void
+close_publisher (GstSRTServerSrc * self, guint slot)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  SRTPublisher *pub = &priv->publishers[slot];
+
+  if (pub->sock == SRT_INVALID_SOCK)
+    return;
+
+  g_signal_emit (self, signals[SIG_CLIENT_CLOSED], 0, pub->sock,
+    pub->sockaddr);
+
+  if (priv->poll_id != SRT_ERROR)
+    srt_epoll_remove_usock (priv->poll_id, pub->sock);
+
+  GST_OBJECT_LOCK (self);
+  if (priv->client_sock == pub->sock) {
+    priv->client_sock = SRT_INVALID_SOCK;
+    g_clear_object (&priv->client_sockaddr);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  srt_close (pub->sock);
+  pub->sock = SRT_INVALID_SOCK;
+  g_clear_object (&pub->sockaddr);
+  pub->last_msg_num = 0;
+  pub->last_recv = 0;
+  pub->healthy_since = 0;
+}
+
+/* Connected and delivered within "failover-timeout" */
+static gboolean
+publisher_is_live (GstSRTServerSrc * self, guint slot)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  SRTPublisher *pub = &priv->publishers[slot];
+
+  if (pub->sock == SRT_INVALID_SOCK || pub->last_recv == 0
+      || srt_getsockstate (pub->sock) != SRTS_CONNECTED)
+    return FALSE;
+
+  return g_get_monotonic_time () - pub->last_recv
+    <= (gint64)priv->failover_timeout * 1000;
+}
+
+/* Stats and foreach_socket report the publisher being output */
+static void
+set_active_publisher (GstSRTServerSrc * self, SRTPublisher * pub)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+
+  GST_OBJECT_LOCK (self);
+  g_clear_object (&priv->client_sockaddr);
+  priv->client_sock = pub->sock;
+  if (pub->sockaddr)
+    priv->client_sockaddr = g_object_ref (pub->sockaddr);
+  GST_OBJECT_UNLOCK (self);
+
+  if (pub->sock != SRT_INVALID_SOCK)
+    gst_srt_base_src_set_effective_latency (GST_SRT_BASE_SRC (self),
+      pub->sock);
+}
+
+static void
+accept_publisher (GstSRTServerSrc * self)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  struct sockaddr_storage sa;
+  int sa_len = sizeof (sa);
+  SRTSOCKET sock;
+  SRTPublisher *pub;
+  gchar *streamid;
+  gint slot;
+
+  sock = srt_accept (priv->sock, (struct sockaddr *)&sa, &sa_len);
+  if (sock == SRT_INVALID_SOCK) {
+    GST_WARNING_OBJECT (self,
+      "detected invalid SRT client socket (reason: %s)",
+      srt_getlasterror_str ());
+    srt_clearlasterror ();
+    return;
+  }
+
+  streamid = gst_srt_get_streamid (sock);
+  slot = publisher_slot (priv, streamid);
+  if (slot < 0) {
+    GST_WARNING_OBJECT (self, "Rejecting publisher with stream ID \"%s\"",
+      GST_STR_NULL (streamid));
+    srt_close (sock);
+    g_free (streamid);
+    return;
+  }
+
+  /* A publisher reconnecting replaces its stale connection, but nobody
+   * takes over one that is still delivering */
+  if (publisher_is_live (self, slot)) {
+    GST_WARNING_OBJECT (self, "Rejecting a second %s publisher with stream "
+      "ID \"%s\"", publisher_names[slot], GST_STR_NULL (streamid));
+    srt_close (sock);
+    g_free (streamid);
+    return;
+  }
+  close_publisher (self, slot);
+
+  pub = &priv->publishers[slot];
+  pub->sock = sock;
+  pub->sockaddr = g_socket_address_new_from_native (&sa, sa_len);
+  srt_epoll_add_usock (priv->poll_id, sock,
+    &(int) { SRT_EPOLL_IN | SRT_EPOLL_ERR });
+
+  GST_INFO_OBJECT (self, "%s publisher connected (stream ID \"%s\")",
+    publisher_names[slot], GST_STR_NULL (streamid));
+  g_free (streamid);
+
+  if (slot == priv->active)
+    set_active_publisher (self, pub);
+
+  g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0, pub->sock,
+    pub->sockaddr);
+}
+
+/* Moves the output to the publisher @slot, the next buffer is a DISCONT */
+static void
+switch_publisher (GstSRTServerSrc * self, guint slot)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  SRTPublisher *pub = &priv->publishers[slot];
+
+  GST_WARNING_OBJECT (self, "Switching from the %s to the %s publisher",
+    publisher_names[priv->active], publisher_names[slot]);
+
+  priv->active = slot;
+  priv->discont = TRUE;
+  pub->last_msg_num = 0;
+
+  set_active_publisher (self, pub);
+
+  gst_srt_base_src_reset_latency (GST_SRT_BASE_SRC (self));
+  gst_srt_base_src_request_key_unit (GST_SRT_BASE_SRC (self));
+
+  gst_element_post_message (GST_ELEMENT_CAST (self),
+    gst_message_new_element (GST_OBJECT_CAST (self),
+      gst_structure_new ("application/x-srt-failover",
+        "active", G_TYPE_STRING, publisher_names[slot], NULL)));
+}
+
+/* Fails over to the backup after "failover-timeout" of primary silence,
+ * and back once the primary has been delivering for "failback-delay" */
+static void
+check_failover (GstSRTServerSrc * self)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  SRTPublisher *primary = &priv->publishers[PUBLISHER_PRIMARY];
+  SRTPublisher *backup = &priv->publishers[PUBLISHER_BACKUP];
+  gint64 now = g_get_monotonic_time ();
+  gint64 timeout = (gint64)priv->failover_timeout * 1000;
+
+  if (priv->active == PUBLISHER_PRIMARY) {
+    gboolean silent = primary->sock == SRT_INVALID_SOCK
+      || primary->last_recv == 0 || now - primary->last_recv > timeout;
+
+    if (silent && backup->sock != SRT_INVALID_SOCK && backup->last_recv != 0
+        && now - backup->last_recv <= timeout)
+      switch_publisher (self, PUBLISHER_BACKUP);
+  }
+  else {
+    if (primary->healthy_since != 0
+        && now - primary->last_recv <= timeout
+        && now - primary->healthy_since >= (gint64)priv->failback_delay * 1000)
+      switch_publisher (self, PUBLISHER_PRIMARY);
+    else if (backup->sock == SRT_INVALID_SOCK
+        && primary->sock != SRT_INVALID_SOCK)
+      switch_publisher (self, PUBLISHER_PRIMARY);
+  }
+}
+
+/* fill() of the failover mode: both publishers are read all the time so
+ * that either can take over instantly, only the active one is output */
+static GstFlowReturn
+gst_srt_server_src_fill_failover (GstSRTServerSrc * self, GstBuffer * outbuf)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (self);
+  int poll_timeout = CLAMP (priv->failover_timeout / 4, 1, 100);
+  gint time_waiting = 0;
+
+  while (TRUE) {
+    SRTSOCKET ready[N_PUBLISHERS + 1];
+    int n_ready = G_N_ELEMENTS (ready);
+    int i;
+
+    if (priv->cancelled)
+      return GST_FLOW_FLUSHING;
+
+    check_failover (self);
+
+    if (srt_epoll_wait (priv->poll_id, ready, &n_ready, 0, 0, poll_timeout,
+        0, 0, 0, 0) == SRT_ERROR) {
+      if (srt_getlasterror (NULL) != SRT_ETIMEOUT) {
+        if (priv->cancelled)
+          return GST_FLOW_FLUSHING;
+        GST_ELEMENT_ERROR (self, RESOURCE, FAILED,
+          ("SRT error: %s", srt_getlasterror_str ()), (NULL));
+        return GST_FLOW_ERROR;
+      }
+      srt_clearlasterror ();
+
+      if (priv->publishers[PUBLISHER_PRIMARY].sock == SRT_INVALID_SOCK
+          && priv->publishers[PUBLISHER_BACKUP].sock == SRT_INVALID_SOCK) {
+        time_waiting += poll_timeout;
+        if (priv->wait_timeout >= 0 && priv->wait_timeout < time_waiting) {
+          GST_WARNING_OBJECT (self, "timed out waiting for client");
+          return GST_FLOW_EOS;
+        }
+      }
+      continue;
+    }
+    time_waiting = 0;
+
+    for (i = 0; i < MIN (n_ready, (int)G_N_ELEMENTS (ready)); i++) {
+      SRTPublisher *pub = NULL;
+      SRT_MSGCTRL ctrl = srt_msgctrl_default;
+      GstMapInfo info;
+      gboolean active;
+      gint64 now;
+      guint slot;
+      int len;
+
+      if (ready[i] == priv->sock) {
+        accept_publisher (self);
+        continue;
+      }
+
+      for (slot = 0; slot < N_PUBLISHERS; slot++) {
+        if (priv->publishers[slot].sock == ready[i]) {
+          pub = &priv->publishers[slot];
+          break;
+        }
+      }
+      if (pub == NULL)
+        continue;
+
+      active = slot == priv->active;
+      if (active) {
+        if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
+          GST_ELEMENT_ERROR (self, RESOURCE, WRITE,
+            ("Could not map the output stream"), (NULL));
+          return GST_FLOW_ERROR;
+        }
+        len = srt_recvmsg2 (pub->sock, (char *)info.data, (int)info.size,
+          &ctrl);
+        gst_buffer_unmap (outbuf, &info);
+      }
+      else {
+        char discard[SRT_LIVE_MESSAGE_SIZE];
+
+        len = srt_recvmsg2 (pub->sock, discard, sizeof (discard), &ctrl);
+      }
+
+      if (len <= 0) {
+        GST_WARNING_OBJECT (self, "%s publisher closed: %s",
+          publisher_names[slot], srt_getlasterror_str ());
+        srt_clearlasterror ();
+        close_publisher (self, slot);
+        continue;
+      }
+
+      /* A gap longer than the failover timeout restarts the healthy run */
+      now = g_get_monotonic_time ();
+      if (pub->last_recv == 0 || pub->healthy_since == 0
+          || now - pub->last_recv > (gint64)priv->failover_timeout * 1000)
+        pub->healthy_since = now;
+      pub->last_recv = now;
+
+      if (!active)
+        continue;
+
+      if (pub->last_msg_num != 0 && (ctrl.msgno - pub->last_msg_num) > 1) {
+        GST_WARNING_OBJECT (self, "Dropped %d. %d->%d",
+          ctrl.msgno - pub->last_msg_num - 1, pub->last_msg_num, ctrl.msgno);
+        gst_srt_base_src_request_key_unit (base);
+      }
+      pub->last_msg_num = ctrl.msgno;
+
+      gst_buffer_resize (outbuf, 0, len);
+      GST_BUFFER_PTS (outbuf) =
+        gst_clock_get_time (GST_ELEMENT_CLOCK (self)) -
+        GST_ELEMENT_CAST (self)->base_time;
+      if (priv->discont) {
+        GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+        priv->discont = FALSE;
+      }
+      gst_srt_base_src_record_latency (base, &ctrl);
+
+      return GST_FLOW_OK;
+    }
+  }
+}
+
 static GstFlowReturn
 gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
 {
   GstSRTServerSrc *self = GST_SRT_SERVER_SRC (src);
   GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (src);
   GstFlowReturn ret = GST_FLOW_OK;
   GstMapInfo info;
   SRTSOCKET ready[2];
@@ -180,6 +591,10 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
   struct sockaddr client_sa;
   size_t client_sa_len;
   gint timeWaiting = 0;
+  GstClockTime start;
+
+  if (failover_enabled (priv))
+    return gst_srt_server_src_fill_failover (self, outbuf);
 
   while (!priv->has_client) {
     GST_DEBUG_OBJECT (self, "poll wait (timeout: %d)", priv->poll_timeout);
@@ -225,9 +640,14 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     }
     else {
       priv->has_client = TRUE;
+      gst_srt_base_src_reset_latency (GST_SRT_BASE_SRC (self));
+      GST_OBJECT_LOCK (self);
       g_clear_object (&priv->client_sockaddr);
       priv->client_sockaddr = g_socket_address_new_from_native (&client_sa,
         client_sa_len);
+      GST_OBJECT_UNLOCK (self);
+      gst_srt_base_src_set_effective_latency (GST_SRT_BASE_SRC (self),
+        priv->client_sock);
       g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0,
         priv->client_sock, priv->client_sockaddr);
     }
@@ -244,8 +664,14 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
   }
 
   SRT_MSGCTRL ctrl;
-  recv_len = srt_recvmsg2 (priv->client_sock, (char *)info.data,
-    (int)gst_buffer_get_size (outbuf), &ctrl);
+  start = gst_srt_tracer_now ();
+  if (base->transtype == GST_SRT_TRANSTYPE_FILE)
+    recv_len = srt_recv (priv->client_sock, (char *)info.data,
+      (int)gst_buffer_get_size (outbuf));
+  else
+    recv_len = srt_recvmsg2 (priv->client_sock, (char *)info.data,
+      (int)gst_buffer_get_size (outbuf), &ctrl);
+  gst_srt_tracer_log_recv (GST_ELEMENT_CAST (self), start, recv_len);
 
   gst_buffer_unmap (outbuf, &info);
 
@@ -255,12 +681,15 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     g_signal_emit (self, signals[SIG_CLIENT_CLOSED], 0,
       priv->client_sock, priv->client_sockaddr);
 
+    GST_OBJECT_LOCK (self);
     srt_close (priv->client_sock);
     priv->client_sock = SRT_INVALID_SOCK;
     g_clear_object (&priv->client_sockaddr);
+    GST_OBJECT_UNLOCK (self);
     priv->has_client = FALSE;
     gst_buffer_resize (outbuf, 0, 0);
-    ret = GST_FLOW_OK;
+    /* A file transfer ends with the sender closing the connection */
+    ret = base->transtype == GST_SRT_TRANSTYPE_FILE ? GST_FLOW_EOS : GST_FLOW_OK;
     goto out;
 
   } else if (recv_len == 0) {
@@ -269,11 +698,14 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     goto out;
   }
 
-  if(priv->last_msg_num != 0 && (ctrl.msgno - priv->last_msg_num) > 1) {
-    GST_WARNING_OBJECT(self, "Dropped %d. %d->%d", (ctrl.msgno - priv->last_msg_num),
-      priv->last_msg_num, ctrl.msgno);
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE) {
+    if(priv->last_msg_num != 0 && (ctrl.msgno - priv->last_msg_num) > 1) {
+      GST_WARNING_OBJECT(self, "Dropped %d. %d->%d", (ctrl.msgno - priv->last_msg_num),
+        priv->last_msg_num, ctrl.msgno);
+      gst_srt_base_src_request_key_unit (base);
+    }
+    priv->last_msg_num = ctrl.msgno;
   }
-  priv->last_msg_num = ctrl.msgno;
 
   GST_BUFFER_PTS (outbuf) =
     gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
@@ -281,6 +713,9 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
 
   gst_buffer_resize (outbuf, 0, recv_len);
 
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE)
+    gst_srt_base_src_record_latency (base, &ctrl);
+
   GST_LOG_OBJECT (src,
     "filled buffer from _get of size %" G_GSIZE_FORMAT ", ts %"
     GST_TIME_FORMAT ", dur %" GST_TIME_FORMAT
@@ -294,6 +729,53 @@ out:
   return ret;
 }
 
+#ifdef HAVE_SRT_LISTEN_CALLBACK
+/* Sets the passphrase of the stream ID and the latency cached for the peer
+ * on the socket being accepted, the listener's ones apply otherwise.
+ * Called from an SRT thread */
+static int
+gst_srt_server_src_listen_cb (void *opaque, SRTSOCKET sock, int hs_version,
+  const struct sockaddr *peer_sa, const char *streamid)
+{
+  GstSRTBaseSrc *base = GST_SRT_BASE_SRC (opaque);
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (opaque);
+  const gchar *passphrase =
+    gst_srt_lookup_passphrase (priv->streamid_passphrases, streamid);
+  GSocketAddress *sockaddr;
+  gchar *peer;
+  gint latency;
+  gsize sa_len;
+
+  if (passphrase != NULL && srt_setsockopt (sock, 0, SRTO_PASSPHRASE,
+      passphrase, (int)strlen (passphrase)) == SRT_ERROR) {
+    GST_WARNING_OBJECT (base, "Rejecting \"%s\", invalid passphrase: %s",
+      streamid, srt_getlasterror_str ());
+    return -1;
+  }
+
+  if (!base->auto_latency)
+    return 0;
+
+  if (peer_sa->sa_family == AF_INET)
+    sa_len = sizeof (struct sockaddr_in);
+  else if (peer_sa->sa_family == AF_INET6)
+    sa_len = sizeof (struct sockaddr_in6);
+  else
+    return 0;
+
+  sockaddr = g_socket_address_new_from_native ((gpointer)peer_sa, sa_len);
+  peer = gst_srt_latency_peer_name (sockaddr);
+  latency = gst_srt_base_src_get_latency_for_peer (base, peer);
+  if (latency >= 0)
+    srt_setsockopt (sock, 0, SRTO_RCVLATENCY, &latency, sizeof (int));
+
+  g_free (peer);
+  g_clear_object (&sockaddr);
+
+  return 0;
+}
+#endif
+
 static gboolean
 gst_srt_server_src_start (GstBaseSrc * src)
 {
@@ -313,6 +795,14 @@ gst_srt_server_src_start (GstBaseSrc * src)
     return FALSE;
   }
 
+  /* Messages are needed to follow the publishers and switch between them */
+  if (failover_enabled (priv) && base->transtype != GST_SRT_TRANSTYPE_LIVE) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS,
+      ("The failover mode needs the live transtype"), (NULL));
+    g_clear_pointer (&uri, gst_uri_unref);
+    return FALSE;
+  }
+
   host = gst_uri_get_host (uri);
   if (host == NULL) {
     GInetAddress *any = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
@@ -345,17 +835,21 @@ gst_srt_server_src_start (GstBaseSrc * src)
     goto failed;
   }
 
+  gst_srt_set_transtype (priv->sock, base->transtype);
+
   /* Make SRT server socket non-blocking */
   srt_setsockopt (priv->sock, 0, SRTO_SNDSYN, &(int) {
     0}, sizeof (int));
 
-  /* Make sure TSBPD mode is enable (SRT mode) */
-  srt_setsockopt (priv->sock, 0, SRTO_TSBPDMODE, &(int) {
-    1}, sizeof (int));
+  if (base->transtype == GST_SRT_TRANSTYPE_LIVE) {
+    /* Make sure TSBPD mode is enable (SRT mode) */
+    srt_setsockopt (priv->sock, 0, SRTO_TSBPDMODE, &(int) {
+      1}, sizeof (int));
 
-  /* srt recommends disabling linger */
-  srt_setsockopt (priv->sock, 0, SRTO_LINGER, &(int) {
-    0}, sizeof (int));
+    /* srt recommends disabling linger */
+    srt_setsockopt (priv->sock, 0, SRTO_LINGER, &(int) {
+      0}, sizeof (int));
+  }
 
   /* This is a source, we're always a receiver */
   srt_setsockopt (priv->sock, 0, SRTO_SENDER, &(int) {
@@ -363,12 +857,19 @@ gst_srt_server_src_start (GstBaseSrc * src)
 
   srt_setsockopt (priv->sock, 0, SRTO_TSBPDDELAY, &lat, sizeof (int));
 
-  if (base->passphrase != NULL && base->passphrase[0] != '\0') {
-    srt_setsockopt (priv->sock, 0, SRTO_PASSPHRASE,
-      base->passphrase, (int)strlen (base->passphrase));
-    srt_setsockopt (priv->sock, 0, SRTO_PBKEYLEN,
-      &base->key_length, sizeof (int));
-  }
+  gst_srt_set_encryption (GST_ELEMENT (self), priv->sock, base->passphrase,
+    base->key_length, base->km_refresh_rate, base->km_preannounce);
+
+  if (!gst_srt_set_packet_filter (GST_ELEMENT (self), priv->sock,
+      base->packet_filter))
+    goto failed;
+
+  gst_srt_set_buffer_sizes (GST_ELEMENT (self), priv->sock, FALSE, lat,
+    base->bitrate);
+
+  if (!gst_srt_apply_options (GST_ELEMENT (self), priv->sock, base->profile,
+      base->srt_options))
+    goto failed;
 
   priv->poll_id = srt_epoll_create ();
   if (priv->poll_id == -1) {
@@ -391,7 +892,18 @@ gst_srt_server_src_start (GstBaseSrc * src)
     goto failed;
   }
 
-  if (srt_listen (priv->sock, 1) == SRT_ERROR) {
+#ifdef HAVE_SRT_LISTEN_CALLBACK
+  if (base->auto_latency || priv->streamid_passphrases != NULL)
+    srt_listen_callback (priv->sock, gst_srt_server_src_listen_cb, self);
+#else
+  if (priv->streamid_passphrases != NULL)
+    GST_ELEMENT_WARNING (self, RESOURCE, SETTINGS,
+      ("Per stream ID passphrases need SRT 1.4.2"), (NULL));
+#endif
+
+  /* Both publishers connect at the same time in the failover mode */
+  if (srt_listen (priv->sock, failover_enabled (priv) ? N_PUBLISHERS : 1)
+      == SRT_ERROR) {
     GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ, (NULL),
       ("failed to listen SRT socket (reason: %s)", srt_getlasterror_str ()));
     goto failed;
@@ -428,12 +940,19 @@ gst_srt_server_src_stop (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (self, "stopping SRT server src");
 
+  close_publisher (self, PUBLISHER_PRIMARY);
+  close_publisher (self, PUBLISHER_BACKUP);
+  priv->active = PUBLISHER_PRIMARY;
+  priv->discont = FALSE;
+
   if (priv->client_sock != SRT_INVALID_SOCK) {
     g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0,
       priv->client_sock, priv->client_sockaddr);
+    GST_OBJECT_LOCK (self);
     srt_close (priv->client_sock);
     g_clear_object (&priv->client_sockaddr);
     priv->client_sock = SRT_INVALID_SOCK;
+    GST_OBJECT_UNLOCK (self);
     priv->has_client = FALSE;
   }
 
@@ -468,7 +987,7 @@ gst_srt_server_src_unlock (GstBaseSrc * src)
     priv->poll_id = SRT_ERROR;
   }
 
-  return TRUE;
+  return GST_BASE_SRC_CLASS (parent_class)->unlock (src);
 }
 
 static gboolean
@@ -479,7 +998,21 @@ gst_srt_server_src_unlock_stop (GstBaseSrc * src)
 
   priv->cancelled = FALSE;
 
-  return TRUE;
+  return GST_BASE_SRC_CLASS (parent_class)->unlock_stop (src);
+}
+
+static void
+gst_srt_server_src_foreach_socket (GstSRTBaseSrc * src,
+  GstSRTSocketFunc func, gpointer user_data)
+{
+  GstSRTServerSrc *self = GST_SRT_SERVER_SRC (src);
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+
+  GST_OBJECT_LOCK (self);
+  if (priv->client_sock != SRT_INVALID_SOCK)
+    func (GST_ELEMENT_CAST (src), priv->client_sock, priv->client_sockaddr,
+      user_data);
+  GST_OBJECT_UNLOCK (self);
 }
 
 static void
@@ -489,6 +1022,7 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
   GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_server_src_set_property;
   gobject_class->get_property = gst_srt_server_src_get_property;
@@ -511,6 +1045,73 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
       "Gives up establishing a connection after timeout milliseconds", -1, G_MAXINT32,
       SRT_DEFAULT_POLL_TIMEOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+    * GstSRTServerSrc:primary-streamid:
+    *
+    * Stream ID of the primary publisher in the failover mode. Unset, any
+    * publisher other than the backup is the primary.
+    */
+  properties[PROP_PRIMARY_STREAMID] =
+    g_param_spec_string ("primary-streamid", "Primary Stream ID",
+      "Stream ID of the primary publisher", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSrc:backup-streamid:
+    *
+    * Stream ID of the backup publisher. Setting it enables the failover
+    * mode: the primary and the backup are connected at the same time, the
+    * output follows the primary and switches to the backup after
+    * #GstSRTServerSrc:failover-timeout of primary silence, marking the
+    * first buffer with DISCONT and posting an
+    * "application/x-srt-failover" element message. Only live mode streams
+    * are supported.
+    */
+  properties[PROP_BACKUP_STREAMID] =
+    g_param_spec_string ("backup-streamid", "Backup Stream ID",
+      "Stream ID of the backup publisher, enables the failover", NULL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSrc:failover-timeout:
+    *
+    * How long, in milliseconds, the primary may stay silent before the
+    * output switches to the backup. A publisher that delivered within this
+    * time also keeps its slot against newcomers with the same role.
+    */
+  properties[PROP_FAILOVER_TIMEOUT] =
+    g_param_spec_int ("failover-timeout", "Failover Timeout",
+      "Primary silence in ms before switching to the backup", 1, G_MAXINT32,
+      SRT_DEFAULT_FAILOVER_TIMEOUT,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSrc:failback-delay:
+    *
+    * How long, in milliseconds, the primary must deliver without gaps
+    * before the output switches back to it.
+    */
+  properties[PROP_FAILBACK_DELAY] =
+    g_param_spec_int ("failback-delay", "Failback Delay",
+      "Time in ms the primary must be healthy before switching back to it",
+      0, G_MAXINT32, SRT_DEFAULT_FAILBACK_DELAY,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
+  /**
+    * GstSRTServerSrc:streamid-passphrases:
+    *
+    * Passphrases of the publishers by stream ID, letting one encrypted
+    * listener take streams from several tenants. The fields of the
+    * structure are the stream IDs, or the "r" resource names of "#!::"
+    * stream IDs. Other publishers use #GstSRTBaseSrc:passphrase. Needs
+    * SRT 1.4.2.
+    */
+  properties[PROP_STREAMID_PASSPHRASES] =
+    g_param_spec_boxed ("streamid-passphrases", "Stream ID Passphrases",
+      "Structure whose fields map stream IDs to passphrases",
+      GST_TYPE_STRUCTURE,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
 #if GST_VERSION_MINOR >= 14
   properties[PROP_STATS] = g_param_spec_boxed ("stats", "Statistics",
     "SRT Statistics", GST_TYPE_STRUCTURE,
@@ -562,6 +1163,9 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
     GST_DEBUG_FUNCPTR (gst_srt_server_src_unlock_stop);
 
   gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_server_src_fill);
+
+  gstsrtbasesrc_class->foreach_socket =
+    GST_DEBUG_FUNCPTR (gst_srt_server_src_foreach_socket);
 }
 
 static void
@@ -574,4 +1178,9 @@ gst_srt_server_src_init (GstSRTServerSrc * self)
   priv->poll_id = SRT_ERROR;
   priv->poll_timeout = SRT_DEFAULT_POLL_TIMEOUT;
   priv->wait_timeout = SRT_DEFAULT_WAIT_TIMEOUT;
+  priv->failover_timeout = SRT_DEFAULT_FAILOVER_TIMEOUT;
+  priv->failback_delay = SRT_DEFAULT_FAILBACK_DELAY;
+  priv->publishers[PUBLISHER_PRIMARY].sock = SRT_INVALID_SOCK;
+  priv->publishers[PUBLISHER_BACKUP].sock = SRT_INVALID_SOCK;
+  priv->active = PUBLISHER_PRIMARY;
 }
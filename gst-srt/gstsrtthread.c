@@ -0,0 +1,312 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pins the calling thread to a set of CPUs or a NUMA node and changes its
+ * priority. Used by the threads the elements own, configured by their
+ * properties, and by the shared reactor threads, configured by the
+ * GST_SRT_REACTOR_* environment variables. Threads borrowed from a pool
+ * are saved first and restored when handed back. Only implemented on
+ * Linux, elsewhere a non-default configuration fails. */
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtthread.h"
+
+#include <gio/gio.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct _GstSRTThreadState
+{
+#ifdef __linux__
+  cpu_set_t affinity;
+  gboolean has_affinity;
+  int policy;
+  struct sched_param param;
+  gboolean has_policy;
+  int nice;
+  gboolean has_nice;
+#else
+  gint unused;
+#endif
+};
+
+void
+gst_srt_thread_config_init (GstSRTThreadConfig * config)
+{
+  config->cpus = NULL;
+  config->numa_node = SRT_DEFAULT_NUMA_NODE;
+  config->nice = SRT_DEFAULT_THREAD_NICE;
+  config->rt_priority = SRT_DEFAULT_THREAD_RT_PRIORITY;
+}
+
+void
+gst_srt_thread_config_copy (GstSRTThreadConfig * dest,
+  const GstSRTThreadConfig * src)
+{
+  *dest = *src;
+  dest->cpus = g_strdup (src->cpus);
+}
+
+void
+gst_srt_thread_config_clear (GstSRTThreadConfig * config)
+{
+  g_clear_pointer (&config->cpus, g_free);
+}
+
+gboolean
+gst_srt_thread_config_is_default (const GstSRTThreadConfig * config)
+{
+  return (config->cpus == NULL || config->cpus[0] == '\0')
+    && config->numa_node < 0 && config->nice == SRT_DEFAULT_THREAD_NICE
+    && config->rt_priority == SRT_DEFAULT_THREAD_RT_PRIORITY;
+}
+
+#ifdef __linux__
+/* Adds the CPUs of a list such as "0-3,8" to @set */
+static gboolean
+parse_cpu_list (const gchar * list, cpu_set_t * set, GError ** error)
+{
+  gchar **items = g_strsplit (list, ",", -1);
+  gboolean ret = TRUE;
+  guint i;
+
+  for (i = 0; items[i] && ret; i++) {
+    gchar *item = g_strstrip (items[i]);
+    gchar *end = NULL;
+    guint64 first, last;
+
+    if (item[0] == '\0')
+      continue;
+
+    first = last = g_ascii_strtoull (item, &end, 10);
+    if (end != item && *end == '-') {
+      gchar *start = end + 1;
+      last = g_ascii_strtoull (start, &end, 10);
+      if (end == start)
+        end = item;
+    }
+
+    if (end == item || *end != '\0' || first > last || last >= CPU_SETSIZE) {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "invalid CPU list item \"%s\"", item);
+      ret = FALSE;
+      break;
+    }
+
+    for (; first <= last; first++)
+      CPU_SET (first, set);
+  }
+
+  g_strfreev (items);
+
+  return ret;
+}
+
+static gboolean
+apply_affinity (const GstSRTThreadConfig * config, GError ** error)
+{
+  cpu_set_t set;
+
+  CPU_ZERO (&set);
+
+  if (config->cpus != NULL && config->cpus[0] != '\0'
+      && !parse_cpu_list (config->cpus, &set, error))
+    return FALSE;
+
+  if (config->numa_node >= 0) {
+    gchar *path = g_strdup_printf ("/sys/devices/system/node/node%d/cpulist",
+      config->numa_node);
+    gchar *contents = NULL;
+    cpu_set_t node_set;
+    gboolean ok;
+
+    CPU_ZERO (&node_set);
+    ok = g_file_get_contents (path, &contents, NULL, error)
+      && parse_cpu_list (g_strstrip (contents), &node_set, error);
+    g_free (contents);
+    g_free (path);
+    if (!ok)
+      return FALSE;
+
+    /* The node's CPUs, narrowed down to the CPU list if there is one */
+    if (CPU_COUNT (&set) > 0)
+      CPU_AND (&set, &set, &node_set);
+    else
+      CPU_OR (&set, &set, &node_set);
+  }
+
+  if (CPU_COUNT (&set) == 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+      "no CPU left in the affinity mask");
+    return FALSE;
+  }
+
+  if (sched_setaffinity (0, sizeof (set), &set) != 0) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+      "sched_setaffinity failed: %s", g_strerror (errno));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+#endif
+
+/**
+ * gst_srt_thread_apply:
+ * @config: a #GstSRTThreadConfig
+ * @error: return location for a #GError
+ *
+ * Applies @config to the calling thread.
+ *
+ * Returns: %FALSE if any part of @config could not be applied, e.g. for
+ * lack of privileges for a realtime priority.
+ */
+gboolean
+gst_srt_thread_apply (const GstSRTThreadConfig * config, GError ** error)
+{
+  if (gst_srt_thread_config_is_default (config))
+    return TRUE;
+
+#ifdef __linux__
+  if (((config->cpus != NULL && config->cpus[0] != '\0')
+        || config->numa_node >= 0) && !apply_affinity (config, error))
+    return FALSE;
+
+  if (config->rt_priority > 0) {
+    struct sched_param param = { 0 };
+    int err;
+
+    param.sched_priority = config->rt_priority;
+    err = pthread_setschedparam (pthread_self (), SCHED_FIFO, &param);
+    if (err != 0) {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (err),
+        "failed to set realtime priority %d: %s", config->rt_priority,
+        g_strerror (err));
+      return FALSE;
+    }
+  } else if (config->nice != SRT_DEFAULT_THREAD_NICE) {
+    /* On Linux the nice value is per thread */
+    if (setpriority (PRIO_PROCESS, (id_t)syscall (SYS_gettid),
+        config->nice) != 0) {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "failed to set nice value %d: %s", config->nice, g_strerror (errno));
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+#else
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+    "thread placement and priority are only supported on Linux");
+  return FALSE;
+#endif
+}
+
+/**
+ * gst_srt_thread_save:
+ *
+ * Saves the placement and priority of the calling thread, before
+ * gst_srt_thread_apply() changes them.
+ *
+ * Returns: (transfer full): the state to pass to gst_srt_thread_restore()
+ * on the same thread.
+ */
+GstSRTThreadState *
+gst_srt_thread_save (void)
+{
+  GstSRTThreadState *state = g_new0 (GstSRTThreadState, 1);
+
+#ifdef __linux__
+  state->has_affinity = sched_getaffinity (0, sizeof (state->affinity),
+    &state->affinity) == 0;
+  state->has_policy = pthread_getschedparam (pthread_self (),
+    &state->policy, &state->param) == 0;
+  errno = 0;
+  state->nice = getpriority (PRIO_PROCESS, (id_t)syscall (SYS_gettid));
+  state->has_nice = errno == 0;
+#endif
+
+  return state;
+}
+
+/**
+ * gst_srt_thread_restore:
+ * @state: (transfer full): the state saved by gst_srt_thread_save()
+ * @error: return location for a #GError
+ *
+ * Puts the placement and priority of the calling thread back as they were
+ * saved in @state, and frees it.
+ *
+ * Returns: %FALSE if any part of @state could not be restored, e.g. for
+ * lack of privileges to lower the nice value again.
+ */
+gboolean
+gst_srt_thread_restore (GstSRTThreadState * state, GError ** error)
+{
+  gboolean ret = TRUE;
+
+#ifdef __linux__
+  int err;
+
+  /* Leave the realtime policy first, the nice value is ignored under it.
+   * Everything is tried, the first failure is reported */
+  if (state->has_policy) {
+    err = pthread_setschedparam (pthread_self (), state->policy,
+      &state->param);
+    if (err != 0) {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (err),
+        "failed to restore the scheduling policy: %s", g_strerror (err));
+      ret = FALSE;
+    }
+  }
+
+  if (state->has_nice && setpriority (PRIO_PROCESS,
+      (id_t)syscall (SYS_gettid), state->nice) != 0 && ret) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+      "failed to restore nice value %d: %s", state->nice, g_strerror (errno));
+    ret = FALSE;
+  }
+
+  if (state->has_affinity && sched_setaffinity (0,
+      sizeof (state->affinity), &state->affinity) != 0 && ret) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+      "failed to restore the CPU affinity: %s", g_strerror (errno));
+    ret = FALSE;
+  }
+#endif
+
+  g_free (state);
+
+  return ret;
+}
@@ -0,0 +1,71 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_THREAD_H__
+#define __GST_SRT_THREAD_H__
+
+#include <gst/gst.h>
+
+/* Placement and priority of the shared reactor threads, which don't belong
+ * to any element */
+#define SRT_REACTOR_CPUS_ENV "GST_SRT_REACTOR_CPUS"
+#define SRT_REACTOR_NUMA_NODE_ENV "GST_SRT_REACTOR_NUMA_NODE"
+#define SRT_REACTOR_NICE_ENV "GST_SRT_REACTOR_NICE"
+#define SRT_REACTOR_RT_PRIORITY_ENV "GST_SRT_REACTOR_RT_PRIORITY"
+
+#define SRT_DEFAULT_NUMA_NODE -1
+#define SRT_DEFAULT_THREAD_NICE 0
+#define SRT_DEFAULT_THREAD_RT_PRIORITY 0
+
+G_BEGIN_DECLS
+
+/* Where and how a thread runs, the defaults leave it untouched */
+typedef struct
+{
+  /* CPU list such as "0-3,8" */
+  gchar *cpus;
+  /* restrict to the CPUs of this NUMA node, -1 for any */
+  gint numa_node;
+  /* nice value, -20 to 19 */
+  gint nice;
+  /* SCHED_FIFO priority, 1 to 99, 0 to keep the normal scheduler */
+  gint rt_priority;
+} GstSRTThreadConfig;
+
+/* Placement and priority of a thread before a configuration was applied */
+typedef struct _GstSRTThreadState GstSRTThreadState;
+
+void gst_srt_thread_config_init (GstSRTThreadConfig * config);
+
+void gst_srt_thread_config_copy (GstSRTThreadConfig * dest,
+  const GstSRTThreadConfig * src);
+
+void gst_srt_thread_config_clear (GstSRTThreadConfig * config);
+
+gboolean gst_srt_thread_config_is_default (const GstSRTThreadConfig * config);
+
+gboolean gst_srt_thread_apply (const GstSRTThreadConfig * config,
+  GError ** error);
+
+GstSRTThreadState * gst_srt_thread_save (void);
+
+gboolean gst_srt_thread_restore (GstSRTThreadState * state, GError ** error);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_THREAD_H__ */
@@ -0,0 +1,315 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Time-indexed ring of the most recently sent buffers, so srtserversink
+ * clients can join behind live. The data lives in one contiguous area, in
+ * memory or in a shared mapping of a file, and every buffer is stored
+ * unsplit so it can be sent straight from the ring. The index records the
+ * running time, keyframe flag and position of each buffer, identified by
+ * a sequence number that keeps increasing as old buffers are overwritten. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrttimeshift.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+  GstClockTime running_time;
+  /* position in the data, counted since the first buffer */
+  guint64 offset;
+  gsize size;
+  gboolean keyframe;
+} TimeshiftRecord;
+
+struct _GstSRTTimeshift
+{
+  guint8 *data;
+  gsize size;
+  gboolean mapped;
+
+  /* where the next buffer goes, counted since the first buffer */
+  guint64 write_offset;
+  GstClockTime last_running_time;
+
+  /* circular index, the oldest record at records[first] has the sequence
+   * number first_seqnum */
+  TimeshiftRecord *records;
+  guint records_size;
+  guint first;
+  guint n_records;
+  guint64 first_seqnum;
+};
+
+#define RECORD(ts,i) (&(ts)->records[((ts)->first + (i)) % (ts)->records_size])
+
+/**
+ * gst_srt_timeshift_new:
+ * @size: size of the ring in bytes
+ * @location: (nullable): file to map the ring from, %NULL to keep it in
+ *   memory
+ * @error: return location for a #GError
+ *
+ * Returns: (transfer full) (nullable): a new ring, or %NULL if the file
+ * could not be mapped.
+ */
+GstSRTTimeshift *
+gst_srt_timeshift_new (gsize size, const gchar * location, GError ** error)
+{
+  GstSRTTimeshift *ts = g_new0 (GstSRTTimeshift, 1);
+
+  ts->size = size;
+  ts->last_running_time = GST_CLOCK_TIME_NONE;
+  ts->records_size = 1024;
+  ts->records = g_new (TimeshiftRecord, ts->records_size);
+
+  if (location == NULL || location[0] == '\0') {
+    ts->data = g_malloc (size);
+    return ts;
+  }
+
+#ifdef G_OS_UNIX
+  {
+    int fd = open (location, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    int err;
+
+    if (fd < 0 || ftruncate (fd, (off_t)size) != 0) {
+      err = errno;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (err),
+        "could not create %s: %s", location, g_strerror (err));
+      if (fd >= 0)
+        close (fd);
+      goto failed;
+    }
+
+    ts->data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    err = errno;
+    /* The mapping keeps the file alive */
+    close (fd);
+    if (ts->data == MAP_FAILED) {
+      ts->data = NULL;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (err),
+        "could not map %s: %s", location, g_strerror (err));
+      goto failed;
+    }
+    ts->mapped = TRUE;
+
+    return ts;
+  }
+#else
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+    "file backed timeshift is not supported on this platform");
+#endif
+
+failed:
+  gst_srt_timeshift_free (ts);
+  return NULL;
+}
+
+void
+gst_srt_timeshift_free (GstSRTTimeshift * ts)
+{
+#ifdef G_OS_UNIX
+  if (ts->mapped)
+    munmap (ts->data, ts->size);
+  else
+#endif
+    g_free (ts->data);
+
+  g_free (ts->records);
+  g_free (ts);
+}
+
+static void
+grow_records (GstSRTTimeshift * ts)
+{
+  guint new_size = ts->records_size * 2;
+  TimeshiftRecord *records = g_new (TimeshiftRecord, new_size);
+  guint i;
+
+  for (i = 0; i < ts->n_records; i++)
+    records[i] = *RECORD (ts, i);
+
+  g_free (ts->records);
+  ts->records = records;
+  ts->records_size = new_size;
+  ts->first = 0;
+}
+
+/**
+ * gst_srt_timeshift_push:
+ * @ts: a #GstSRTTimeshift
+ * @running_time: running time of the buffer, or %GST_CLOCK_TIME_NONE to
+ *   reuse the previous one
+ * @keyframe: whether a client can start from this buffer
+ * @data: the buffer data
+ * @size: size of @data
+ *
+ * Appends a buffer to the ring, overwriting the oldest ones.
+ *
+ * Returns: %FALSE if the buffer is larger than the ring.
+ */
+gboolean
+gst_srt_timeshift_push (GstSRTTimeshift * ts, GstClockTime running_time,
+  gboolean keyframe, const guint8 * data, gsize size)
+{
+  gsize pos;
+  guint64 end;
+  TimeshiftRecord *record;
+
+  if (size == 0 || size > ts->size)
+    return FALSE;
+
+  /* Buffers are never split, skip the tail if this one doesn't fit */
+  pos = ts->write_offset % ts->size;
+  if (pos + size > ts->size) {
+    ts->write_offset += ts->size - pos;
+    pos = 0;
+  }
+
+  end = ts->write_offset + size;
+  while (ts->n_records > 0 && end > ts->size
+      && RECORD (ts, 0)->offset < end - ts->size) {
+    ts->first = (ts->first + 1) % ts->records_size;
+    ts->n_records--;
+    ts->first_seqnum++;
+  }
+
+  memcpy (ts->data + pos, data, size);
+
+  if (ts->n_records == ts->records_size)
+    grow_records (ts);
+
+  if (running_time == GST_CLOCK_TIME_NONE)
+    running_time = ts->last_running_time;
+  ts->last_running_time = running_time;
+
+  record = RECORD (ts, ts->n_records);
+  record->running_time = running_time;
+  record->offset = ts->write_offset;
+  record->size = size;
+  record->keyframe = keyframe;
+  ts->n_records++;
+  ts->write_offset = end;
+
+  return TRUE;
+}
+
+/**
+ * gst_srt_timeshift_seek:
+ * @ts: a #GstSRTTimeshift
+ * @running_time: the running time to start from
+ *
+ * Finds the last keyframe at or before @running_time, or the oldest
+ * keyframe if the ring doesn't go back that far.
+ *
+ * Returns: the sequence number of the keyframe, the head of the ring if it
+ * holds no keyframe.
+ */
+guint64
+gst_srt_timeshift_seek (const GstSRTTimeshift * ts, GstClockTime running_time)
+{
+  guint lo = 0, hi = ts->n_records;
+  guint i;
+
+  /* First record after @running_time, running times only increase */
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    GstClockTime t = RECORD (ts, mid)->running_time;
+
+    if (t != GST_CLOCK_TIME_NONE && t > running_time)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  for (i = lo; i > 0; i--) {
+    if (RECORD (ts, i - 1)->keyframe)
+      return ts->first_seqnum + i - 1;
+  }
+
+  for (i = lo; i < ts->n_records; i++) {
+    if (RECORD (ts, i)->keyframe)
+      return ts->first_seqnum + i;
+  }
+
+  return gst_srt_timeshift_get_head (ts);
+}
+
+/**
+ * gst_srt_timeshift_peek:
+ * @ts: a #GstSRTTimeshift
+ * @seqnum: sequence number of a buffer
+ * @size: (out): size of the buffer
+ * @running_time: (out) (optional): running time of the buffer
+ *
+ * Returns: (transfer none) (nullable): the data of the buffer, valid until
+ * the next push, or %NULL if it was overwritten or not pushed yet.
+ */
+const guint8 *
+gst_srt_timeshift_peek (const GstSRTTimeshift * ts, guint64 seqnum,
+  gsize * size, GstClockTime * running_time)
+{
+  const TimeshiftRecord *record;
+
+  if (seqnum < ts->first_seqnum || seqnum >= gst_srt_timeshift_get_head (ts))
+    return NULL;
+
+  record = RECORD (ts, (guint)(seqnum - ts->first_seqnum));
+  *size = record->size;
+  if (running_time)
+    *running_time = record->running_time;
+
+  return ts->data + record->offset % ts->size;
+}
+
+/* Sequence number the next buffer will get */
+guint64
+gst_srt_timeshift_get_head (const GstSRTTimeshift * ts)
+{
+  return ts->first_seqnum + ts->n_records;
+}
+
+/* Running time covered by the ring */
+GstClockTime
+gst_srt_timeshift_get_duration (const GstSRTTimeshift * ts)
+{
+  GstClockTime first, last;
+
+  if (ts->n_records == 0)
+    return 0;
+
+  first = RECORD (ts, 0)->running_time;
+  last = RECORD (ts, ts->n_records - 1)->running_time;
+  if (first == GST_CLOCK_TIME_NONE || last == GST_CLOCK_TIME_NONE
+      || last < first)
+    return 0;
+
+  return last - first;
+}
@@ -0,0 +1,55 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_TIMESHIFT_H__
+#define __GST_SRT_TIMESHIFT_H__
+
+#include <gst/gst.h>
+
+/* 0 disables the timeshift ring */
+#define SRT_DEFAULT_TIMESHIFT_SIZE 0
+/* Stream ID key with the number of seconds a client wants to be behind
+ * live, e.g. "#!::r=live,timeshift=30" */
+#define SRT_STREAMID_TIMESHIFT_KEY "timeshift"
+
+G_BEGIN_DECLS
+
+typedef struct _GstSRTTimeshift GstSRTTimeshift;
+
+GstSRTTimeshift * gst_srt_timeshift_new (gsize size, const gchar * location,
+  GError ** error);
+
+void gst_srt_timeshift_free (GstSRTTimeshift * ts);
+
+gboolean gst_srt_timeshift_push (GstSRTTimeshift * ts,
+  GstClockTime running_time, gboolean keyframe, const guint8 * data,
+  gsize size);
+
+guint64 gst_srt_timeshift_seek (const GstSRTTimeshift * ts,
+  GstClockTime running_time);
+
+const guint8 * gst_srt_timeshift_peek (const GstSRTTimeshift * ts,
+  guint64 seqnum, gsize * size, GstClockTime * running_time);
+
+guint64 gst_srt_timeshift_get_head (const GstSRTTimeshift * ts);
+
+GstClockTime gst_srt_timeshift_get_duration (const GstSRTTimeshift * ts);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_TIMESHIFT_H__ */
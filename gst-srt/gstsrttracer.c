@@ -0,0 +1,212 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+ /**
+ * SECTION:tracer-srttracer
+ * @title: srttracer
+ *
+ * Logs the timing of the SRT elements' hot paths, so that a latency spike
+ * can be attributed without rebuilding with debug logging:
+ *
+ * srt-send / srt-recv: time blocked in srt_sendmsg2() / srt_recvmsg2().
+ *
+ * srt-lock: time spent waiting for and holding the object lock while
+ * srtserversink sends a buffer to all its clients.
+ *
+ * srt-accept: every client srtserversink accepts from the reactor, with the
+ * depth of the queue of clients waiting to get their first buffer.
+ *
+ * srt-pending: the depth of that queue when the streaming thread drains it.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * GST_TRACERS="srttracer" GST_DEBUG="GST_TRACER:7" gst-launch-1.0 ... ! srtserversink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrttracer.h"
+
+/* Number of running srttracer instances */
+static gint tracers_active;
+
+#if GST_VERSION_MINOR >= 8
+static GstTracerRecord *tr_send;
+static GstTracerRecord *tr_recv;
+static GstTracerRecord *tr_lock;
+static GstTracerRecord *tr_accept;
+static GstTracerRecord *tr_pending;
+
+#define gst_srt_tracer_parent_class parent_class
+G_DEFINE_TYPE (GstSRTTracer, gst_srt_tracer, GST_TYPE_TRACER);
+
+static GstStructure *
+element_field (void)
+{
+  return gst_structure_new ("value",
+    "type", G_TYPE_GTYPE, G_TYPE_STRING,
+    "description", G_TYPE_STRING, "name of the element",
+    "related-to", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_ELEMENT,
+    NULL);
+}
+
+static GstStructure *
+value_field (GType type, const gchar * description)
+{
+  return gst_structure_new ("value",
+    "type", G_TYPE_GTYPE, type,
+    "description", G_TYPE_STRING, description, NULL);
+}
+
+static void
+gst_srt_tracer_finalize (GObject * object)
+{
+  g_atomic_int_add (&tracers_active, -1);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_srt_tracer_class_init (GstSRTTracerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gst_srt_tracer_finalize;
+
+  tr_send = gst_tracer_record_new ("srt-send.class",
+    "element", element_field (),
+    "ts", value_field (G_TYPE_UINT64, "time of the call"),
+    "blocked", value_field (G_TYPE_UINT64, "time blocked in srt_sendmsg2"),
+    "bytes", value_field (G_TYPE_UINT, "size of the message"), NULL);
+  tr_recv = gst_tracer_record_new ("srt-recv.class",
+    "element", element_field (),
+    "ts", value_field (G_TYPE_UINT64, "time of the call"),
+    "blocked", value_field (G_TYPE_UINT64, "time blocked in srt_recvmsg2"),
+    "bytes", value_field (G_TYPE_INT, "size of the message"), NULL);
+  tr_lock = gst_tracer_record_new ("srt-lock.class",
+    "element", element_field (),
+    "ts", value_field (G_TYPE_UINT64, "time the lock was requested"),
+    "wait", value_field (G_TYPE_UINT64, "time waiting for the lock"),
+    "held", value_field (G_TYPE_UINT64, "time the lock was held"),
+    "clients", value_field (G_TYPE_UINT, "clients sent to"), NULL);
+  tr_accept = gst_tracer_record_new ("srt-accept.class",
+    "element", element_field (),
+    "ts", value_field (G_TYPE_UINT64, "time of the wakeup"),
+    "accepted", value_field (G_TYPE_BOOLEAN, "a client was accepted"),
+    "pending", value_field (G_TYPE_UINT, "clients waiting to be added"),
+    NULL);
+  tr_pending = gst_tracer_record_new ("srt-pending.class",
+    "element", element_field (),
+    "ts", value_field (G_TYPE_UINT64, "time of the check"),
+    "pending", value_field (G_TYPE_UINT, "clients waiting to be added"),
+    NULL);
+#if GST_VERSION_MINOR >= 10
+  GST_OBJECT_FLAG_SET (tr_send, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+  GST_OBJECT_FLAG_SET (tr_recv, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+  GST_OBJECT_FLAG_SET (tr_lock, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+  GST_OBJECT_FLAG_SET (tr_accept, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+  GST_OBJECT_FLAG_SET (tr_pending, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+#endif
+}
+
+static void
+gst_srt_tracer_init (GstSRTTracer * self)
+{
+  g_atomic_int_inc (&tracers_active);
+}
+#endif
+
+GstClockTime
+gst_srt_tracer_now (void)
+{
+  if (G_LIKELY (g_atomic_int_get (&tracers_active) == 0))
+    return GST_CLOCK_TIME_NONE;
+
+  return gst_util_get_timestamp ();
+}
+
+#if GST_VERSION_MINOR >= 8
+#define LOG_RECORD(record, elem, ...) G_STMT_START {          \
+    gchar *name = gst_element_get_name (elem);                \
+    gst_tracer_record_log (record, name, __VA_ARGS__);        \
+    g_free (name);                                            \
+  } G_STMT_END
+#else
+#define LOG_RECORD(record, elem, ...) G_STMT_START { } G_STMT_END
+#endif
+
+void
+gst_srt_tracer_log_send (GstElement * elem, GstClockTime start, gsize bytes)
+{
+  if (start == GST_CLOCK_TIME_NONE)
+    return;
+
+  LOG_RECORD (tr_send, elem, start, gst_util_get_timestamp () - start,
+    (guint)bytes);
+}
+
+void
+gst_srt_tracer_log_recv (GstElement * elem, GstClockTime start, gint bytes)
+{
+  if (start == GST_CLOCK_TIME_NONE)
+    return;
+
+  LOG_RECORD (tr_recv, elem, start, gst_util_get_timestamp () - start,
+    bytes);
+}
+
+void
+gst_srt_tracer_log_lock (GstElement * elem, GstClockTime start,
+  GstClockTime acquired, guint clients)
+{
+  if (start == GST_CLOCK_TIME_NONE || acquired == GST_CLOCK_TIME_NONE)
+    return;
+
+  LOG_RECORD (tr_lock, elem, start, acquired - start,
+    gst_util_get_timestamp () - acquired, clients);
+}
+
+void
+gst_srt_tracer_log_accept (GstElement * elem, gboolean accepted,
+  GAsyncQueue * pending)
+{
+  GstClockTime now = gst_srt_tracer_now ();
+
+  if (now == GST_CLOCK_TIME_NONE)
+    return;
+
+  LOG_RECORD (tr_accept, elem, now, accepted,
+    (guint)MAX (g_async_queue_length (pending), 0));
+}
+
+void
+gst_srt_tracer_log_pending (GstElement * elem, GAsyncQueue * pending)
+{
+  GstClockTime now = gst_srt_tracer_now ();
+
+  if (now == GST_CLOCK_TIME_NONE)
+    return;
+
+  LOG_RECORD (tr_pending, elem, now,
+    (guint)MAX (g_async_queue_length (pending), 0));
+}
@@ -0,0 +1,65 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_TRACER_H__
+#define __GST_SRT_TRACER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#if GST_VERSION_MINOR >= 8
+#define GST_TYPE_SRT_TRACER            (gst_srt_tracer_get_type ())
+#define GST_SRT_TRACER(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_SRT_TRACER, GstSRTTracer))
+#define GST_IS_SRT_TRACER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_SRT_TRACER))
+
+typedef struct _GstSRTTracer GstSRTTracer;
+typedef struct _GstSRTTracerClass GstSRTTracerClass;
+
+struct _GstSRTTracer {
+  GstTracer parent;
+};
+
+struct _GstSRTTracerClass {
+  GstTracerClass parent_class;
+};
+
+GType gst_srt_tracer_get_type (void);
+#endif
+
+/* Returns GST_CLOCK_TIME_NONE unless a srttracer is running, so that the
+ * elements only pay for a clock read when tracing */
+GstClockTime gst_srt_tracer_now (void);
+
+void gst_srt_tracer_log_send (GstElement * elem, GstClockTime start,
+  gsize bytes);
+
+void gst_srt_tracer_log_recv (GstElement * elem, GstClockTime start,
+  gint bytes);
+
+void gst_srt_tracer_log_lock (GstElement * elem, GstClockTime start,
+  GstClockTime acquired, guint clients);
+
+void gst_srt_tracer_log_accept (GstElement * elem, gboolean accepted,
+  GAsyncQueue * pending);
+
+void gst_srt_tracer_log_pending (GstElement * elem, GAsyncQueue * pending);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_TRACER_H__ */
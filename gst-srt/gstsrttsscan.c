@@ -0,0 +1,503 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Checks the alignment and continuity of the MPEG-TS carried by a source.
+ *
+ * The 4 byte headers of a run of packets are decoded at once with SSE2,
+ * AVX2 or NEON when the build targets them, which validates the sync bytes
+ * and extracts the PID, continuity counter and flags of every packet. The
+ * counters are then checked one packet at a time, as each depends on the
+ * previous packet of the same PID. When the alignment is lost the next
+ * sync byte is searched with the same vector units.
+ *
+ * A gap in the counters of a PID is reported as the number of packets it
+ * skipped, modulo 16: larger holes are only partially accounted for.
+ *
+ * The padding of CBR streams can also be left out of the messages: a
+ * message with null packets is sent as
+ *
+ *   SRT_TS_NULL_STRIP_TAG, number of packets N, ceil(N / 8) bytes of
+ *   bitmap with bit i set when packet i was a null packet, the other
+ *   packets
+ *
+ * and the receiver puts null packets back in place. Messages without null
+ * packets are sent as they are. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrttsscan.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SRT_TS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SRT_TS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SRT_TS_NEON 1
+#endif
+
+/* Headers decoded in one go */
+#define SRT_TS_BATCH 8
+
+/* Continuity counter markers of a PID */
+#define SRT_TS_CC_UNKNOWN 0xff
+#define SRT_TS_CC_RESYNC 0xfe
+
+/* The header of a packet as a word: the PID in bits 0-12, the continuity
+ * counter in bits 16-19, the payload and adaptation field flags in bits 20
+ * and 21 and the transport error indicator in bit 22. @h is the header
+ * read as a little endian word. */
+#define TS_HEADER_INFO(h) \
+  (((h) & 0x1f00) | (((h) >> 16) & 0xff) | (((h) >> 8) & 0x3f0000) | \
+   (((h) << 7) & 0x400000))
+
+#define TS_INFO_PID(i) ((i) & 0x1fff)
+#define TS_INFO_CC(i) (((i) >> 16) & 0xf)
+#define TS_INFO_HAS_PAYLOAD(i) ((i) & (1 << 20))
+#define TS_INFO_HAS_ADAPTATION(i) ((i) & (1 << 21))
+#define TS_INFO_TRANSPORT_ERROR(i) ((i) & (1 << 22))
+
+static inline guint32
+ts_header_word (const guint8 * p)
+{
+  return (guint32) p[0] | (guint32) p[1] << 8 | (guint32) p[2] << 16 |
+    (guint32) p[3] << 24;
+}
+
+/* Decodes the headers of the @n packets at @data into @info, returns a
+ * mask of the packets starting with a sync byte */
+static guint
+decode_headers (const guint8 * data, guint n, guint32 * info)
+{
+  guint mask = 0;
+  guint i = 0;
+
+#define P(k) ((gint) ts_header_word (data + (i + (k)) * SRT_TS_PACKET_SIZE))
+#if defined(SRT_TS_AVX2)
+  for (; i + 8 <= n; i += 8) {
+    __m256i h = _mm256_setr_epi32 (P (0), P (1), P (2), P (3), P (4), P (5),
+      P (6), P (7));
+    __m256i v = _mm256_or_si256 (
+      _mm256_or_si256 (_mm256_and_si256 (h, _mm256_set1_epi32 (0x1f00)),
+        _mm256_and_si256 (_mm256_srli_epi32 (h, 16),
+          _mm256_set1_epi32 (0xff))),
+      _mm256_or_si256 (_mm256_and_si256 (_mm256_srli_epi32 (h, 8),
+          _mm256_set1_epi32 (0x3f0000)),
+        _mm256_and_si256 (_mm256_slli_epi32 (h, 7),
+          _mm256_set1_epi32 (0x400000))));
+    __m256i sync = _mm256_cmpeq_epi32 (_mm256_and_si256 (h,
+        _mm256_set1_epi32 (0xff)), _mm256_set1_epi32 (SRT_TS_SYNC_BYTE));
+
+    _mm256_storeu_si256 ((__m256i *) (info + i), v);
+    mask |= (guint) _mm256_movemask_ps (_mm256_castsi256_ps (sync)) << i;
+  }
+#elif defined(SRT_TS_SSE2)
+  for (; i + 4 <= n; i += 4) {
+    __m128i h = _mm_setr_epi32 (P (0), P (1), P (2), P (3));
+    __m128i v = _mm_or_si128 (
+      _mm_or_si128 (_mm_and_si128 (h, _mm_set1_epi32 (0x1f00)),
+        _mm_and_si128 (_mm_srli_epi32 (h, 16), _mm_set1_epi32 (0xff))),
+      _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 (h, 8),
+          _mm_set1_epi32 (0x3f0000)),
+        _mm_and_si128 (_mm_slli_epi32 (h, 7), _mm_set1_epi32 (0x400000))));
+    __m128i sync = _mm_cmpeq_epi32 (_mm_and_si128 (h, _mm_set1_epi32 (0xff)),
+      _mm_set1_epi32 (SRT_TS_SYNC_BYTE));
+
+    _mm_storeu_si128 ((__m128i *) (info + i), v);
+    mask |= (guint) _mm_movemask_ps (_mm_castsi128_ps (sync)) << i;
+  }
+#elif defined(SRT_TS_NEON)
+  for (; i + 4 <= n; i += 4) {
+    static const guint32 lanes[4] = { 1, 2, 4, 8 };
+    const guint32 words[4] = { P (0), P (1), P (2), P (3) };
+    uint32x4_t h = vld1q_u32 (words);
+    uint32x4_t v = vorrq_u32 (
+      vorrq_u32 (vandq_u32 (h, vdupq_n_u32 (0x1f00)),
+        vandq_u32 (vshrq_n_u32 (h, 16), vdupq_n_u32 (0xff))),
+      vorrq_u32 (vandq_u32 (vshrq_n_u32 (h, 8), vdupq_n_u32 (0x3f0000)),
+        vandq_u32 (vshlq_n_u32 (h, 7), vdupq_n_u32 (0x400000))));
+    uint32x4_t sync = vceqq_u32 (vandq_u32 (h, vdupq_n_u32 (0xff)),
+      vdupq_n_u32 (SRT_TS_SYNC_BYTE));
+
+    vst1q_u32 (info + i, v);
+    mask |= vaddvq_u32 (vandq_u32 (sync, vld1q_u32 (lanes))) << i;
+  }
+#endif
+#undef P
+
+  for (; i < n; i++) {
+    guint32 h = ts_header_word (data + i * SRT_TS_PACKET_SIZE);
+
+    info[i] = TS_HEADER_INFO (h);
+    if ((h & 0xff) == SRT_TS_SYNC_BYTE)
+      mask |= 1 << i;
+  }
+
+  return mask;
+}
+
+/* Offset of the first sync byte in @data, @size if there is none */
+static gsize
+find_sync_byte (const guint8 * data, gsize size)
+{
+  gsize i = 0;
+
+#if defined(SRT_TS_AVX2)
+  for (; i + 32 <= size; i += 32) {
+    __m256i b = _mm256_loadu_si256 ((const __m256i *) (data + i));
+    guint32 mask = (guint32) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (b,
+            _mm256_set1_epi8 (SRT_TS_SYNC_BYTE)));
+
+    if (mask != 0)
+      return i + g_bit_nth_lsf (mask, -1);
+  }
+#elif defined(SRT_TS_SSE2)
+  for (; i + 16 <= size; i += 16) {
+    __m128i b = _mm_loadu_si128 ((const __m128i *) (data + i));
+    guint mask = (guint) _mm_movemask_epi8 (_mm_cmpeq_epi8 (b,
+            _mm_set1_epi8 (SRT_TS_SYNC_BYTE)));
+
+    if (mask != 0)
+      return i + g_bit_nth_lsf (mask, -1);
+  }
+#elif defined(SRT_TS_NEON)
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t eq = vceqq_u8 (vld1q_u8 (data + i),
+      vdupq_n_u8 (SRT_TS_SYNC_BYTE));
+
+    if (vmaxvq_u8 (eq) != 0)
+      break;
+  }
+#endif
+
+  for (; i < size; i++) {
+    if (data[i] == SRT_TS_SYNC_BYTE)
+      break;
+  }
+
+  return i;
+}
+
+/* Position of the next packet from @pos. A payload byte may look like a
+ * sync byte, so the packet after it must start with one too. */
+static gsize
+resync (const guint8 * data, gsize pos, gsize size)
+{
+  while (pos < size) {
+    pos += find_sync_byte (data + pos, size - pos);
+    if (pos + SRT_TS_PACKET_SIZE >= size
+        || data[pos + SRT_TS_PACKET_SIZE] == SRT_TS_SYNC_BYTE)
+      return pos;
+    pos++;
+  }
+
+  return size;
+}
+
+static void
+check_packet (GstSRTTsScanner * scanner, guint32 info, const guint8 * packet)
+{
+  guint pid = TS_INFO_PID (info);
+  guint cc = TS_INFO_CC (info);
+  guint last, expected;
+
+  scanner->packets++;
+
+  /* Nothing in the header can be trusted */
+  if (TS_INFO_TRANSPORT_ERROR (info)) {
+    scanner->transport_errors++;
+    return;
+  }
+
+  if (pid == SRT_TS_NULL_PID)
+    return;
+
+  last = scanner->cc[pid];
+  if (last == SRT_TS_CC_UNKNOWN)
+    scanner->pids++;
+
+  /* A new PID, or one whose continuity was broken on purpose by the
+   * discontinuity indicator of the adaptation field */
+  if (last >= SRT_TS_CC_RESYNC || (TS_INFO_HAS_ADAPTATION (info)
+          && packet[4] > 0 && (packet[5] & 0x80))) {
+    scanner->cc[pid] = cc;
+    return;
+  }
+
+  /* The counter only moves with a payload */
+  if (!TS_INFO_HAS_PAYLOAD (info))
+    return;
+
+  expected = (last + 1) & 0xf;
+  if (cc == last) {
+    scanner->duplicate_packets++;
+  } else if (cc != expected) {
+    scanner->cc_errors++;
+    scanner->lost_packets += (cc - expected) & 0xf;
+  }
+  scanner->cc[pid] = cc;
+}
+
+void
+gst_srt_ts_scanner_reset (GstSRTTsScanner * scanner)
+{
+  memset (scanner, 0, sizeof (*scanner));
+  memset (scanner->cc, SRT_TS_CC_UNKNOWN, sizeof (scanner->cc));
+}
+
+/**
+ * gst_srt_ts_scanner_discont:
+ * @scanner: a #GstSRTTsScanner
+ *
+ * Forgets the continuity state, when the stream is known to jump, e.g.
+ * after switching to another sender. The counters are kept.
+ */
+void
+gst_srt_ts_scanner_discont (GstSRTTsScanner * scanner)
+{
+  guint i;
+
+  for (i = 0; i < SRT_TS_N_PIDS; i++) {
+    if (scanner->cc[i] != SRT_TS_CC_UNKNOWN)
+      scanner->cc[i] = SRT_TS_CC_RESYNC;
+  }
+  scanner->partial_len = 0;
+}
+
+/**
+ * gst_srt_ts_scanner_scan:
+ * @scanner: a #GstSRTTsScanner
+ * @data: the received bytes
+ * @size: the size of @data
+ *
+ * Checks the packets of a received message.
+ */
+void
+gst_srt_ts_scanner_scan (GstSRTTsScanner * scanner, const guint8 * data,
+  gsize size)
+{
+  guint32 info[SRT_TS_BATCH];
+  gsize pos = 0;
+
+  /* A message whose null packets were stripped, check the others. Those
+   * are always whole packets. */
+  if (gst_srt_ts_restored_size (data, size) > 0) {
+    guint n = data[1];
+    gsize offset = 2 + (n + 7) / 8;
+
+    scanner->packets += n - (size - offset) / SRT_TS_PACKET_SIZE;
+    data += offset;
+    size -= offset;
+  }
+
+  /* The packet split by the previous message */
+  if (scanner->partial_len > 0) {
+    gsize need = SRT_TS_PACKET_SIZE - scanner->partial_len;
+
+    if (size < need) {
+      memcpy (scanner->partial + scanner->partial_len, data, size);
+      scanner->partial_len += size;
+      return;
+    }
+
+    if (size == need || data[need] == SRT_TS_SYNC_BYTE) {
+      memcpy (scanner->partial + scanner->partial_len, data, need);
+      decode_headers (scanner->partial, 1, info);
+      check_packet (scanner, info[0], scanner->partial);
+      pos = need;
+    } else {
+      /* Something was lost in between */
+      scanner->sync_errors++;
+    }
+    scanner->partial_len = 0;
+  }
+
+  while (pos + SRT_TS_PACKET_SIZE <= size) {
+    guint n = MIN (SRT_TS_BATCH, (size - pos) / SRT_TS_PACKET_SIZE);
+    guint synced = decode_headers (data + pos, n, info);
+    guint i;
+
+    for (i = 0; i < n && (synced & (1 << i)); i++)
+      check_packet (scanner, info[i], data + pos + i * SRT_TS_PACKET_SIZE);
+    pos += i * SRT_TS_PACKET_SIZE;
+
+    if (i < n) {
+      scanner->sync_errors++;
+      pos = resync (data, pos + 1, size);
+    }
+  }
+
+  if (pos < size) {
+    if (data[pos] == SRT_TS_SYNC_BYTE) {
+      memcpy (scanner->partial, data + pos, size - pos);
+      scanner->partial_len = size - pos;
+    } else {
+      scanner->sync_errors++;
+    }
+  }
+}
+
+/**
+ * gst_srt_ts_scanner_add_to_structure:
+ * @scanner: a #GstSRTTsScanner
+ * @s: the statistics structure to fill
+ *
+ * Adds the "ts-*" fields to @s.
+ */
+void
+gst_srt_ts_scanner_add_to_structure (const GstSRTTsScanner * scanner,
+  GstStructure * s)
+{
+  gst_structure_set (s,
+    "ts-packets", G_TYPE_UINT64, scanner->packets,
+    "ts-pids", G_TYPE_UINT64, scanner->pids,
+    "ts-sync-errors", G_TYPE_UINT64, scanner->sync_errors,
+    "ts-cc-errors", G_TYPE_UINT64, scanner->cc_errors,
+    "ts-lost-packets", G_TYPE_UINT64, scanner->lost_packets,
+    "ts-duplicate-packets", G_TYPE_UINT64, scanner->duplicate_packets,
+    "ts-transport-errors", G_TYPE_UINT64, scanner->transport_errors, NULL);
+}
+
+/* Stripped message of @n packets, @n_null of them null packets */
+#define SRT_TS_STRIPPED_SIZE(n, n_null) \
+  (2 + ((n) + 7) / 8 + ((n) - (n_null)) * SRT_TS_PACKET_SIZE)
+
+/**
+ * gst_srt_ts_strip_null_packets:
+ * @data: a message of whole TS packets
+ * @size: the size of @data
+ * @out: where to write the stripped message, of at least @size bytes
+ *
+ * Returns: the size of the stripped message, 0 if @data has no null
+ * packets or is not a run of TS packets and must be sent as is.
+ */
+gsize
+gst_srt_ts_strip_null_packets (const guint8 * data, gsize size, guint8 * out)
+{
+  guint32 info[SRT_TS_BATCH];
+  guint8 *bitmap = out + 2;
+  guint8 *p;
+  guint n, n_null = 0;
+  guint i, j;
+
+  n = size / SRT_TS_PACKET_SIZE;
+  if (n == 0 || n > G_MAXUINT8 || size % SRT_TS_PACKET_SIZE != 0)
+    return 0;
+
+  memset (bitmap, 0, (n + 7) / 8);
+  for (i = 0; i < n; i += SRT_TS_BATCH) {
+    guint batch = MIN (SRT_TS_BATCH, n - i);
+    guint synced = decode_headers (data + i * SRT_TS_PACKET_SIZE, batch, info);
+
+    if (synced != (1u << batch) - 1)
+      return 0;
+
+    for (j = 0; j < batch; j++) {
+      if (TS_INFO_PID (info[j]) == SRT_TS_NULL_PID) {
+        bitmap[(i + j) / 8] |= 1 << ((i + j) % 8);
+        n_null++;
+      }
+    }
+  }
+
+  if (n_null == 0)
+    return 0;
+
+  out[0] = SRT_TS_NULL_STRIP_TAG;
+  out[1] = n;
+  p = bitmap + (n + 7) / 8;
+  for (i = 0; i < n; i++) {
+    if (bitmap[i / 8] & (1 << (i % 8)))
+      continue;
+    memcpy (p, data + i * SRT_TS_PACKET_SIZE, SRT_TS_PACKET_SIZE);
+    p += SRT_TS_PACKET_SIZE;
+  }
+
+  return p - out;
+}
+
+/**
+ * gst_srt_ts_restored_size:
+ * @data: a received message
+ * @size: the size of @data
+ *
+ * Returns: the size of @data once its null packets are restored, 0 if it
+ * is not a stripped message.
+ */
+gsize
+gst_srt_ts_restored_size (const guint8 * data, gsize size)
+{
+  guint n, n_null = 0;
+  guint i;
+
+  if (size < 3 || data[0] != SRT_TS_NULL_STRIP_TAG || data[1] == 0)
+    return 0;
+
+  n = data[1];
+  if (size < 2 + (n + 7) / 8)
+    return 0;
+
+  for (i = 0; i < n; i++) {
+    if (data[2 + i / 8] & (1 << (i % 8)))
+      n_null++;
+  }
+
+  if (size != SRT_TS_STRIPPED_SIZE (n, n_null))
+    return 0;
+
+  return n * SRT_TS_PACKET_SIZE;
+}
+
+/**
+ * gst_srt_ts_restore_null_packets:
+ * @data: a stripped message
+ * @size: the size of @data
+ * @out: where to write the packets, of gst_srt_ts_restored_size() bytes
+ *
+ * Puts the null packets of a stripped message back in place.
+ */
+void
+gst_srt_ts_restore_null_packets (const guint8 * data, gsize size,
+  guint8 * out)
+{
+  const guint8 *bitmap = data + 2;
+  const guint8 *p;
+  guint n = data[1];
+  guint i;
+
+  p = bitmap + (n + 7) / 8;
+  for (i = 0; i < n; i++, out += SRT_TS_PACKET_SIZE) {
+    if (bitmap[i / 8] & (1 << (i % 8))) {
+      /* PID 0x1fff, payload only, stuffed with 0xff */
+      memset (out, 0xff, SRT_TS_PACKET_SIZE);
+      out[0] = SRT_TS_SYNC_BYTE;
+      out[1] = 0x1f;
+      out[3] = 0x10;
+    } else {
+      memcpy (out, p, SRT_TS_PACKET_SIZE);
+      p += SRT_TS_PACKET_SIZE;
+    }
+  }
+}
@@ -0,0 +1,74 @@
+/* GStreamer SRT plugin based on libsrt
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_TS_SCAN_H__
+#define __GST_SRT_TS_SCAN_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define SRT_TS_PACKET_SIZE 188
+#define SRT_TS_SYNC_BYTE 0x47
+#define SRT_TS_NULL_PID 0x1fff
+#define SRT_TS_N_PIDS 8192
+#define SRT_DEFAULT_TS_CHECK FALSE
+#define SRT_DEFAULT_NULL_PACKETS FALSE
+/* First byte of a message whose null packets were stripped, in place of
+ * the sync byte */
+#define SRT_TS_NULL_STRIP_TAG 0xb8
+
+/* Continuity state of an MPEG-TS stream, counting what was lost on the
+ * way. Messages may split packets, the tail of one is kept for the next. */
+typedef struct
+{
+  /* last continuity counter per PID, or a marker above 0xf */
+  guint8 cc[SRT_TS_N_PIDS];
+  guint8 partial[SRT_TS_PACKET_SIZE];
+  gsize partial_len;
+
+  guint64 packets;
+  guint64 pids;
+  guint64 sync_errors;
+  guint64 cc_errors;
+  guint64 lost_packets;
+  guint64 duplicate_packets;
+  guint64 transport_errors;
+} GstSRTTsScanner;
+
+void gst_srt_ts_scanner_reset (GstSRTTsScanner * scanner);
+
+void gst_srt_ts_scanner_discont (GstSRTTsScanner * scanner);
+
+void gst_srt_ts_scanner_scan (GstSRTTsScanner * scanner, const guint8 * data,
+  gsize size);
+
+void gst_srt_ts_scanner_add_to_structure (const GstSRTTsScanner * scanner,
+  GstStructure * s);
+
+gsize gst_srt_ts_strip_null_packets (const guint8 * data, gsize size,
+  guint8 * out);
+
+gsize gst_srt_ts_restored_size (const guint8 * data, gsize size);
+
+void gst_srt_ts_restore_null_packets (const guint8 * data, gsize size,
+  guint8 * out);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_TS_SCAN_H__ */